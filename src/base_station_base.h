@@ -181,6 +181,7 @@ struct BaseStation : StationPool::PoolItem<&_station_pool> {
 		return (this->facilities & facilities) != 0;
 	}
 
+	static void PreCleanPool();
 	static void PostDestructor(size_t index);
 
 	private:
@@ -409,6 +409,7 @@ void VehicleCargoList::Append(CargoPacket *cp, MoveToAction action)
 	assert(cp != nullptr);
 	assert(action == MTA_LOAD ||
 			(action == MTA_KEEP && this->action_counts[MTA_LOAD] == 0));
+	this->ApplyAging();
 	this->AddToMeta(cp, action);
 
 	if (this->count == cp->count) {
@@ -441,6 +442,7 @@ void VehicleCargoList::Append(CargoPacket *cp, MoveToAction action)
 template<class Taction>
 void VehicleCargoList::ShiftCargo(Taction action)
 {
+	this->ApplyAging();
 	Iterator it(this->packets.begin());
 	while (it != this->packets.end() && action.MaxMove() > 0) {
 		CargoPacket *cp = *it;
@@ -466,6 +468,7 @@ void VehicleCargoList::ShiftCargoWithFrontInsert(Taction action)
 {
 	std::vector<CargoPacket *> packets_to_front_insert;
 
+	this->ApplyAging();
 	Iterator it(this->packets.begin());
 	while (it != this->packets.end() && action.MaxMove() > 0) {
 		CargoPacket *cp = *it;
@@ -493,6 +496,7 @@ template<class Taction>
 void VehicleCargoList::PopCargo(Taction action)
 {
 	if (this->packets.empty()) return;
+	this->ApplyAging();
 	for (auto it = this->packets.end(); it != this->packets.begin();) {
 		if (action.MaxMove() <= 0) break;
 		--it;
@@ -524,7 +528,9 @@ void VehicleCargoList::RemoveFromCache(const CargoPacket *cp, uint count)
  */
 void VehicleCargoList::AddToCache(const CargoPacket *cp)
 {
+	assert(this->pending_aging == 0);
 	this->feeder_share += cp->feeder_share;
+	this->max_days_in_transit = max(this->max_days_in_transit, cp->days_in_transit);
 	this->Parent::AddToCache(cp);
 }
 
@@ -558,17 +564,48 @@ void VehicleCargoList::AddToMeta(const CargoPacket *cp, MoveToAction action)
 
 /**
  * Ages the all cargo in this list.
+ * As long as no packet can reach the maximum the packets themselves are not
+ * touched; the aging is only counted and applied when the packets are needed.
  */
 void VehicleCargoList::AgeCargo()
 {
+	if (this->packets.empty()) {
+		this->pending_aging = 0;
+		this->max_days_in_transit = 0;
+		return;
+	}
+
+	if (this->max_days_in_transit + this->pending_aging < 0xFF) {
+		/* None of the packets is at the maximum, so all of them age. */
+		this->pending_aging++;
+		this->cargo_days_in_transit += this->count;
+		return;
+	}
+
+	this->ApplyAging();
+	this->max_days_in_transit = 0;
 	for (ConstIterator it(this->packets.begin()); it != this->packets.end(); it++) {
 		CargoPacket *cp = *it;
 		/* If we're at the maximum, then we can't increase no more. */
-		if (cp->days_in_transit == 0xFF) continue;
+		if (cp->days_in_transit != 0xFF) {
+			cp->days_in_transit++;
+			this->cargo_days_in_transit += cp->count;
+		}
+		this->max_days_in_transit = max(this->max_days_in_transit, cp->days_in_transit);
+	}
+}
 
-		cp->days_in_transit++;
-		this->cargo_days_in_transit += cp->count;
+/**
+ * Add the pending aging to the days in transit of all packets.
+ * The cached sum of the days in transit already includes it.
+ */
+void VehicleCargoList::ApplyPendingAging()
+{
+	for (ConstIterator it(this->packets.begin()); it != this->packets.end(); it++) {
+		(*it)->days_in_transit += this->pending_aging;
 	}
+	this->max_days_in_transit += this->pending_aging;
+	this->pending_aging = 0;
 }
 
 /**
@@ -628,6 +665,7 @@ bool VehicleCargoList::Stage(bool accepted, StationID current_station, StationID
 {
 	this->AssertCountConsistency();
 	assert(this->action_counts[MTA_LOAD] == 0);
+	this->ApplyAging();
 	this->action_counts[MTA_TRANSFER] = this->action_counts[MTA_DELIVER] = this->action_counts[MTA_KEEP] = 0;
 	Iterator it = this->packets.begin();
 	uint sum = 0;
@@ -721,6 +759,7 @@ bool VehicleCargoList::Stage(bool accepted, StationID current_station, StationID
 /** Invalidates the cached data and rebuild it. */
 void VehicleCargoList::InvalidateCache()
 {
+	this->ApplyAging();
 	this->feeder_share = 0;
 	this->Parent::InvalidateCache();
 }
@@ -858,6 +897,7 @@ uint VehicleCargoList::Truncate(uint max_move)
 uint VehicleCargoList::Reroute(uint max_move, VehicleCargoList *dest, StationID avoid, StationID avoid2, const GoodsEntry *ge)
 {
 	max_move = min(this->action_counts[MTA_TRANSFER], max_move);
+	dest->ApplyAging();
 	this->ShiftCargoWithFrontInsert(VehicleCargoReroute(this, dest, max_move, avoid, avoid2, ge));
 	return max_move;
 }
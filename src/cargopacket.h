@@ -286,6 +286,10 @@ protected:
 
 	Money feeder_share;                     ///< Cache for the feeder share.
 	uint action_counts[NUM_MOVE_TO_ACTION]; ///< Counts of cargo to be transferred, delivered, kept and loaded.
+	byte pending_aging = 0;                 ///< Number of times the cargo has been aged without updating the packets yet.
+	byte max_days_in_transit = 0;           ///< Upper bound of the days in transit stored in the packets.
+
+	void ApplyPendingAging();
 
 	template<class Taction>
 	void ShiftCargo(Taction action);
@@ -430,6 +434,15 @@ public:
 
 	void AgeCargo();
 
+	/**
+	 * Bring the days in transit of the packets up to date. This has to be
+	 * done before any packet is moved, paid for or saved.
+	 */
+	inline void ApplyAging()
+	{
+		if (this->pending_aging != 0) this->ApplyPendingAging();
+	}
+
 	void InvalidateCache();
 
 	void SetTransferLoadPlace(TileIndex xy);
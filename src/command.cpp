@@ -664,6 +664,29 @@ private:
 	char buffer[64];
 };
 
+/**
+ * Check whether executing a command may change the track layout, or anything else signal segments depend upon.
+ * The signal segment cache is suspended while such commands are executed.
+ * @param command the command
+ * @param flags the flags the command is executed with
+ * @return false if the command can not change the map, or is only tested
+ */
+static inline bool CommandMayChangeTrackLayout(const Command &command, DoCommandFlag flags)
+{
+	if (!(flags & DC_EXEC)) return false;
+
+	switch (command.type) {
+		case CMDT_VEHICLE_CONSTRUCTION:
+		case CMDT_VEHICLE_MANAGEMENT:
+		case CMDT_ROUTE_MANAGEMENT:
+		case CMDT_OTHER_MANAGEMENT:
+			return false;
+
+		default:
+			return true;
+	}
+}
+
 /*!
  * This function executes a given command with the parameters from the #CommandProc parameter list.
  * Depending on the flags parameter it execute or test a command.
@@ -719,7 +742,9 @@ CommandCost DoCommand(TileIndex tile, uint32 p1, uint32 p2, DoCommandFlag flags,
 	/* Execute the command here. All cost-relevant functions set the expenses type
 	 * themselves to the cost object at some point */
 	if (_docommand_recursive == 1) _cleared_object_areas.clear();
+	if (CommandMayChangeTrackLayout(command, flags)) SuspendSignalSegmentCache();
 	res = command.Execute(tile, flags, p1, p2, text, binary_length);
+	if (CommandMayChangeTrackLayout(command, flags)) ResumeSignalSegmentCache();
 	if (res.Failed()) {
 error:
 		_docommand_recursive--;
@@ -982,7 +1007,9 @@ CommandCost DoCommandPInternal(TileIndex tile, uint32 p1, uint32 p2, uint32 cmd,
 	 * use the construction one */
 	_cleared_object_areas.clear();
 	BasePersistentStorageArray::SwitchMode(PSM_ENTER_COMMAND);
+	if (CommandMayChangeTrackLayout(command, flags | DC_EXEC)) SuspendSignalSegmentCache();
 	CommandCost res2 = command.Execute(tile, flags | DC_EXEC, p1, p2, text, binary_length);
+	if (CommandMayChangeTrackLayout(command, flags | DC_EXEC)) ResumeSignalSegmentCache();
 	BasePersistentStorageArray::SwitchMode(PSM_LEAVE_COMMAND);
 
 	if (cmd_id == CMD_COMPANY_CTRL) {
@@ -2071,6 +2071,84 @@ DEF_CONSOLE_CMD(ConMapStats)
 	return true;
 }
 
+DEF_CONSOLE_CMD(ConYapfCacheStats)
+{
+	if (argc == 0) {
+		IConsoleHelp("Dump YAPF rail segment cost cache stats.");
+		return true;
+	}
+
+	extern void DumpYapfSegmentCostCacheStats(char *b, const char *last);
+	char buffer[4096];
+	DumpYapfSegmentCostCacheStats(buffer, lastof(buffer));
+	PrintLineByLine(buffer);
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConSpriteCacheStats)
+{
+	if (argc == 0) {
+		IConsoleHelp("Dump sprite cache stats: size, hit rate and evictions.");
+		return true;
+	}
+
+	extern void DumpSpriteCacheStats(char *b, const char *last);
+	char buffer[8192];
+	DumpSpriteCacheStats(buffer, lastof(buffer));
+	PrintLineByLine(buffer);
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConBenchmarkMap)
+{
+	if (argc == 0 || argc > 2) {
+		IConsoleHelp("Benchmark tile scans and the tile loop over the whole map. Usage: 'benchmark_map [<passes>]'");
+		IConsoleHelp("Each benchmark does <passes> passes over the map, default 4. The game must be paused.");
+		IConsoleHelp("This runs the tile loop 256 times per pass on the current game, so all tiles are advanced.");
+		return true;
+	}
+
+	uint passes = 4;
+	if (argc == 2 && (!GetArgumentInteger(&passes, argv[1]) || passes == 0)) return false;
+
+	if (_pause_mode == PM_UNPAUSED) {
+		IConsoleError("The game must be paused, as this runs the tile loop on the current game.");
+		return true;
+	}
+	IConsoleWarning("Running the tile loop advances all tiles, the game will not be as it was before the benchmark.");
+
+	extern void BenchmarkMap(char *b, const char *last, uint passes);
+	char buffer[1024];
+	BenchmarkMap(buffer, lastof(buffer), passes);
+	PrintLineByLine(buffer);
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConBenchmarkVehicles)
+{
+	if (argc == 0 || argc > 2) {
+		IConsoleHelp("Benchmark the vehicle tile index lookups and the vehicle ticks. Usage: 'benchmark_vehicles [<passes>]'");
+		IConsoleHelp("Each benchmark does <passes> passes over all vehicles, default 16. The game must be paused.");
+		IConsoleHelp("This runs <passes> vehicle ticks on the current game, so all vehicles are advanced.");
+		return true;
+	}
+
+	uint passes = 16;
+	if (argc == 2 && (!GetArgumentInteger(&passes, argv[1]) || passes == 0)) return false;
+
+	if (_pause_mode == PM_UNPAUSED) {
+		IConsoleError("The game must be paused, as this runs the vehicle ticks on the current game.");
+		return true;
+	}
+	IConsoleWarning("Running the vehicle ticks advances all vehicles, the game will not be as it was before the benchmark.");
+
+	extern void BenchmarkVehicles(char *b, const char *last, uint passes);
+	char buffer[1024];
+	BenchmarkVehicles(buffer, lastof(buffer), passes);
+	PrintLineByLine(buffer);
+	return true;
+}
+
 DEF_CONSOLE_CMD(ConStFlowStats)
 {
 	if (argc == 0) {
@@ -2455,6 +2533,10 @@ void IConsoleStdLibRegister()
 	IConsoleCmdRegister("dump_cpdp_stats", ConDumpCpdpStats, nullptr, true);
 	IConsoleCmdRegister("dump_veh_stats", ConVehicleStats, nullptr, true);
 	IConsoleCmdRegister("dump_map_stats", ConMapStats, nullptr, true);
+	IConsoleCmdRegister("dump_yapf_cache_stats", ConYapfCacheStats, nullptr, true);
+	IConsoleCmdRegister("dump_sprite_cache_stats", ConSpriteCacheStats, nullptr, true);
+	IConsoleCmdRegister("benchmark_map", ConBenchmarkMap, ConHookNoNetwork, true);
+	IConsoleCmdRegister("benchmark_vehicles", ConBenchmarkVehicles, ConHookNoNetwork, true);
 	IConsoleCmdRegister("dump_st_flow_stats", ConStFlowStats, nullptr, true);
 	IConsoleCmdRegister("dump_game_events", ConDumpGameEvents, nullptr, true);
 	IConsoleCmdRegister("dump_load_debug_log", ConDumpLoadDebugLog, nullptr, true);
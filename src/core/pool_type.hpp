@@ -13,6 +13,7 @@
 #include "smallvec_type.hpp"
 #include "enum_type.hpp"
 #include <functional>
+#include <algorithm>
 
 /** Various types of a pool. */
 enum PoolType {
@@ -412,4 +413,152 @@ private:
 	void FreeItem(size_t index);
 };
 
+/** Position of a PoolItem in a PoolBucketIndex, to be embedded in the indexed items. */
+struct PoolBucketIndexNode {
+	static const uint32 NOT_INDEXED = UINT32_MAX;     ///< The item is not in any bucket.
+	static const uint32 PENDING     = UINT32_MAX - 1; ///< The item has not been sorted into its bucket yet.
+
+	uint32 bucket = NOT_INDEXED; ///< Bucket the item is in, or one of the above.
+};
+
+/**
+ * Secondary index over the items of a pool, which sorts the items into a fixed number of
+ * buckets, e.g. by owner, so loops only interested in one bucket need not visit the whole pool.
+ * The items of a bucket are kept in order of their index, which is the order Iterate() visits them in.
+ *
+ * New items are only sorted into their bucket when the index is next read, as the key is
+ * usually set just after construction. After that, Update() has to be called whenever the
+ * key of an item changes.
+ * @tparam Titem       Type of the indexed items.
+ * @tparam Tnum_buckets Number of buckets.
+ * @tparam Tnode       Member of Titem holding the position of the item in the index.
+ * @tparam Tget_bucket Function returning the bucket of an item, or a value of at least Tnum_buckets if it is not to be indexed.
+ */
+template <class Titem, uint Tnum_buckets, PoolBucketIndexNode Titem::*Tnode, uint (*Tget_bucket)(const Titem *)>
+class PoolBucketIndex {
+	std::vector<Titem *> buckets[Tnum_buckets]; ///< The items of each bucket, sorted by index.
+	std::vector<size_t> pending;                ///< Indices of the items added since the index was last read.
+
+	static bool CompareIndex(const Titem *a, const Titem *b) { return a->index < b->index; }
+
+	void Insert(Titem *item, uint bucket)
+	{
+		std::vector<Titem *> &list = this->buckets[bucket];
+		list.insert(std::upper_bound(list.begin(), list.end(), item, CompareIndex), item);
+		(item->*Tnode).bucket = bucket;
+	}
+
+	void Erase(Titem *item)
+	{
+		uint32 &bucket = (item->*Tnode).bucket;
+		if (bucket < Tnum_buckets) {
+			std::vector<Titem *> &list = this->buckets[bucket];
+			auto iter = std::lower_bound(list.begin(), list.end(), item, CompareIndex);
+			assert(iter != list.end() && *iter == item);
+			list.erase(iter);
+		}
+		bucket = PoolBucketIndexNode::NOT_INDEXED;
+	}
+
+	/** Sort the items added since the index was last read into their buckets. */
+	void Flush()
+	{
+		for (size_t index : this->pending) {
+			/* The item may have been deleted in the meantime, and its slot even reused. */
+			Titem *item = Titem::GetIfValid(index);
+			if (item == nullptr || (item->*Tnode).bucket != PoolBucketIndexNode::PENDING) continue;
+
+			uint bucket = Tget_bucket(item);
+			if (bucket < Tnum_buckets) {
+				this->Insert(item, bucket);
+			} else {
+				(item->*Tnode).bucket = PoolBucketIndexNode::NOT_INDEXED;
+			}
+		}
+		this->pending.clear();
+	}
+
+public:
+	/**
+	 * Add a newly constructed item to the index.
+	 * @param item The item.
+	 */
+	void Add(Titem *item)
+	{
+		(item->*Tnode).bucket = PoolBucketIndexNode::PENDING;
+		this->pending.push_back(item->index);
+	}
+
+	/**
+	 * Remove an item which is about to be deleted from the index.
+	 * @param item The item.
+	 */
+	void Remove(Titem *item)
+	{
+		this->Erase(item);
+	}
+
+	/**
+	 * Move an item to its new bucket after its key changed.
+	 * @param item The item.
+	 */
+	void Update(Titem *item)
+	{
+		uint32 bucket = (item->*Tnode).bucket;
+		if (bucket == PoolBucketIndexNode::PENDING) return;
+
+		uint new_bucket = Tget_bucket(item);
+		if (new_bucket >= Tnum_buckets) new_bucket = PoolBucketIndexNode::NOT_INDEXED;
+		if (new_bucket == bucket) return;
+
+		this->Erase(item);
+		if (new_bucket != PoolBucketIndexNode::NOT_INDEXED) this->Insert(item, new_bucket);
+	}
+
+	/**
+	 * Get the items of a bucket.
+	 * @param bucket The bucket.
+	 * @return The items, in order of their index.
+	 */
+	const std::vector<Titem *> &Get(uint bucket)
+	{
+		assert(bucket < Tnum_buckets);
+		this->Flush();
+		return this->buckets[bucket];
+	}
+
+	/** Forget all items, for when the pool is cleaned. */
+	void Clear()
+	{
+		for (std::vector<Titem *> &list : this->buckets) list.clear();
+		this->pending.clear();
+	}
+
+	/**
+	 * Check the index against the items of the pool.
+	 * @return true if every item is in the bucket it belongs to, and nothing else is.
+	 */
+	bool Validate()
+	{
+		this->Flush();
+		size_t count = 0;
+		for (Titem *item : Titem::Iterate()) {
+			uint bucket = Tget_bucket(item);
+			if (bucket >= Tnum_buckets) {
+				if ((item->*Tnode).bucket != PoolBucketIndexNode::NOT_INDEXED) return false;
+				continue;
+			}
+			if ((item->*Tnode).bucket != bucket) return false;
+			const std::vector<Titem *> &list = this->buckets[bucket];
+			if (!std::binary_search(list.begin(), list.end(), item, CompareIndex)) return false;
+			count++;
+		}
+		for (const std::vector<Titem *> &list : this->buckets) {
+			if (list.size() > count) return false;
+			count -= list.size();
+		}
+		return count == 0;
+	}
+};
+
 #endif /* POOL_TYPE_HPP */
@@ -119,20 +119,17 @@ Money CalculateCompanyValue(const Company *c, bool including_loan)
 
 	uint num = 0;
 
-	for (const Station *st : Station::Iterate()) {
-		if (st->owner == owner) num += CountBits((byte)st->facilities);
+	for (const Station *st : GetCompanyStations(owner)) {
+		num += CountBits((byte)st->facilities);
 	}
 
 	Money value = num * _price[PR_STATION_VALUE] * 25;
 
-	for (const Vehicle *v : Vehicle::Iterate()) {
-		if (v->owner != owner) continue;
-		if (HasBit(v->subtype, GVSF_VIRTUAL)) continue;
+	for (VehicleType type = VEH_BEGIN; type < VEH_COMPANY_END; type++) {
+		for (const Vehicle *v : GetCompanyVehiclesOfType(owner, type)) {
+			if (HasBit(v->subtype, GVSF_VIRTUAL)) continue;
+			if (v->type == VEH_AIRCRAFT && !Aircraft::From(v)->IsNormalAircraft()) continue;
 
-		if (v->type == VEH_TRAIN ||
-				v->type == VEH_ROAD ||
-				(v->type == VEH_AIRCRAFT && Aircraft::From(v)->IsNormalAircraft()) ||
-				v->type == VEH_SHIP) {
 			value += v->value * 3 >> 1;
 		}
 	}
@@ -165,15 +162,16 @@ int UpdateCompanyRatingAndValue(Company *c, bool update)
 		bool min_profit_first = true;
 		uint num = 0;
 
-		for (const Vehicle *v : Vehicle::Iterate()) {
-			if (v->owner != owner) continue;
-			if (IsCompanyBuildableVehicleType(v->type) && v->IsPrimaryVehicle() && !HasBit(v->subtype, GVSF_VIRTUAL)) {
-				if (v->profit_last_year > 0) num++; // For the vehicle score only count profitable vehicles
-				if (v->age > 730) {
-					/* Find the vehicle with the lowest amount of profit */
-					if (min_profit_first || min_profit > v->profit_last_year) {
-						min_profit = v->profit_last_year;
-						min_profit_first = false;
+		for (VehicleType type = VEH_BEGIN; type < VEH_COMPANY_END; type++) {
+			for (const Vehicle *v : GetCompanyVehiclesOfType(owner, type)) {
+				if (v->IsPrimaryVehicle() && !HasBit(v->subtype, GVSF_VIRTUAL)) {
+					if (v->profit_last_year > 0) num++; // For the vehicle score only count profitable vehicles
+					if (v->age > 730) {
+						/* Find the vehicle with the lowest amount of profit */
+						if (min_profit_first || min_profit > v->profit_last_year) {
+							min_profit = v->profit_last_year;
+							min_profit_first = false;
+						}
 					}
 				}
 			}
@@ -191,9 +189,9 @@ int UpdateCompanyRatingAndValue(Company *c, bool update)
 	/* Count stations */
 	{
 		uint num = 0;
-		for (const Station *st : Station::Iterate()) {
+		for (const Station *st : GetCompanyStations(owner)) {
 			/* Only count stations that are actually serviced */
-			if (st->owner == owner && (st->time_since_load <= 20 || st->time_since_unload <= 20)) num += CountBits((byte)st->facilities);
+			if (st->time_since_load <= 20 || st->time_since_unload <= 20) num += CountBits((byte)st->facilities);
 		}
 		_score_part[owner][SCORE_STATIONS] = num;
 	}
@@ -462,6 +460,7 @@ void ChangeOwnershipOfCompanyItems(Owner old_owner, Owner new_owner)
 				}
 
 				v->owner = new_owner;
+				_vehicle_owner_type_index.Update(v);
 
 				/* Owner changes, clear cache */
 				v->colourmap = PAL_NONE;
@@ -509,9 +508,11 @@ void ChangeOwnershipOfCompanyItems(Owner old_owner, Owner new_owner)
 	/*  Change ownership of tiles */
 	{
 		TileIndex tile = 0;
+		SuspendSignalSegmentCache();
 		do {
 			ChangeTileOwner(tile, old_owner, new_owner);
 		} while (++tile != MapSize());
+		ResumeSignalSegmentCache();
 
 		if (new_owner != INVALID_OWNER) {
 			/* Update all signals because there can be new segment that was owned by two companies
@@ -538,6 +539,7 @@ void ChangeOwnershipOfCompanyItems(Owner old_owner, Owner new_owner)
 			/* if a company goes bankrupt, set owner to OWNER_NONE so the sign doesn't disappear immediately
 			 * also, drawing station window would cause reading invalid company's colour */
 			st->owner = new_owner == INVALID_OWNER ? OWNER_NONE : new_owner;
+			_station_owner_index.Update(st);
 		}
 	}
 
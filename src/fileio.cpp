@@ -15,6 +15,7 @@
 #include "tar_type.h"
 #ifdef _WIN32
 #include <windows.h>
+#include <io.h>
 # define access _taccess
 #elif defined(__HAIKU__)
 #include <Path.h>
@@ -23,6 +24,9 @@
 #include <unistd.h>
 #include <pwd.h>
 #endif
+#if defined(UNIX)
+#include <sys/mman.h>
+#endif
 #include <sys/stat.h>
 #include <algorithm>
 
@@ -35,16 +39,34 @@
 /** Size of the #Fio data buffer. */
 #define FIO_BUFFER_SIZE 8192
 
-/** Structure for keeping several open files with just one data buffer. */
-struct Fio {
+/** Read only view of the contents of a slotted file, mapped into memory. */
+struct FioFileView {
+	byte *data = nullptr;     ///< Contents of the file, or nullptr when the file is not mapped.
+	size_t size = 0;          ///< Size of the file.
+	size_t offset = 0;        ///< Position of the file in the opened file, which differs from 0 for a file in a tar.
+	byte *map_base = nullptr; ///< Start of the mapped range, which starts at a page boundary before #data.
+	size_t map_size = 0;      ///< Size of the mapped range.
+#ifdef _WIN32
+	HANDLE mapping = nullptr; ///< Handle of the file mapping.
+#endif
+};
+
+/** The file position the Fio read functions of a thread read from. */
+struct FioCursor {
 	byte buffer_start[FIO_BUFFER_SIZE];    ///< local buffer when read from file
 	byte *buffer, *buffer_end;             ///< position pointer in local buffer and last valid byte of buffer
 	size_t pos;                            ///< current (system) position in file
 	FILE *cur_fh;                          ///< current file handle
 	const char *filename;                  ///< current filename
+	FILE *private_fh;                      ///< file opened by #FioOpenPrivateFile
+};
+
+/** Structure for keeping several open files with just one data buffer. */
+struct Fio {
 	FILE *handles[MAX_FILE_SLOTS];         ///< array of file handles we can have open
 	const char *filenames[MAX_FILE_SLOTS]; ///< array of filenames we (should) have open
 	char *shortnames[MAX_FILE_SLOTS];      ///< array of short names for spriteloader's use
+	FioFileView views[MAX_FILE_SLOTS];     ///< views of the whole files, for #FioViewReader
 #if defined(LIMITED_FDS)
 	uint open_handles;                     ///< current amount of open handles
 	uint usage_count[MAX_FILE_SLOTS];      ///< count how many times this file has been opened
@@ -52,6 +74,7 @@ struct Fio {
 };
 
 static Fio _fio; ///< #Fio instance.
+static thread_local FioCursor _fio_cursor; ///< #FioCursor of the current thread.
 
 /** Whether the working directory should be scanned. */
 static bool _do_scan_working_directory = true;
@@ -65,7 +88,7 @@ extern char *_highscore_file;
  */
 size_t FioGetPos()
 {
-	return _fio.pos + (_fio.buffer - _fio.buffer_end);
+	return _fio_cursor.pos + (_fio_cursor.buffer - _fio_cursor.buffer_end);
 }
 
 /**
@@ -86,10 +109,10 @@ const char *FioGetFilename(uint slot)
 void FioSeekTo(size_t pos, int mode)
 {
 	if (mode == SEEK_CUR) pos += FioGetPos();
-	_fio.buffer = _fio.buffer_end = _fio.buffer_start + FIO_BUFFER_SIZE;
-	_fio.pos = pos;
-	if (fseek(_fio.cur_fh, _fio.pos, SEEK_SET) < 0) {
-		DEBUG(misc, 0, "Seeking in %s failed", _fio.filename);
+	_fio_cursor.buffer = _fio_cursor.buffer_end = _fio_cursor.buffer_start + FIO_BUFFER_SIZE;
+	_fio_cursor.pos = pos;
+	if (fseek(_fio_cursor.cur_fh, _fio_cursor.pos, SEEK_SET) < 0) {
+		DEBUG(misc, 0, "Seeking in %s failed", _fio_cursor.filename);
 	}
 }
 
@@ -119,8 +142,8 @@ void FioSeekToFile(uint slot, size_t pos)
 #endif /* LIMITED_FDS */
 	f = _fio.handles[slot];
 	assert(f != nullptr);
-	_fio.cur_fh = f;
-	_fio.filename = _fio.filenames[slot];
+	_fio_cursor.cur_fh = f;
+	_fio_cursor.filename = _fio.filenames[slot];
 	FioSeekTo(pos, SEEK_SET);
 }
 
@@ -130,15 +153,15 @@ void FioSeekToFile(uint slot, size_t pos)
  */
 byte FioReadByte()
 {
-	if (_fio.buffer == _fio.buffer_end) {
-		_fio.buffer = _fio.buffer_start;
-		size_t size = fread(_fio.buffer, 1, FIO_BUFFER_SIZE, _fio.cur_fh);
-		_fio.pos += size;
-		_fio.buffer_end = _fio.buffer_start + size;
+	if (_fio_cursor.buffer == _fio_cursor.buffer_end) {
+		_fio_cursor.buffer = _fio_cursor.buffer_start;
+		size_t size = fread(_fio_cursor.buffer, 1, FIO_BUFFER_SIZE, _fio_cursor.cur_fh);
+		_fio_cursor.pos += size;
+		_fio_cursor.buffer_end = _fio_cursor.buffer_start + size;
 
 		if (size == 0) return 0;
 	}
-	return *_fio.buffer++;
+	return *_fio_cursor.buffer++;
 }
 
 /**
@@ -148,8 +171,8 @@ byte FioReadByte()
 void FioSkipBytes(int n)
 {
 	for (;;) {
-		int m = min(_fio.buffer_end - _fio.buffer, n);
-		_fio.buffer += m;
+		int m = min(_fio_cursor.buffer_end - _fio_cursor.buffer, n);
+		_fio_cursor.buffer += m;
 		n -= m;
 		if (n == 0) break;
 		FioReadByte();
@@ -185,7 +208,108 @@ uint32 FioReadDword()
 void FioReadBlock(void *ptr, size_t size)
 {
 	FioSeekTo(FioGetPos(), SEEK_SET);
-	_fio.pos += fread(ptr, 1, size, _fio.cur_fh);
+	_fio_cursor.pos += fread(ptr, 1, size, _fio_cursor.cur_fh);
+}
+
+/**
+ * Create the view of the contents of a slotted file.
+ * Only the range of the file itself is mapped into memory, so for a file in a tar not the whole tar is mapped.
+ * When the file cannot be mapped, #FioViewReader reads it with the Fio functions instead.
+ * @param slot Slot of the file, which has just been opened and is positioned at the start of the file.
+ * @param size Size of the file.
+ */
+static void FioCreateFileView(uint slot, size_t size)
+{
+	FioFileView &view = _fio.views[slot];
+	FILE *f = _fio.handles[slot];
+
+	long pos = ftell(f);
+	if (pos < 0) usererror("Cannot read file '%s'", _fio.filenames[slot]);
+	view.size = size;
+	view.offset = pos;
+	if (view.size == 0) return;
+
+#if defined(_WIN32)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	const size_t map_offset = view.offset - view.offset % info.dwAllocationGranularity;
+	view.map_size = view.size + (view.offset - map_offset);
+	view.mapping = CreateFileMapping((HANDLE)_get_osfhandle(_fileno(f)), nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (view.mapping != nullptr) {
+		view.map_base = (byte *)MapViewOfFile(view.mapping, FILE_MAP_READ, (DWORD)((uint64)map_offset >> 32), (DWORD)map_offset, view.map_size);
+		if (view.map_base != nullptr) {
+			view.data = view.map_base + (view.offset - map_offset);
+			return;
+		}
+		CloseHandle(view.mapping);
+		view.mapping = nullptr;
+	}
+#elif defined(UNIX)
+	const size_t page_size = sysconf(_SC_PAGESIZE);
+	const size_t map_offset = view.offset - view.offset % page_size;
+	view.map_size = view.size + (view.offset - map_offset);
+	void *data = mmap(nullptr, view.map_size, PROT_READ, MAP_PRIVATE, fileno(f), map_offset);
+	if (data != MAP_FAILED) {
+		view.map_base = (byte *)data;
+		view.data = view.map_base + (view.offset - map_offset);
+		return;
+	}
+#endif
+
+	DEBUG(misc, 3, "Mapping file '%s' failed, reading it with the Fio functions instead", _fio.filenames[slot]);
+	view.map_size = 0;
+}
+
+/**
+ * Release the view of the contents of a slotted file.
+ * @param slot Slot of the file.
+ */
+static void FioReleaseFileView(uint slot)
+{
+	FioFileView &view = _fio.views[slot];
+	if (view.map_base != nullptr) {
+#if defined(_WIN32)
+		UnmapViewOfFile(view.map_base);
+		CloseHandle(view.mapping);
+#elif defined(UNIX)
+		munmap(view.map_base, view.map_size);
+#endif
+	}
+	view = FioFileView();
+}
+
+/**
+ * Check whether a slotted file is mapped into memory, so #FioViewReader can read it on any thread.
+ * @param slot Slot of the file.
+ * @return True if the contents of the file can be read without the Fio functions.
+ */
+bool FioHasFileView(uint slot)
+{
+	return _fio.views[slot].data != nullptr;
+}
+
+/**
+ * Create a reader for a slotted file.
+ * When the file is not mapped into memory, the reader uses the Fio functions of the current thread.
+ * @param slot Slot of the file.
+ * @param pos Position in the file to start reading at.
+ */
+FioViewReader::FioViewReader(uint slot, size_t pos)
+{
+#if defined(LIMITED_FDS)
+	/* Make sure we have this file open */
+	FioRestoreFile(slot);
+#endif /* LIMITED_FDS */
+	const FioFileView &view = _fio.views[slot];
+	assert(_fio.handles[slot] != nullptr);
+	this->data = view.data;
+	this->end = view.data + (view.data != nullptr ? view.size : 0);
+	this->offset = view.offset;
+	if (this->data == nullptr) {
+		FioSeekToFile(slot, pos);
+	} else {
+		this->SeekTo(pos);
+	}
 }
 
 /**
@@ -195,6 +319,7 @@ void FioReadBlock(void *ptr, size_t size)
 static inline void FioCloseFile(int slot)
 {
 	if (_fio.handles[slot] != nullptr) {
+		FioReleaseFileView(slot);
 		fclose(_fio.handles[slot]);
 
 		free(_fio.shortnames[slot]);
@@ -252,7 +377,8 @@ void FioOpenFile(uint slot, const char *filename, Subdirectory subdir, char **ou
 #if defined(LIMITED_FDS)
 	FioFreeHandle();
 #endif /* LIMITED_FDS */
-	f = FioFOpenFile(filename, "rb", subdir, nullptr, output_filename);
+	size_t size;
+	f = FioFOpenFile(filename, "rb", subdir, &size, output_filename);
 	if (f == nullptr) usererror("Cannot open file '%s'", filename);
 	long pos = ftell(f);
 	if (pos < 0) usererror("Cannot read file '%s'", filename);
@@ -260,6 +386,7 @@ void FioOpenFile(uint slot, const char *filename, Subdirectory subdir, char **ou
 	FioCloseFile(slot); // if file was opened before, close it
 	_fio.handles[slot] = f;
 	_fio.filenames[slot] = filename;
+	FioCreateFileView(slot, size);
 
 	/* Store the filename without path and extension */
 	const char *t = strrchr(filename, PATHSEPCHAR);
@@ -275,6 +402,47 @@ void FioOpenFile(uint slot, const char *filename, Subdirectory subdir, char **ou
 	FioSeekToFile(slot, (uint32)pos);
 }
 
+/**
+ * Open a file for the Fio read functions of the current thread only, without assigning it a slot.
+ * This allows several threads to each read a file at the same time.
+ * The file stays open until #FioClosePrivateFile is called.
+ * @param filename Name of the file at the disk.
+ * @param subdir The sub directory to search this file in.
+ * @param output_filename Where to store the full path of the file, if not nullptr.
+ * @return Whether the file could be opened.
+ */
+bool FioOpenPrivateFile(const char *filename, Subdirectory subdir, char **output_filename)
+{
+	FioClosePrivateFile();
+
+	FILE *f = FioFOpenFile(filename, "rb", subdir, nullptr, output_filename);
+	if (f == nullptr) return false;
+	long pos = ftell(f);
+	if (pos < 0) {
+		FioFCloseFile(f);
+		return false;
+	}
+
+	_fio_cursor.private_fh = f;
+	_fio_cursor.cur_fh = f;
+	_fio_cursor.filename = filename;
+	FioSeekTo(pos, SEEK_SET);
+	return true;
+}
+
+/** Close the file opened by #FioOpenPrivateFile of the current thread, if any. */
+void FioClosePrivateFile()
+{
+	if (_fio_cursor.private_fh == nullptr) return;
+
+	if (_fio_cursor.cur_fh == _fio_cursor.private_fh) {
+		_fio_cursor.cur_fh = nullptr;
+		_fio_cursor.filename = nullptr;
+	}
+	FioFCloseFile(_fio_cursor.private_fh);
+	_fio_cursor.private_fh = nullptr;
+}
+
 static const char * const _subdirs[] = {
 	"",
 	"save" PATHSEP,
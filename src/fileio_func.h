@@ -13,6 +13,8 @@
 #include "core/enum_type.hpp"
 #include "fileio_type.h"
 
+#include <algorithm>
+
 void FioSeekTo(size_t pos, int mode);
 void FioSeekToFile(uint slot, size_t pos);
 size_t FioGetPos();
@@ -22,8 +24,93 @@ uint16 FioReadWord();
 uint32 FioReadDword();
 void FioCloseAll();
 void FioOpenFile(uint slot, const char *filename, Subdirectory subdir, char **output_filename = nullptr);
+bool FioOpenPrivateFile(const char *filename, Subdirectory subdir, char **output_filename = nullptr);
+void FioClosePrivateFile();
 void FioReadBlock(void *ptr, size_t size);
 void FioSkipBytes(int n);
+bool FioHasFileView(uint slot);
+
+/**
+ * Reader of a slotted file, which has its own position instead of sharing the
+ * one of the Fio functions above. The file is read from a view of its
+ * contents mapped into memory, so several readers can be used at the same
+ * time, also on other threads, as long as the file stays open.
+ * When the file could not be mapped, see #FioHasFileView, the reader falls
+ * back to the Fio functions, and can only be used one at a time.
+ * Like #FioReadByte, reading beyond the end of the file returns zeros.
+ */
+class FioViewReader {
+	const byte *data; ///< Start of the file, or nullptr when reading with the Fio functions.
+	const byte *pos;  ///< Current position in the file.
+	const byte *end;  ///< End of the file.
+	size_t offset;    ///< Position of the start of the file in the opened file.
+
+public:
+	FioViewReader(uint slot, size_t pos);
+
+	/**
+	 * Get the position in the file.
+	 * @return Position in the file.
+	 */
+	inline size_t GetPos() const
+	{
+		if (this->data == nullptr) return FioGetPos();
+		return this->pos - this->data + this->offset;
+	}
+
+	/**
+	 * Seek to an absolute position in the file.
+	 * @param pos New position.
+	 */
+	inline void SeekTo(size_t pos)
+	{
+		if (this->data == nullptr) {
+			FioSeekTo(pos, SEEK_SET);
+			return;
+		}
+		pos = pos > this->offset ? pos - this->offset : 0;
+		this->pos = this->data + std::min<size_t>(pos, this->end - this->data);
+	}
+
+	/**
+	 * Skip bytes ahead in the file.
+	 * @param n Number of bytes to skip.
+	 */
+	inline void SkipBytes(size_t n)
+	{
+		this->SeekTo(this->GetPos() + n);
+	}
+
+	/**
+	 * Read a byte from the file.
+	 * @return Read byte.
+	 */
+	inline byte ReadByte()
+	{
+		if (this->data == nullptr) return FioReadByte();
+		return this->pos < this->end ? *this->pos++ : 0;
+	}
+
+	/**
+	 * Read a word (16 bits) from the file (in low endian format).
+	 * @return Read word.
+	 */
+	inline uint16 ReadWord()
+	{
+		byte b = this->ReadByte();
+		return (this->ReadByte() << 8) | b;
+	}
+
+	/**
+	 * Read a double word (32 bits) from the file (in low endian format).
+	 * @return Read double word.
+	 */
+	inline uint32 ReadDword()
+	{
+		uint b = this->ReadWord();
+		return (this->ReadWord() << 16) | b;
+	}
+};
 
 /**
  * The search paths OpenTTD could search through.
@@ -33,6 +33,8 @@
 #include "game/game_instance.hpp"
 #include "string_func.h"
 #include "thread.h"
+#include "debug.h"
+#include <chrono>
 
 #include "safeguards.h"
 
@@ -110,6 +112,13 @@ static void _GenerateWorld()
 		/* We keep id 0 for old savegames that don't have an id */
 		_settings_game.game_creation.generation_unique_id = _interactive_random.Next(UINT32_MAX - 1) + 1; /* Generates between [1,UINT32_MAX] */
 
+		/* Time the phases which scan the whole map, to compare map storage layouts. */
+		typedef std::chrono::steady_clock Clock;
+		auto elapsed_ms = [](Clock::time_point start) { return (long long)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count(); };
+		const Clock::time_point generation_start = Clock::now();
+		long long landscape_ms = 0;
+		long long tile_loop_ms = 0;
+
 		SetGeneratingWorldProgress(GWP_MAP_INIT, 2);
 		SetObjectToPlace(SPR_CURSOR_ZZZ, PAL_NONE, HT_NONE, WC_MAIN_WINDOW, 0);
 
@@ -135,8 +144,10 @@ static void _GenerateWorld()
 			ConvertGroundTilesIntoWaterTiles();
 			IncreaseGeneratingWorldProgress(GWP_OBJECT);
 		} else {
+			const Clock::time_point landscape_start = Clock::now();
 			GenerateLandscape(_gw.mode);
 			GenerateClearTile();
+			landscape_ms = elapsed_ms(landscape_start);
 
 			/* Only generate towns, tree and industries in newgame mode. */
 			if (_game_mode != GM_EDITOR) {
@@ -172,11 +183,13 @@ static void _GenerateWorld()
 			uint i;
 
 			SetGeneratingWorldProgress(GWP_RUNTILELOOP, 0x500);
+			const Clock::time_point tile_loop_start = Clock::now();
 			for (i = 0; i < 0x500; i++) {
 				RunTileLoop();
 				_tick_counter++;
 				IncreaseGeneratingWorldProgress(GWP_RUNTILELOOP);
 			}
+			tile_loop_ms = elapsed_ms(tile_loop_start);
 
 			if (_game_mode != GM_EDITOR) {
 				Game::StartNew();
@@ -196,6 +209,8 @@ static void _GenerateWorld()
 
 		BasePersistentStorageArray::SwitchMode(PSM_LEAVE_GAMELOOP);
 
+		DEBUG(map, 1, "Generated %u x %u map in %lld ms (landscape: %lld ms, tile loop: %lld ms)", MapSizeX(), MapSizeY(), elapsed_ms(generation_start), landscape_ms, tile_loop_ms);
+
 		ResetObjectToPlace();
 		_cur_company.Trash();
 		_current_company = _local_company = _gw.lc;
@@ -17,6 +17,8 @@
 LinkGraphPool _link_graph_pool("LinkGraph");
 INSTANTIATE_POOL_METHODS(LinkGraph)
 
+const LinkGraph::BaseEdge LinkGraph::empty_edge = { 0, 0, INVALID_DATE, INVALID_DATE, INVALID_NODE, INVALID_NODE };
+
 /**
  * Create a node or clear it.
  * @param xy Location of the associated station.
@@ -34,14 +36,42 @@ inline void LinkGraph::BaseNode::Init(TileIndex xy, StationID st, uint demand)
 
 /**
  * Create an edge.
+ * @param dest Destination of the edge.
  */
-inline void LinkGraph::BaseEdge::Init()
+void LinkGraph::BaseEdge::Init(NodeID dest)
 {
 	this->capacity = 0;
 	this->usage = 0;
 	this->last_unrestricted_update = INVALID_DATE;
 	this->last_restricted_update = INVALID_DATE;
 	this->next_edge = INVALID_NODE;
+	this->dest_node = dest;
+}
+
+/**
+ * Insert an empty edge to the given node, keeping the edges sorted. It isn't
+ * linked into the next_edge chain. There must not be an edge to that node yet.
+ * @param to Destination of the new edge.
+ * @return The new edge.
+ */
+LinkGraph::BaseEdge &LinkGraph::BaseEdgeSet::Insert(NodeID to)
+{
+	std::vector<BaseEdge>::iterator it = std::lower_bound(this->edges.begin(), this->edges.end(), to,
+			[](const BaseEdge &edge, NodeID to) { return edge.dest_node < to; });
+	assert(it == this->edges.end() || it->dest_node != to);
+	it = this->edges.emplace(it);
+	it->Init(to);
+	return *it;
+}
+
+/**
+ * Erase the edge to the given node, if any. The next_edge chain isn't updated.
+ * @param to Destination of the edge to be erased.
+ */
+void LinkGraph::BaseEdgeSet::Erase(NodeID to)
+{
+	BaseEdge *edge = this->Find(to);
+	if (edge != nullptr) this->edges.erase(this->edges.begin() + (edge - this->edges.data()));
 }
 
 /**
@@ -55,8 +85,7 @@ void LinkGraph::ShiftDates(int interval)
 	for (NodeID node1 = 0; node1 < this->Size(); ++node1) {
 		BaseNode &source = this->nodes[node1];
 		if (source.last_update != INVALID_DATE) source.last_update += interval;
-		for (NodeID node2 = 0; node2 < this->Size(); ++node2) {
-			BaseEdge &edge = this->edges[node1][node2];
+		for (BaseEdge &edge : this->edges[node1].edges) {
 			if (edge.last_unrestricted_update != INVALID_DATE) edge.last_unrestricted_update += interval;
 			if (edge.last_restricted_update != INVALID_DATE) edge.last_restricted_update += interval;
 		}
@@ -68,8 +97,7 @@ void LinkGraph::Compress()
 	this->last_compression = (_date + this->last_compression) / 2;
 	for (NodeID node1 = 0; node1 < this->Size(); ++node1) {
 		this->nodes[node1].supply /= 2;
-		for (NodeID node2 = 0; node2 < this->Size(); ++node2) {
-			BaseEdge &edge = this->edges[node1][node2];
+		for (BaseEdge &edge : this->edges[node1].edges) {
 			if (edge.capacity > 0) {
 				edge.capacity = max(1U, edge.capacity / 2);
 				edge.usage /= 2;
@@ -93,21 +121,16 @@ void LinkGraph::Merge(LinkGraph *other)
 		this->nodes[new_node].supply = LinkGraph::Scale(other->nodes[node1].supply, age, other_age);
 		st->goods[this->cargo].link_graph = this->index;
 		st->goods[this->cargo].node = new_node;
-		for (NodeID node2 = 0; node2 < node1; ++node2) {
-			BaseEdge &forward = this->edges[new_node][first + node2];
-			BaseEdge &backward = this->edges[first + node2][new_node];
-			forward = other->edges[node1][node2];
-			backward = other->edges[node2][node1];
-			forward.capacity = LinkGraph::Scale(forward.capacity, age, other_age);
-			forward.usage = LinkGraph::Scale(forward.usage, age, other_age);
-			if (forward.next_edge != INVALID_NODE) forward.next_edge += first;
-			backward.capacity = LinkGraph::Scale(backward.capacity, age, other_age);
-			backward.usage = LinkGraph::Scale(backward.usage, age, other_age);
-			if (backward.next_edge != INVALID_NODE) backward.next_edge += first;
+		/* All destinations are shifted by the same offset, so the edges stay sorted. */
+		BaseEdgeSet &new_edges = this->edges[new_node];
+		new_edges = std::move(other->edges[node1]);
+		for (BaseEdge &edge : new_edges.edges) {
+			edge.capacity = LinkGraph::Scale(edge.capacity, age, other_age);
+			edge.usage = LinkGraph::Scale(edge.usage, age, other_age);
+			edge.dest_node += first;
+			if (edge.next_edge != INVALID_NODE) edge.next_edge += first;
 		}
-		BaseEdge &new_start = this->edges[new_node][new_node];
-		new_start = other->edges[node1][node1];
-		if (new_start.next_edge != INVALID_NODE) new_start.next_edge += first;
+		if (new_edges.first_edge != INVALID_NODE) new_edges.first_edge += first;
 	}
 	delete other;
 }
@@ -123,28 +146,35 @@ void LinkGraph::RemoveNode(NodeID id)
 	NodeID last_node = this->Size() - 1;
 	for (NodeID i = 0; i <= last_node; ++i) {
 		(*this)[i].RemoveEdge(id);
-		BaseEdge *node_edges = this->edges[i];
-		NodeID prev = i;
-		NodeID next = node_edges[i].next_edge;
-		while (next != INVALID_NODE) {
-			if (next == last_node) {
-				node_edges[prev].next_edge = id;
-				break;
+		BaseEdgeSet &node_edges = this->edges[i];
+		BaseEdge *last_edge = node_edges.Find(last_node);
+		if (last_edge == nullptr) continue;
+
+		/* Rename the edge to the last node, which is moved to the removed one's place. */
+		if (node_edges.first_edge == last_node) {
+			node_edges.first_edge = id;
+		} else {
+			for (NodeID prev = node_edges.first_edge; prev != INVALID_NODE;) {
+				BaseEdge *prev_edge = node_edges.Find(prev);
+				if (prev_edge->next_edge == last_node) {
+					prev_edge->next_edge = id;
+					break;
+				}
+				prev = prev_edge->next_edge;
 			}
-			prev = next;
-			next = node_edges[prev].next_edge;
 		}
-		node_edges[id] = node_edges[last_node];
+		BaseEdge moved = *last_edge;
+		moved.dest_node = id;
+		node_edges.Erase(last_node);
+		node_edges.Insert(id) = moved;
 	}
 	Station::Get(this->nodes[last_node].station)->goods[this->cargo].node = id;
 	/* Erase node by swapping with the last element. Node index is referenced
 	 * directly from station goods entries so the order and position must remain. */
 	this->nodes[id] = this->nodes.back();
 	this->nodes.pop_back();
-	this->edges.EraseColumn(id);
-	/* Not doing EraseRow here, as having the extra invalid row doesn't hurt
-	 * and removing it would trigger a lot of memmove. The data has already
-	 * been copied around in the loop above. */
+	if (id != last_node) this->edges[id] = std::move(this->edges.back());
+	this->edges.pop_back();
 }
 
 /**
@@ -161,23 +191,11 @@ NodeID LinkGraph::AddNode(const Station *st)
 
 	NodeID new_node = this->Size();
 	this->nodes.emplace_back();
-	/* Avoid reducing the height of the matrix as that is expensive and we
-	 * most likely will increase it again later which is again expensive. */
-	this->edges.Resize(new_node + 1U,
-			max(new_node + 1U, this->edges.Height()));
+	this->edges.emplace_back();
 
 	this->nodes[new_node].Init(st->xy, st->index,
 			HasBit(good.status, GoodsEntry::GES_ACCEPTANCE));
 
-	BaseEdge *new_edges = this->edges[new_node];
-
-	/* Reset the first edge starting at the new node */
-	new_edges[new_node].next_edge = INVALID_NODE;
-
-	for (NodeID i = 0; i <= new_node; ++i) {
-		new_edges[i].Init();
-		this->edges[i][new_node].Init();
-	}
 	return new_node;
 }
 
@@ -192,12 +210,11 @@ NodeID LinkGraph::AddNode(const Station *st)
 void LinkGraph::Node::AddEdge(NodeID to, uint capacity, uint usage, EdgeUpdateMode mode)
 {
 	assert(this->index != to);
-	BaseEdge &edge = this->edges[to];
-	BaseEdge &first = this->edges[this->index];
+	BaseEdge &edge = this->edges.Insert(to);
 	edge.capacity = capacity;
 	edge.usage = usage;
-	edge.next_edge = first.next_edge;
-	first.next_edge = to;
+	edge.next_edge = this->edges.first_edge;
+	this->edges.first_edge = to;
 	if (mode & EUM_UNRESTRICTED)  edge.last_unrestricted_update = _date;
 	if (mode & EUM_RESTRICTED) edge.last_restricted_update = _date;
 }
@@ -213,10 +230,11 @@ void LinkGraph::Node::UpdateEdge(NodeID to, uint capacity, uint usage, EdgeUpdat
 {
 	assert(capacity > 0);
 	assert(usage <= capacity);
-	if (this->edges[to].capacity == 0) {
+	BaseEdge *edge = this->edges.Find(to);
+	if (edge == nullptr) {
 		this->AddEdge(to, capacity, usage, mode);
 	} else {
-		(*this)[to].Update(capacity, usage, mode);
+		Edge(*edge).Update(capacity, usage, mode);
 	}
 }
 
@@ -227,25 +245,23 @@ void LinkGraph::Node::UpdateEdge(NodeID to, uint capacity, uint usage, EdgeUpdat
 void LinkGraph::Node::RemoveEdge(NodeID to)
 {
 	if (this->index == to) return;
-	BaseEdge &edge = this->edges[to];
-	edge.capacity = 0;
-	edge.last_unrestricted_update = INVALID_DATE;
-	edge.last_restricted_update = INVALID_DATE;
-	edge.usage = 0;
+	BaseEdge *edge = this->edges.Find(to);
+	if (edge == nullptr) return;
 
-	NodeID prev = this->index;
-	NodeID next = this->edges[this->index].next_edge;
-	while (next != INVALID_NODE) {
-		if (next == to) {
-			/* Will be removed, skip it. */
-			this->edges[prev].next_edge = edge.next_edge;
-			edge.next_edge = INVALID_NODE;
-			break;
-		} else {
-			prev = next;
-			next = this->edges[next].next_edge;
+	if (this->edges.first_edge == to) {
+		this->edges.first_edge = edge->next_edge;
+	} else {
+		for (NodeID prev = this->edges.first_edge; prev != INVALID_NODE;) {
+			BaseEdge *prev_edge = this->edges.Find(prev);
+			if (prev_edge->next_edge == to) {
+				/* Will be removed, skip it. */
+				prev_edge->next_edge = edge->next_edge;
+				break;
+			}
+			prev = prev_edge->next_edge;
 		}
 	}
+	this->edges.Erase(to);
 }
 
 /**
@@ -274,19 +290,17 @@ void LinkGraph::Edge::Update(uint capacity, uint usage, EdgeUpdateMode mode)
 }
 
 /**
- * Resize the component and fill it with empty nodes and edges. Used when
+ * Resize the component and fill it with empty nodes without edges. Used when
  * loading from save games. The component is expected to be empty before.
  * @param size New size of the component.
  */
 void LinkGraph::Init(uint size)
 {
 	assert(this->Size() == 0);
-	this->edges.Resize(size, size);
+	this->edges.resize(size);
 	this->nodes.resize(size);
 
 	for (uint i = 0; i < size; ++i) {
 		this->nodes[i].Init();
-		BaseEdge *column = this->edges[i];
-		for (uint j = 0; j < size; ++j) column[j].Init();
 	}
 }
@@ -12,12 +12,13 @@
 
 #include "../core/pool_type.hpp"
 #include "../core/smallmap_type.hpp"
-#include "../core/smallmatrix_type.hpp"
 #include "../core/bitmath_func.hpp"
 #include "../station_base.h"
 #include "../cargotype.h"
 #include "../date_func.h"
 #include "linkgraph_type.h"
+#include <vector>
+#include <algorithm>
 
 struct SaveLoad;
 class LinkGraph;
@@ -54,10 +55,8 @@ public:
 	};
 
 	/**
-	 * An edge in the link graph. Corresponds to a link between two stations or at
-	 * least the distance between them. Edges from one node to itself contain the
-	 * ID of the opposite Node of the first active edge (i.e. not just distance) in
-	 * the column as next_edge.
+	 * An edge in the link graph. Corresponds to a link between two stations.
+	 * Only edges which actually have capacity are stored.
 	 */
 	struct BaseEdge {
 		uint capacity;                 ///< Capacity of the link.
@@ -65,7 +64,57 @@ public:
 		Date last_unrestricted_update; ///< When the unrestricted part of the link was last updated.
 		Date last_restricted_update;   ///< When the restricted part of the link was last updated.
 		NodeID next_edge;              ///< Destination of next valid edge starting at the same source node.
-		void Init();
+		NodeID dest_node;              ///< Destination of the edge.
+		void Init(NodeID dest = INVALID_NODE);
+	};
+
+	/**
+	 * Sparse set of the outgoing edges of a node. The edges are kept sorted by
+	 * destination so that they can be looked up by binary search. The order in
+	 * which they were added is kept as a chain of next_edge links, starting at
+	 * first_edge. That is the order they are iterated and saved in.
+	 */
+	struct BaseEdgeSet {
+		std::vector<BaseEdge> edges; ///< Edges sorted by destination node.
+		NodeID first_edge;           ///< Destination of the first edge in the chain.
+
+		BaseEdgeSet() : first_edge(INVALID_NODE) {}
+
+		/**
+		 * Find the edge to a specific node.
+		 * @param to Destination node.
+		 * @return Pointer to the edge or nullptr if there is none.
+		 */
+		inline const BaseEdge *Find(NodeID to) const
+		{
+			std::vector<BaseEdge>::const_iterator it = std::lower_bound(this->edges.begin(), this->edges.end(), to,
+					[](const BaseEdge &edge, NodeID to) { return edge.dest_node < to; });
+			return (it != this->edges.end() && it->dest_node == to) ? &*it : nullptr;
+		}
+
+		/**
+		 * Find the edge to a specific node.
+		 * @param to Destination node.
+		 * @return Pointer to the edge or nullptr if there is none.
+		 */
+		inline BaseEdge *Find(NodeID to)
+		{
+			return const_cast<BaseEdge *>(const_cast<const BaseEdgeSet *>(this)->Find(to));
+		}
+
+		/**
+		 * Get the edge to a specific node or an empty edge if there is none.
+		 * @param to Destination node.
+		 * @return Edge to the node.
+		 */
+		inline const BaseEdge &Get(NodeID to) const
+		{
+			const BaseEdge *edge = this->Find(to);
+			return edge != nullptr ? *edge : LinkGraph::empty_edge;
+		}
+
+		BaseEdge &Insert(NodeID to);
+		void Erase(NodeID to);
 	};
 
 	/**
@@ -118,15 +167,15 @@ public:
 
 	/**
 	 * Wrapper for a node (const or not) allowing retrieval, but no modification.
-	 * @tparam Tedge Actual node class, may be "const BaseNode" or just "BaseNode".
-	 * @tparam Tedge Actual edge class, may be "const BaseEdge" or just "BaseEdge".
+	 * @tparam Tnode Actual node class, may be "const BaseNode" or just "BaseNode".
+	 * @tparam Tedges Actual edge set class, may be "const BaseEdgeSet" or just "BaseEdgeSet".
 	 */
-	template<typename Tnode, typename Tedge>
+	template<typename Tnode, typename Tedges>
 	class NodeWrapper {
 	protected:
-		Tnode &node;  ///< Node being wrapped.
-		Tedge *edges; ///< Outgoing edges for wrapped node.
-		NodeID index; ///< ID of wrapped node.
+		Tnode &node;   ///< Node being wrapped.
+		Tedges &edges; ///< Outgoing edges for wrapped node.
+		NodeID index;  ///< ID of wrapped node.
 
 	public:
 
@@ -136,7 +185,7 @@ public:
 		 * @param edges Outgoing edges for node to be wrapped.
 		 * @param index ID of node to be wrapped.
 		 */
-		NodeWrapper(Tnode &node, Tedge *edges, NodeID index) : node(node),
+		NodeWrapper(Tnode &node, Tedges &edges, NodeID index) : node(node),
 			edges(edges), index(index) {}
 
 		/**
@@ -171,17 +220,18 @@ public:
 	};
 
 	/**
-	 * Base class for iterating across outgoing edges of a node. Only the real
-	 * edges (those with capacity) are iterated. The ones with only distance
-	 * information are skipped.
+	 * Base class for iterating across outgoing edges of a node, in the order
+	 * of their next_edge chain.
+	 * @tparam Tedges Actual edge set class. May be "BaseEdgeSet" or "const BaseEdgeSet".
 	 * @tparam Tedge Actual edge class. May be "BaseEdge" or "const BaseEdge".
 	 * @tparam Titer Actual iterator class.
 	 */
-	template <class Tedge, class Tedge_wrapper, class Titer>
+	template <class Tedges, class Tedge, class Tedge_wrapper, class Titer>
 	class BaseEdgeIterator {
 	protected:
-		Tedge *base;    ///< Array of edges being iterated.
-		NodeID current; ///< Current offset in edges array.
+		Tedges *base;   ///< Set of edges being iterated.
+		Tedge *edge;    ///< Current edge or nullptr if at the end.
+		NodeID current; ///< Destination of current edge.
 
 		/**
 		 * A "fake" pointer to enable operator-> on temporaries. As the objects
@@ -205,16 +255,26 @@ public:
 			SmallPair<NodeID, Tedge_wrapper> *operator->() { return this; }
 		};
 
+		/**
+		 * Advance to the given destination node.
+		 * @param next Destination of the next edge or INVALID_NODE.
+		 */
+		inline void Seek(NodeID next)
+		{
+			this->current = next;
+			this->edge = (next == INVALID_NODE) ? nullptr : this->base->Find(next);
+		}
+
 	public:
 		/**
 		 * Constructor.
-		 * @param base Array of edges to be iterated.
-		 * @param current ID of current node (to locate the first edge).
+		 * @param base Set of edges to be iterated.
+		 * @param current Destination of the first edge to be iterated or INVALID_NODE for the end.
 		 */
-		BaseEdgeIterator (Tedge *base, NodeID current) :
-			base(base),
-			current(current == INVALID_NODE ? current : base[current].next_edge)
-		{}
+		BaseEdgeIterator (Tedges *base, NodeID current) : base(base)
+		{
+			this->Seek(current);
+		}
 
 		/**
 		 * Prefix-increment.
@@ -222,7 +282,7 @@ public:
 		 */
 		Titer &operator++()
 		{
-			this->current = this->base[this->current].next_edge;
+			this->Seek(this->edge->next_edge);
 			return static_cast<Titer &>(*this);
 		}
 
@@ -233,7 +293,7 @@ public:
 		Titer operator++(int)
 		{
 			Titer ret(static_cast<Titer &>(*this));
-			this->current = this->base[this->current].next_edge;
+			this->Seek(this->edge->next_edge);
 			return ret;
 		}
 
@@ -242,7 +302,7 @@ public:
 		 * child class.
 		 * @tparam Tother Class of other iterator.
 		 * @param other Instance of other iterator.
-		 * @return If the iterators have the same edge array and current node.
+		 * @return If the iterators have the same edge set and current node.
 		 */
 		template<class Tother>
 		bool operator==(const Tother &other)
@@ -255,7 +315,7 @@ public:
 		 * may be of a child class.
 		 * @tparam Tother Class of other iterator.
 		 * @param other Instance of other iterator.
-		 * @return If either the edge arrays or the current nodes differ.
+		 * @return If either the edge sets or the current nodes differ.
 		 */
 		template<class Tother>
 		bool operator!=(const Tother &other)
@@ -269,7 +329,7 @@ public:
 		 */
 		SmallPair<NodeID, Tedge_wrapper> operator*() const
 		{
-			return SmallPair<NodeID, Tedge_wrapper>(this->current, Tedge_wrapper(this->base[this->current]));
+			return SmallPair<NodeID, Tedge_wrapper>(this->current, Tedge_wrapper(*this->edge));
 		}
 
 		/**
@@ -297,45 +357,45 @@ public:
 		 */
 		Edge(BaseEdge &edge) : EdgeWrapper<BaseEdge>(edge) {}
 		void Update(uint capacity, uint usage, EdgeUpdateMode mode);
-		void Restrict() { this->edge.last_unrestricted_update = INVALID_DATE; }
-		void Release() { this->edge.last_restricted_update = INVALID_DATE; }
+		void Restrict() { assert(this->edge.capacity > 0); this->edge.last_unrestricted_update = INVALID_DATE; }
+		void Release() { assert(this->edge.capacity > 0); this->edge.last_restricted_update = INVALID_DATE; }
 	};
 
 	/**
 	 * An iterator for const edges. Cannot be typedef'ed because of
 	 * template-reference to ConstEdgeIterator itself.
 	 */
-	class ConstEdgeIterator : public BaseEdgeIterator<const BaseEdge, ConstEdge, ConstEdgeIterator> {
+	class ConstEdgeIterator : public BaseEdgeIterator<const BaseEdgeSet, const BaseEdge, ConstEdge, ConstEdgeIterator> {
 	public:
 		/**
 		 * Constructor.
-		 * @param edges Array of edges to be iterated over.
+		 * @param edges Set of edges to be iterated over.
 		 * @param current ID of current edge's end node.
 		 */
-		ConstEdgeIterator(const BaseEdge *edges, NodeID current) :
-			BaseEdgeIterator<const BaseEdge, ConstEdge, ConstEdgeIterator>(edges, current) {}
+		ConstEdgeIterator(const BaseEdgeSet *edges, NodeID current) :
+			BaseEdgeIterator<const BaseEdgeSet, const BaseEdge, ConstEdge, ConstEdgeIterator>(edges, current) {}
 	};
 
 	/**
 	 * An iterator for non-const edges. Cannot be typedef'ed because of
 	 * template-reference to EdgeIterator itself.
 	 */
-	class EdgeIterator : public BaseEdgeIterator<BaseEdge, Edge, EdgeIterator> {
+	class EdgeIterator : public BaseEdgeIterator<BaseEdgeSet, BaseEdge, Edge, EdgeIterator> {
 	public:
 		/**
 		 * Constructor.
-		 * @param edges Array of edges to be iterated over.
+		 * @param edges Set of edges to be iterated over.
 		 * @param current ID of current edge's end node.
 		 */
-		EdgeIterator(BaseEdge *edges, NodeID current) :
-			BaseEdgeIterator<BaseEdge, Edge, EdgeIterator>(edges, current) {}
+		EdgeIterator(BaseEdgeSet *edges, NodeID current) :
+			BaseEdgeIterator<BaseEdgeSet, BaseEdge, Edge, EdgeIterator>(edges, current) {}
 	};
 
 	/**
 	 * Constant node class. Only retrieval operations are allowed on both the
 	 * node itself and its edges.
 	 */
-	class ConstNode : public NodeWrapper<const BaseNode, const BaseEdge> {
+	class ConstNode : public NodeWrapper<const BaseNode, const BaseEdgeSet> {
 	public:
 		/**
 		 * Constructor.
@@ -343,7 +403,7 @@ public:
 		 * @param node ID of the node.
 		 */
 		ConstNode(const LinkGraph *lg, NodeID node) :
-			NodeWrapper<const BaseNode, const BaseEdge>(lg->nodes[node], lg->edges[node], node)
+			NodeWrapper<const BaseNode, const BaseEdgeSet>(lg->nodes[node], lg->edges[node], node)
 		{}
 
 		/**
@@ -352,25 +412,25 @@ public:
 		 * @param to ID of end node of edge.
 		 * @return Constant edge wrapper.
 		 */
-		ConstEdge operator[](NodeID to) const { return ConstEdge(this->edges[to]); }
+		ConstEdge operator[](NodeID to) const { return ConstEdge(this->edges.Get(to)); }
 
 		/**
-		 * Get an iterator pointing to the start of the edges array.
+		 * Get an iterator pointing to the first edge.
 		 * @return Constant edge iterator.
 		 */
-		ConstEdgeIterator Begin() const { return ConstEdgeIterator(this->edges, this->index); }
+		ConstEdgeIterator Begin() const { return ConstEdgeIterator(&this->edges, this->edges.first_edge); }
 
 		/**
-		 * Get an iterator pointing beyond the end of the edges array.
+		 * Get an iterator pointing beyond the last edge.
 		 * @return Constant edge iterator.
 		 */
-		ConstEdgeIterator End() const { return ConstEdgeIterator(this->edges, INVALID_NODE); }
+		ConstEdgeIterator End() const { return ConstEdgeIterator(&this->edges, INVALID_NODE); }
 	};
 
 	/**
 	 * Updatable node class. The node itself as well as its edges can be modified.
 	 */
-	class Node : public NodeWrapper<BaseNode, BaseEdge> {
+	class Node : public NodeWrapper<BaseNode, BaseEdgeSet> {
 	public:
 		/**
 		 * Constructor.
@@ -378,28 +438,30 @@ public:
 		 * @param node ID of the node.
 		 */
 		Node(LinkGraph *lg, NodeID node) :
-			NodeWrapper<BaseNode, BaseEdge>(lg->nodes[node], lg->edges[node], node)
+			NodeWrapper<BaseNode, BaseEdgeSet>(lg->nodes[node], lg->edges[node], node)
 		{}
 
 		/**
-		 * Get an Edge. This is not a reference as the wrapper objects are not
-		 * actually persistent.
+		 * Get a constant Edge. This is not a reference as the wrapper objects
+		 * are not actually persistent. If there is no such edge an empty one
+		 * is returned. Edges can only be modified through UpdateEdge or the
+		 * edge iterators, which never point to the empty edge.
 		 * @param to ID of end node of edge.
-		 * @return Edge wrapper.
+		 * @return Constant edge wrapper.
 		 */
-		Edge operator[](NodeID to) { return Edge(this->edges[to]); }
+		ConstEdge operator[](NodeID to) const { return ConstEdge(this->edges.Get(to)); }
 
 		/**
-		 * Get an iterator pointing to the start of the edges array.
+		 * Get an iterator pointing to the first edge.
 		 * @return Edge iterator.
 		 */
-		EdgeIterator Begin() { return EdgeIterator(this->edges, this->index); }
+		EdgeIterator Begin() { return EdgeIterator(&this->edges, this->edges.first_edge); }
 
 		/**
-		 * Get an iterator pointing beyond the end of the edges array.
+		 * Get an iterator pointing beyond the last edge.
 		 * @return Constant edge iterator.
 		 */
-		EdgeIterator End() { return EdgeIterator(this->edges, INVALID_NODE); }
+		EdgeIterator End() { return EdgeIterator(&this->edges, INVALID_NODE); }
 
 		/**
 		 * Update the node's supply and set last_update to the current date.
@@ -435,7 +497,7 @@ public:
 	};
 
 	typedef std::vector<BaseNode> NodeVector;
-	typedef SmallMatrix<BaseEdge> EdgeMatrix;
+	typedef std::vector<BaseEdgeSet> EdgeSetVector;
 
 	/** Minimum effective distance for timeout calculation. */
 	static const uint MIN_TIMEOUT_DISTANCE = 32;
@@ -443,6 +505,9 @@ public:
 	/** Minimum number of days between subsequent compressions of a LG. */
 	static const uint COMPRESSION_INTERVAL = 256;
 
+	/** Empty edge returned when looking up edges which don't exist. */
+	static const BaseEdge empty_edge;
+
 	/**
 	 * Scale a value from a link graph of age orig_age for usage in one of age
 	 * target_age. Make sure that the value stays > 0 if it was > 0 before.
@@ -530,6 +595,7 @@ public:
 protected:
 	friend class LinkGraph::ConstNode;
 	friend class LinkGraph::Node;
+	friend class LinkGraphJob;
 	friend const SaveLoad *GetLinkGraphDesc();
 	friend const SaveLoad *GetLinkGraphJobDesc();
 	friend void Save_LinkGraph(LinkGraph &lg);
@@ -538,7 +604,7 @@ protected:
 	CargoID cargo;         ///< Cargo of this component's link graph.
 	Date last_compression; ///< Last time the capacities and supplies were compressed.
 	NodeVector nodes;      ///< Nodes in the component.
-	EdgeMatrix edges;      ///< Edges in the component.
+	EdgeSetVector edges;   ///< Outgoing edges of each node in the component.
 };
 
 #endif /* LINKGRAPH_H */
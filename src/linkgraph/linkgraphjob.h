@@ -32,15 +32,77 @@ extern LinkGraphJobPool _link_graph_job_pool;
 class LinkGraphJob : public LinkGraphJobPool::PoolItem<&_link_graph_job_pool>{
 private:
 	/**
-	 * Annotation for a link graph edge.
+	 * Annotation for a link graph edge. There is one for each edge in the
+	 * link graph, in the same order as the edges of its source node.
 	 */
 	struct EdgeAnnotation {
-		uint demand;             ///< Transport demand between the nodes.
-		uint unsatisfied_demand; ///< Demand over this edge that hasn't been satisfied yet.
 		uint flow;               ///< Planned flow over this edge.
 		void Init();
 	};
 
+public:
+	/**
+	 * Transport demand between two nodes. Only pairs of nodes which actually
+	 * have demand between them are stored.
+	 */
+	class DemandAnnotation {
+	private:
+		NodeID dest;             ///< Destination of the demand.
+		uint demand;             ///< Transport demand between the nodes.
+		uint unsatisfied_demand; ///< Demand that hasn't been satisfied yet.
+
+	public:
+		/**
+		 * Create an empty demand.
+		 * @param dest Destination node.
+		 */
+		DemandAnnotation(NodeID dest) : dest(dest), demand(0), unsatisfied_demand(0) {}
+
+		/**
+		 * Get the destination of the demand.
+		 * @return Destination node.
+		 */
+		NodeID Destination() const { return this->dest; }
+
+		/**
+		 * Get the transport demand between the nodes.
+		 * @return Demand.
+		 */
+		uint Demand() const { return this->demand; }
+
+		/**
+		 * Get the transport demand that hasn't been satisfied by flows, yet.
+		 * @return Unsatisfied demand.
+		 */
+		uint UnsatisfiedDemand() const { return this->unsatisfied_demand; }
+
+		/**
+		 * Add some (not yet satisfied) demand.
+		 * @param demand Demand to be added.
+		 */
+		void AddDemand(uint demand)
+		{
+			this->demand += demand;
+			this->unsatisfied_demand += demand;
+		}
+
+		/**
+		 * Satisfy some demand.
+		 * @param demand Demand to be satisfied.
+		 */
+		void SatisfyDemand(uint demand)
+		{
+			assert(demand <= this->unsatisfied_demand);
+			this->unsatisfied_demand -= demand;
+		}
+	};
+
+	/** Demands of a node, sorted by destination. */
+	typedef std::vector<DemandAnnotation> DemandAnnotationVector;
+
+private:
+	typedef std::vector<EdgeAnnotation> EdgeAnnotationVector;
+
 	/**
 	 * Annotation for a link graph node.
 	 */
@@ -49,11 +111,12 @@ private:
 		uint received_demand;    ///< Received demand towards this node.
 		PathList paths;          ///< Paths through this node, sorted so that those with flow == 0 are in the back.
 		FlowStatMap flows;       ///< Planned flows to other nodes.
+		EdgeAnnotationVector edges;     ///< Annotations of the outgoing edges.
+		DemandAnnotationVector demands; ///< Demands towards other nodes.
 		void Init(uint supply);
 	};
 
 	typedef std::vector<NodeAnnotation> NodeAnnotationVector;
-	typedef SmallMatrix<EdgeAnnotation> EdgeAnnotationMatrix;
 
 	friend const SaveLoad *GetLinkGraphJobDesc();
 	friend void GetLinkGraphJobDayLengthScaleAfterLoad(LinkGraphJob *lgj);
@@ -66,8 +129,7 @@ protected:
 	const LinkGraphSettings settings; ///< Copy of _settings_game.linkgraph at spawn time.
 	DateTicks join_date_ticks;        ///< Date when the job is to be joined.
 	DateTicks start_date_ticks;       ///< Date when the job was started.
-	NodeAnnotationVector nodes;       ///< Extra node data necessary for link graph calculation.
-	EdgeAnnotationMatrix edges;       ///< Extra edge data necessary for link graph calculation.
+	NodeAnnotationVector nodes;       ///< Extra node and edge data necessary for link graph calculation.
 	bool job_completed;               ///< Is the job still running. This is accessed by multiple threads and is permitted to be spuriously incorrect.
 	bool abort_job;                   ///< Abort the job at the next available opportunity. This is accessed by multiple threads.
 
@@ -97,18 +159,6 @@ public:
 		Edge(const LinkGraph::BaseEdge &edge, EdgeAnnotation &anno) :
 				LinkGraph::ConstEdge(edge), anno(anno) {}
 
-		/**
-		 * Get the transport demand between end the points of the edge.
-		 * @return Demand.
-		 */
-		uint Demand() const { return this->anno.demand; }
-
-		/**
-		 * Get the transport demand that hasn't been satisfied by flows, yet.
-		 * @return Unsatisfied demand.
-		 */
-		uint UnsatisfiedDemand() const { return this->anno.unsatisfied_demand; }
-
 		/**
 		 * Get the total flow on the edge.
 		 * @return Flow.
@@ -130,42 +180,22 @@ public:
 			assert(flow <= this->anno.flow);
 			this->anno.flow -= flow;
 		}
-
-		/**
-		 * Add some (not yet satisfied) demand.
-		 * @param demand Demand to be added.
-		 */
-		void AddDemand(uint demand)
-		{
-			this->anno.demand += demand;
-			this->anno.unsatisfied_demand += demand;
-		}
-
-		/**
-		 * Satisfy some demand.
-		 * @param demand Demand to be satisfied.
-		 */
-		void SatisfyDemand(uint demand)
-		{
-			assert(demand <= this->anno.unsatisfied_demand);
-			this->anno.unsatisfied_demand -= demand;
-		}
 	};
 
 	/**
 	 * Iterator for job edges.
 	 */
-	class EdgeIterator : public LinkGraph::BaseEdgeIterator<const LinkGraph::BaseEdge, Edge, EdgeIterator> {
-		EdgeAnnotation *base_anno; ///< Array of annotations to be (indirectly) iterated.
+	class EdgeIterator : public LinkGraph::BaseEdgeIterator<const LinkGraph::BaseEdgeSet, const LinkGraph::BaseEdge, Edge, EdgeIterator> {
+		EdgeAnnotation *base_anno; ///< Array of annotations to be iterated, in the same order as the edges.
 	public:
 		/**
 		 * Constructor.
-		 * @param base Array of edges to be iterated.
+		 * @param base Set of edges to be iterated.
 		 * @param base_anno Array of annotations to be iterated.
-		 * @param current Start offset of iteration.
+		 * @param current Destination of the first edge to be iterated or INVALID_NODE for the end.
 		 */
-		EdgeIterator(const LinkGraph::BaseEdge *base, EdgeAnnotation *base_anno, NodeID current) :
-				LinkGraph::BaseEdgeIterator<const LinkGraph::BaseEdge, Edge, EdgeIterator>(base, current),
+		EdgeIterator(const LinkGraph::BaseEdgeSet *base, EdgeAnnotation *base_anno, NodeID current) :
+				LinkGraph::BaseEdgeIterator<const LinkGraph::BaseEdgeSet, const LinkGraph::BaseEdge, Edge, EdgeIterator>(base, current),
 				base_anno(base_anno) {}
 
 		/**
@@ -175,7 +205,7 @@ public:
 		 */
 		SmallPair<NodeID, Edge> operator*() const
 		{
-			return SmallPair<NodeID, Edge>(this->current, Edge(this->base[this->current], this->base_anno[this->current]));
+			return SmallPair<NodeID, Edge>(this->current, Edge(*this->edge, this->base_anno[this->edge - this->base->edges.data()]));
 		}
 
 		/**
@@ -205,30 +235,35 @@ public:
 		 */
 		Node (LinkGraphJob *lgj, NodeID node) :
 			LinkGraph::ConstNode(&lgj->link_graph, node),
-			node_anno(lgj->nodes[node]), edge_annos(lgj->edges[node])
+			node_anno(lgj->nodes[node]), edge_annos(lgj->nodes[node].edges.data())
 		{}
 
 		/**
 		 * Retrieve an edge starting at this node. Mind that this returns an
-		 * object, not a reference.
+		 * object, not a reference. The edge has to exist.
 		 * @param to Remote end of the edge.
 		 * @return Edge between this node and "to".
 		 */
-		Edge operator[](NodeID to) const { return Edge(this->edges[to], this->edge_annos[to]); }
+		Edge operator[](NodeID to) const
+		{
+			const LinkGraph::BaseEdge *edge = this->edges.Find(to);
+			assert(edge != nullptr);
+			return Edge(*edge, this->edge_annos[edge - this->edges.edges.data()]);
+		}
 
 		/**
 		 * Iterator for the "begin" of the edge array. Only edges with capacity
 		 * are iterated. The others are skipped.
 		 * @return Iterator pointing to the first edge.
 		 */
-		EdgeIterator Begin() const { return EdgeIterator(this->edges, this->edge_annos, index); }
+		EdgeIterator Begin() const { return EdgeIterator(&this->edges, this->edge_annos, this->edges.first_edge); }
 
 		/**
 		 * Iterator for the "end" of the edge array. Only edges with capacity
 		 * are iterated. The others are skipped.
 		 * @return Iterator pointing beyond the last edge.
 		 */
-		EdgeIterator End() const { return EdgeIterator(this->edges, this->edge_annos, INVALID_NODE); }
+		EdgeIterator End() const { return EdgeIterator(&this->edges, this->edge_annos, INVALID_NODE); }
 
 		/**
 		 * Get amount of supply that hasn't been delivered, yet.
@@ -267,6 +302,18 @@ public:
 		 */
 		const PathList &Paths() const { return this->node_anno.paths; }
 
+		/**
+		 * Get the demands from this node to other nodes, sorted by destination.
+		 * @return Demands.
+		 */
+		DemandAnnotationVector &Demands() { return this->node_anno.demands; }
+
+		/**
+		 * Get a constant version of the demands from this node.
+		 * @return Demands.
+		 */
+		const DemandAnnotationVector &Demands() const { return this->node_anno.demands; }
+
 		/**
 		 * Deliver some supply, adding demand to the respective edge.
 		 * @param to Destination for supply.
@@ -274,8 +321,12 @@ public:
 		 */
 		void DeliverSupply(NodeID to, uint amount)
 		{
+			DemandAnnotationVector &demands = this->node_anno.demands;
+			DemandAnnotationVector::iterator it = std::lower_bound(demands.begin(), demands.end(), to,
+					[](const DemandAnnotation &demand, NodeID to) { return demand.Destination() < to; });
+			if (it == demands.end() || it->Destination() != to) it = demands.emplace(it, to);
 			this->node_anno.undelivered_supply -= amount;
-			(*this)[to].AddDemand(amount);
+			it->AddDemand(amount);
 		}
 
 		/**
@@ -230,10 +230,11 @@ LinkGraphJobGroup::LinkGraphJobGroup(constructor_token token, std::vector<LinkGr
 void LinkGraphJobGroup::SpawnThread()
 {
 	/**
-	 * Spawn a thread if possible and run the link graph job in the thread. If
+	 * Queue the link graph job in the worker thread pool if possible. If
 	 * that's not possible run the job right now in the current thread.
 	 */
-	if (StartNewThread(&this->thread, "ottd:linkgraph", &(LinkGraphJobGroup::Run), this)) {
+	this->task = _worker_pool.Enqueue(WTP_BACKGROUND, "ottd:linkgraph", [this]() { LinkGraphJobGroup::Run(this); });
+	if (this->task != nullptr) {
 		for (auto &it : this->jobs) {
 			it->SetJobGroup(this->shared_from_this());
 		}
@@ -251,8 +252,9 @@ void LinkGraphJobGroup::SpawnThread()
 
 void LinkGraphJobGroup::JoinThread()
 {
-	if (this->thread.joinable()) {
-		this->thread.join();
+	if (this->task != nullptr) {
+		this->task->Wait();
+		this->task.reset();
 	}
 }
 
@@ -10,7 +10,7 @@
 #ifndef LINKGRAPHSCHEDULE_H
 #define LINKGRAPHSCHEDULE_H
 
-#include "../thread.h"
+#include "../worker_thread.h"
 #include "linkgraph.h"
 #include <memory>
 
@@ -83,7 +83,7 @@ class LinkGraphJobGroup : public std::enable_shared_from_this<LinkGraphJobGroup>
 	friend LinkGraphJob;
 
 private:
-	std::thread thread;                      ///< Thread the job group is running in or nullptr if it's running in the main thread.
+	WorkerTaskPtr task;                      ///< Worker task the job group is running in or nullptr if it's running in the main thread.
 	const std::vector<LinkGraphJob *> jobs;  ///< The set of jobs in this job set
 
 private:
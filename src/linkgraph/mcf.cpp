@@ -4,7 +4,10 @@
 #include "../core/math_func.hpp"
 #include "mcf.h"
 #include "../3rdparty/cpp-btree/btree_map.h"
+#include "../settings_type.h"
+#include "../worker_thread.h"
 #include <set>
+#include <atomic>
 
 #include "../safeguards.h"
 
@@ -41,6 +44,16 @@ public:
 	 */
 	DistanceAnnotation(NodeID n, bool source = false) : Path(n, source) {}
 
+	/**
+	 * Copy constructor which attaches the copy to a different parent.
+	 * @param other Annotation to be copied.
+	 * @param parent Parent of the copy, which replaces other's parent.
+	 */
+	DistanceAnnotation(const DistanceAnnotation &other, Path *parent) : Path(other)
+	{
+		this->SetParent(parent);
+	}
+
 	bool IsBetter(const DistanceAnnotation *base, uint cap, int free_cap, uint dist) const;
 
 	/**
@@ -270,11 +283,14 @@ bool CapacityAnnotation::IsBetter(const CapacityAnnotation *base, uint cap,
  * setting to artificially decrease capacities.
  * @tparam Tannotation Annotation to be used.
  * @tparam Tedge_iterator Iterator to be used for getting outgoing edges.
+ * This only reads from the job, so it may be run concurrently for different
+ * sources as long as each run has its own allocator.
  * @param source_node Node where the algorithm starts.
  * @param paths Container for the paths to be calculated.
+ * @param allocator Allocator for the paths.
  */
 template<class Tannotation, class Tedge_iterator>
-void MultiCommodityFlow::Dijkstra(NodeID source_node, PathVector &paths)
+void MultiCommodityFlow::Dijkstra(NodeID source_node, PathVector &paths, DynUniformArenaAllocator &allocator)
 {
 	typedef btree::btree_set<AnnoSetItem<Tannotation>, typename Tannotation::Comparator> AnnoSet;
 	AnnoSet annos = AnnoSet(typename Tannotation::Comparator());
@@ -282,10 +298,10 @@ void MultiCommodityFlow::Dijkstra(NodeID source_node, PathVector &paths)
 	uint size = this->job.Size();
 	paths.resize(size, nullptr);
 
-	this->job.path_allocator.SetParameters(sizeof(Tannotation), (8192 - 32) / sizeof(Tannotation));
+	allocator.SetParameters(sizeof(Tannotation), (8192 - 32) / sizeof(Tannotation));
 
 	for (NodeID node = 0; node < size; ++node) {
-		Tannotation *anno = new (this->job.path_allocator.Allocate()) Tannotation(node, node == source_node);
+		Tannotation *anno = new (allocator.Allocate()) Tannotation(node, node == source_node);
 		anno->UpdateAnnotation();
 		if (node == source_node) {
 			annos.insert(AnnoSetItem<Tannotation>(anno)).first;
@@ -350,21 +366,20 @@ void MultiCommodityFlow::CleanupPaths(NodeID source_id, PathVector &paths)
 }
 
 /**
- * Push flow along a path and update the unsatisfied_demand of the associated
- * edge.
- * @param edge Edge whose ends the path connects.
+ * Push flow along a path and update the unsatisfied demand it satisfies.
+ * @param demand Demand between the ends of the path.
  * @param path End of the path the flow should be pushed on.
  * @param accuracy Accuracy of the calculation.
  * @param max_saturation If < UINT_MAX only push flow up to the given
  *                       saturation, otherwise the path can be "overloaded".
  */
-uint MultiCommodityFlow::PushFlow(Edge &edge, Path *path, uint accuracy,
+uint MultiCommodityFlow::PushFlow(DemandAnnotation &demand, Path *path, uint accuracy,
 		uint max_saturation)
 {
-	assert(edge.UnsatisfiedDemand() > 0);
-	uint flow = Clamp(edge.Demand() / accuracy, 1, edge.UnsatisfiedDemand());
+	assert(demand.UnsatisfiedDemand() > 0);
+	uint flow = Clamp(demand.Demand() / accuracy, 1, demand.UnsatisfiedDemand());
 	flow = path->AddFlow(flow, this->job, max_saturation);
-	edge.SatisfyDemand(flow);
+	demand.SatisfyDemand(flow);
 	return flow;
 }
 
@@ -513,6 +528,165 @@ bool MCF1stPass::EliminateCycles()
 	return cycles_found;
 }
 
+/**
+ * Push flow from a source along the shortest paths found for it and clean up
+ * the paths afterwards.
+ * @param source Source node.
+ * @param paths Paths found by Dijkstra for the source.
+ * @param accuracy Accuracy of the calculation.
+ * @param more_loops Set to true if more flow might be assigned in another loop.
+ * @return If there is any unsatisfied demand left at the source.
+ */
+bool MCF1stPass::SaturatePaths(NodeID source, PathVector &paths, uint accuracy, bool &more_loops)
+{
+	bool source_demand_left = false;
+	for (DemandAnnotation &demand : this->job[source].Demands()) {
+		if (demand.UnsatisfiedDemand() > 0) {
+			Path *path = paths[demand.Destination()];
+			assert(path != nullptr);
+			/* Generally only allow paths that don't exceed the
+			 * available capacity. But if no demand has been assigned
+			 * yet, make an exception and allow any valid path *once*. */
+			if (path->GetFreeCapacity() > 0 && this->PushFlow(demand, path,
+					accuracy, this->max_saturation) > 0) {
+				/* If a path has been found there is a chance we can
+				 * find more. */
+				more_loops = more_loops || (demand.UnsatisfiedDemand() > 0);
+			} else if (demand.UnsatisfiedDemand() == demand.Demand() &&
+					path->GetFreeCapacity() > INT_MIN) {
+				this->PushFlow(demand, path, accuracy, UINT_MAX);
+			}
+			if (demand.UnsatisfiedDemand() > 0) source_demand_left = true;
+		}
+	}
+	this->CleanupPaths(source, paths);
+	return source_demand_left;
+}
+
+/**
+ * Determine for each edge whether it has any capacity left, in the same way
+ * Dijkstra does with DistanceAnnotation. The shortest paths only depend on
+ * that, not on the exact amount of free capacity.
+ * @param saturation Output vector, filled with one entry per edge.
+ */
+void MCF1stPass::GetSaturation(std::vector<bool> &saturation)
+{
+	saturation.clear();
+	uint size = this->job.Size();
+	for (NodeID from = 0; from < size; ++from) {
+		Node node = this->job[from];
+		for (EdgeIterator it(node.Begin()); it != node.End(); ++it) {
+			uint capacity = it->second.Capacity();
+			if (this->max_saturation != UINT_MAX) {
+				capacity *= this->max_saturation;
+				capacity /= 100;
+				if (capacity == 0) capacity = 1;
+			}
+			saturation.push_back((int)(capacity - it->second.Flow()) > 0);
+		}
+	}
+}
+
+/**
+ * Copy paths found on a worker thread into the job's allocator, in the same
+ * order Dijkstra would have allocated them, and release the originals.
+ * @param from Paths to be copied.
+ * @param from_allocator Allocator the paths to be copied were allocated from.
+ * @param paths Output vector for the copied paths.
+ */
+void MCF1stPass::AdoptPaths(PathVector &from, DynUniformArenaAllocator &from_allocator, PathVector &paths)
+{
+	uint size = (uint)from.size();
+	paths.resize(size, nullptr);
+	this->job.path_allocator.SetParameters(sizeof(DistanceAnnotation), (8192 - 32) / sizeof(DistanceAnnotation));
+	for (NodeID node = 0; node < size; ++node) {
+		paths[node] = static_cast<Path *>(this->job.path_allocator.Allocate());
+	}
+	for (NodeID node = 0; node < size; ++node) {
+		Path *parent = from[node]->GetParent();
+		new (paths[node]) DistanceAnnotation(*static_cast<DistanceAnnotation *>(from[node]),
+				parent != nullptr ? paths[parent->GetNode()] : nullptr);
+	}
+	for (Path *path : from) from_allocator.Free(path);
+	from.clear();
+}
+
+/** Result of a path search run speculatively on a worker thread. */
+struct SpeculativePaths {
+	NodeID source;                      ///< Source node of the search.
+	PathVector paths;                   ///< Paths found.
+	DynUniformArenaAllocator allocator; ///< Allocator for the paths.
+};
+
+/**
+ * Run one loop over all sources of the first pass with the path searches
+ * spread over multiple threads. The searches for a batch of sources are run
+ * concurrently against the current flows and then consumed in source order,
+ * as long as no edge has changed between having and not having free capacity
+ * since the batch started. As the searches only depend on that, the results
+ * are identical to those of the serial loop. The rest of a batch is discarded
+ * as soon as that isn't the case anymore.
+ * @param finished_sources Sources which don't have any demand left.
+ * @param num_threads Number of threads to use.
+ * @return If more flow might be assigned in another loop.
+ */
+bool MCF1stPass::RunParallel(std::vector<bool> &finished_sources, uint num_threads)
+{
+	uint size = this->job.Size();
+	uint accuracy = this->job.Settings().accuracy;
+	bool more_loops = false;
+	PathVector paths;
+	std::vector<SpeculativePaths> batch(num_threads);
+	std::vector<bool> saturation;
+	std::vector<bool> current_saturation;
+
+	NodeID source = 0;
+	while (source < size) {
+		uint count = 0;
+		for (; source < size && count < num_threads; ++source) {
+			if (!finished_sources[source]) batch[count++].source = source;
+		}
+		if (count == 0) break;
+
+		this->GetSaturation(saturation);
+		std::atomic<uint> next(0);
+		auto search = [&]() {
+			for (uint i = next++; i < count; i = next++) {
+				this->Dijkstra<DistanceAnnotation, GraphEdgeIterator>(batch[i].source, batch[i].paths, batch[i].allocator);
+			}
+		};
+		std::vector<WorkerTaskPtr> tasks;
+		for (uint i = 1; i < count; ++i) {
+			WorkerTaskPtr task = _worker_pool.Enqueue(WTP_NORMAL, "ottd:lg-mcf", search);
+			if (task == nullptr) break;
+			tasks.push_back(std::move(task));
+		}
+		search();
+		for (WorkerTaskPtr &task : tasks) task->Wait();
+
+		bool valid = true;
+		for (uint i = 0; i < count; ++i) {
+			SpeculativePaths &result = batch[i];
+			if (valid && i > 0) {
+				this->GetSaturation(current_saturation);
+				if (current_saturation != saturation) {
+					/* Search again, starting with this source. */
+					valid = false;
+					source = result.source;
+				}
+			}
+			if (!valid) {
+				for (Path *path : result.paths) result.allocator.Free(path);
+				result.paths.clear();
+				continue;
+			}
+			this->AdoptPaths(result.paths, result.allocator, paths);
+			if (!this->SaturatePaths(result.source, paths, accuracy, more_loops)) finished_sources[result.source] = true;
+		}
+	}
+	return more_loops;
+}
+
 /**
  * Run the first pass of the MCF calculation.
  * @param job Link graph job to calculate.
@@ -522,41 +696,23 @@ MCF1stPass::MCF1stPass(LinkGraphJob &job) : MultiCommodityFlow(job)
 	PathVector paths;
 	uint size = job.Size();
 	uint accuracy = job.Settings().accuracy;
+	uint num_threads = min<uint>(_settings_client.gui.linkgraph_mcf_threads, size);
 	bool more_loops;
 	std::vector<bool> finished_sources;
 	finished_sources.resize(size);
 
 	do {
 		more_loops = false;
-		for (NodeID source = 0; source < size; ++source) {
-			if (finished_sources[source]) continue;
-
-			/* First saturate the shortest paths. */
-			this->Dijkstra<DistanceAnnotation, GraphEdgeIterator>(source, paths);
+		if (num_threads > 1) {
+			more_loops = this->RunParallel(finished_sources, num_threads);
+		} else {
+			for (NodeID source = 0; source < size; ++source) {
+				if (finished_sources[source]) continue;
 
-			bool source_demand_left = false;
-			for (NodeID dest = 0; dest < size; ++dest) {
-				Edge edge = job[source][dest];
-				if (edge.UnsatisfiedDemand() > 0) {
-					Path *path = paths[dest];
-					assert(path != nullptr);
-					/* Generally only allow paths that don't exceed the
-					 * available capacity. But if no demand has been assigned
-					 * yet, make an exception and allow any valid path *once*. */
-					if (path->GetFreeCapacity() > 0 && this->PushFlow(edge, path,
-							accuracy, this->max_saturation) > 0) {
-						/* If a path has been found there is a chance we can
-						 * find more. */
-						more_loops = more_loops || (edge.UnsatisfiedDemand() > 0);
-					} else if (edge.UnsatisfiedDemand() == edge.Demand() &&
-							path->GetFreeCapacity() > INT_MIN) {
-						this->PushFlow(edge, path, accuracy, UINT_MAX);
-					}
-					if (edge.UnsatisfiedDemand() > 0) source_demand_left = true;
-				}
+				/* First saturate the shortest paths. */
+				this->Dijkstra<DistanceAnnotation, GraphEdgeIterator>(source, paths, job.path_allocator);
+				if (!this->SaturatePaths(source, paths, accuracy, more_loops)) finished_sources[source] = true;
 			}
-			if (!source_demand_left) finished_sources[source] = true;
-			this->CleanupPaths(source, paths);
 		}
 	} while ((more_loops || this->EliminateCycles()) && !job.IsJobAborted());
 }
@@ -580,15 +736,14 @@ MCF2ndPass::MCF2ndPass(LinkGraphJob &job) : MultiCommodityFlow(job)
 		for (NodeID source = 0; source < size; ++source) {
 			if (finished_sources[source]) continue;
 
-			this->Dijkstra<CapacityAnnotation, FlowEdgeIterator>(source, paths);
+			this->Dijkstra<CapacityAnnotation, FlowEdgeIterator>(source, paths, job.path_allocator);
 
 			bool source_demand_left = false;
-			for (NodeID dest = 0; dest < size; ++dest) {
-				Edge edge = this->job[source][dest];
-				Path *path = paths[dest];
-				if (edge.UnsatisfiedDemand() > 0 && path->GetFreeCapacity() > INT_MIN) {
-					this->PushFlow(edge, path, accuracy, UINT_MAX);
-					if (edge.UnsatisfiedDemand() > 0) {
+			for (DemandAnnotation &demand : this->job[source].Demands()) {
+				Path *path = paths[demand.Destination()];
+				if (demand.UnsatisfiedDemand() > 0 && path->GetFreeCapacity() > INT_MIN) {
+					this->PushFlow(demand, path, accuracy, UINT_MAX);
+					if (demand.UnsatisfiedDemand() > 0) {
 						demand_left = true;
 						source_demand_left = true;
 					}
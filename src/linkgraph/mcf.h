@@ -22,9 +22,9 @@ protected:
 	{}
 
 	template<class Tannotation, class Tedge_iterator>
-	void Dijkstra(NodeID from, PathVector &paths);
+	void Dijkstra(NodeID from, PathVector &paths, DynUniformArenaAllocator &allocator);
 
-	uint PushFlow(Edge &edge, Path *path, uint accuracy, uint max_saturation);
+	uint PushFlow(DemandAnnotation &demand, Path *path, uint accuracy, uint max_saturation);
 
 	void CleanupPaths(NodeID source, PathVector &paths);
 
@@ -34,7 +34,9 @@ protected:
 
 /**
  * First pass of the MCF calculation. Saturates shortest paths first, creates
- * new paths if needed, eliminates cycles. This calculation is of exponential
+ * new paths if needed, eliminates cycles. The path searches can optionally be
+ * run speculatively on multiple threads; see MCF1stPass::RunParallel.
+ * This calculation is of exponential
  * complexity in the number of nodes but the constant factors are sufficiently
  * small to make it usable for most real-life link graph components. You can
  * deal with performance problems that might occur here in multiple ways:
@@ -53,6 +55,10 @@ private:
 	bool EliminateCycles(PathVector &path, NodeID origin_id, NodeID next_id);
 	void EliminateCycle(PathVector &path, Path *cycle_begin, uint flow);
 	uint FindCycleFlow(const PathVector &path, const Path *cycle_begin);
+	bool SaturatePaths(NodeID source, PathVector &paths, uint accuracy, bool &more_loops);
+	void GetSaturation(std::vector<bool> &saturation);
+	void AdoptPaths(PathVector &from, DynUniformArenaAllocator &from_allocator, PathVector &paths);
+	bool RunParallel(std::vector<bool> &finished_sources, uint num_threads);
 public:
 	MCF1stPass(LinkGraphJob &job);
 };
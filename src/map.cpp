@@ -10,12 +10,17 @@
 #include "stdafx.h"
 #include "debug.h"
 #include "core/alloc_func.hpp"
+#include "core/mem_func.hpp"
 #include "water_map.h"
 #include "string_func.h"
 #include "rail_map.h"
 #include "tunnelbridge_map.h"
+#include "landscape.h"
+#include "openttd.h"
+#include "pathfinder/water_regions.h"
 #include "3rdparty/cpp-btree/btree_map.h"
 #include <array>
+#include <chrono>
 
 #include "safeguards.h"
 
@@ -31,8 +36,42 @@ uint _map_size_y;    ///< Size of the map along the Y
 uint _map_size;      ///< The number of tiles on the map
 uint _map_tile_mask; ///< _map_size - 1 (to mask the mapsize)
 
+#ifdef WITH_MAP_SOA
+TilePlanes _m = {};          ///< Tiles of the map
+TileExtendedPlanes _me = {}; ///< Extended Tiles of the map
+static byte *_map_planes;    ///< Single allocation holding all planes of the map
+
+/**
+ * Clear a range of tiles.
+ * @param begin The first tile to clear.
+ * @param count The number of tiles to clear.
+ */
+void TilePlanes::Clear(TileIndex begin, uint count)
+{
+	MemSetT(this->type + begin, 0, count);
+	MemSetT(this->height + begin, 0, count);
+	MemSetT(this->m2 + begin, 0, count);
+	MemSetT(this->m1 + begin, 0, count);
+	MemSetT(this->m3 + begin, 0, count);
+	MemSetT(this->m4 + begin, 0, count);
+	MemSetT(this->m5 + begin, 0, count);
+}
+
+/**
+ * Clear a range of extended tiles.
+ * @param begin The first tile to clear.
+ * @param count The number of tiles to clear.
+ */
+void TileExtendedPlanes::Clear(TileIndex begin, uint count)
+{
+	MemSetT(this->m6 + begin, 0, count);
+	MemSetT(this->m7 + begin, 0, count);
+	MemSetT(this->m8 + begin, 0, count);
+}
+#else
 Tile *_m = nullptr;          ///< Tiles of the map
 TileExtended *_me = nullptr; ///< Extended Tiles of the map
+#endif /* WITH_MAP_SOA */
 
 /**
  * Validates whether a map with the given dimension is valid
@@ -75,11 +114,33 @@ void AllocateMap(uint size_x, uint size_y)
 	_map_size = size_x * size_y;
 	_map_tile_mask = _map_size - 1;
 
+#ifdef WITH_MAP_SOA
+	free(_map_planes);
+
+	/* The 16 bit planes come first, so they are aligned. */
+	_map_planes = CallocT<byte>(_map_size * (sizeof(Tile) + sizeof(TileExtended)));
+	byte *plane = _map_planes;
+	_m.m2 = (uint16 *)plane;
+	plane += _map_size * sizeof(uint16);
+	_me.m8 = (uint16 *)plane;
+	plane += _map_size * sizeof(uint16);
+	_m.type = plane;
+	_m.height = (plane += _map_size);
+	_m.m1 = (plane += _map_size);
+	_m.m3 = (plane += _map_size);
+	_m.m4 = (plane += _map_size);
+	_m.m5 = (plane += _map_size);
+	_me.m6 = (plane += _map_size);
+	_me.m7 = (plane += _map_size);
+#else
 	free(_m);
 	free(_me);
 
 	_m = CallocT<Tile>(_map_size);
 	_me = CallocT<TileExtended>(_map_size);
+#endif /* WITH_MAP_SOA */
+
+	InitializeWaterRegions();
 }
 
 
@@ -552,3 +613,58 @@ void DumpMapStats(char *b, const char *last)
 		b += seprintf(b, last, ": %u\n", it.second);
 	}
 }
+
+/**
+ * Benchmark the hot scans over the map, to compare the map storage layouts.
+ * Runs the tile loop as well, so this changes the game state.
+ * @param b The buffer to write the results to.
+ * @param last The last element of the buffer.
+ * @param passes The number of passes over the whole map per benchmark.
+ * @pre The game is paused, so the tile loop only runs as part of the benchmark.
+ */
+void BenchmarkMap(char *b, const char *last, uint passes)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	auto report = [&](const char *name, Clock::time_point start) {
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		b += seprintf(b, last, "%-20s %10.1f ms %8.2f ns/tile\n", name, ms, ms * 1000000.0 / ((double)MapSize() * passes));
+	};
+
+#ifdef WITH_MAP_SOA
+	b += seprintf(b, last, "Map %u x %u, structure of arrays layout, %u passes\n", MapSizeX(), MapSizeY(), passes);
+#else
+	b += seprintf(b, last, "Map %u x %u, array of structures layout, %u passes\n", MapSizeX(), MapSizeY(), passes);
+#endif
+
+	std::array<uint, 16> tile_types = {};
+	Clock::time_point start = Clock::now();
+	for (uint i = 0; i < passes; i++) {
+		for (TileIndex t = 0; t < MapSize(); t++) tile_types[GetTileType(t)]++;
+	}
+	report("tile type scan", start);
+
+	uint max_height = 0;
+	start = Clock::now();
+	for (uint i = 0; i < passes; i++) {
+		for (TileIndex t = 0; t < MapSize(); t++) max_height = max(max_height, TileHeight(t));
+	}
+	report("height scan", start);
+
+	uint water = 0;
+	start = Clock::now();
+	for (uint i = 0; i < passes; i++) {
+		for (TileIndex t = 0; t < MapSize(); t++) {
+			if (IsTileType(t, MP_WATER) && IsSea(t)) water++;
+		}
+	}
+	report("sea scan", start);
+
+	/* The tile loop visits every tile once every 256 ticks. */
+	assert(_pause_mode != PM_UNPAUSED);
+	start = Clock::now();
+	for (uint i = 0; i < passes * 256; i++) RunTileLoop();
+	report("tile loop", start);
+
+	/* Use the results, so the scans are not optimised away. */
+	b += seprintf(b, last, "(%u clear tiles, max height %u, %u sea tiles)\n", tile_types[MP_CLEAR] / passes, max_height, water / passes);
+}
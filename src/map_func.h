@@ -25,6 +25,59 @@ extern uint _map_tile_mask;
 
 #define TILE_MASK(x) ((x) & _map_tile_mask)
 
+#ifdef WITH_MAP_SOA
+/**
+ * The tiles of the map, stored as one plane per field of #Tile.
+ * Scans which only look at a single field, like the tile type or
+ * the height, then only pull that field into the cache.
+ * Indexing it gives a #TileRef, so it is used just like the tile-array.
+ */
+struct TilePlanes {
+	byte   *type;   ///< Plane of Tile::type.
+	byte   *height; ///< Plane of Tile::height.
+	uint16 *m2;     ///< Plane of Tile::m2.
+	byte   *m1;     ///< Plane of Tile::m1.
+	byte   *m3;     ///< Plane of Tile::m3.
+	byte   *m4;     ///< Plane of Tile::m4.
+	byte   *m5;     ///< Plane of Tile::m5.
+
+	inline TileRef operator[](TileIndex tile) const
+	{
+		return { this->type[tile], this->height[tile], this->m2[tile], this->m1[tile], this->m3[tile], this->m4[tile], this->m5[tile] };
+	}
+
+	inline explicit operator bool() const { return this->type != nullptr; }
+	inline bool operator==(std::nullptr_t) const { return this->type == nullptr; }
+
+	void Clear(TileIndex begin, uint count);
+};
+
+/**
+ * The extended tiles of the map, stored as one plane per field of #TileExtended.
+ * Indexing it gives a #TileExtendedRef, so it is used just like the extended tile-array.
+ */
+struct TileExtendedPlanes {
+	byte   *m6;     ///< Plane of TileExtended::m6.
+	byte   *m7;     ///< Plane of TileExtended::m7.
+	uint16 *m8;     ///< Plane of TileExtended::m8.
+
+	inline TileExtendedRef operator[](TileIndex tile) const
+	{
+		return { this->m6[tile], this->m7[tile], this->m8[tile] };
+	}
+
+	inline explicit operator bool() const { return this->m6 != nullptr; }
+	inline bool operator==(std::nullptr_t) const { return this->m6 == nullptr; }
+
+	void Clear(TileIndex begin, uint count);
+};
+
+/** The planes of the tiles of the map. */
+extern TilePlanes _m;
+
+/** The planes of the extended tiles of the map. */
+extern TileExtendedPlanes _me;
+#else
 /**
  * Pointer to the tile-array.
  *
@@ -40,6 +93,21 @@ extern Tile *_m;
  * of the map.
  */
 extern TileExtended *_me;
+#endif /* WITH_MAP_SOA */
+
+/**
+ * Get the address of the part of a tile which is read first when visiting it, for prefetching.
+ * @param tile The tile.
+ * @return The address to prefetch.
+ */
+static inline const void *GetTilePrefetchAddress(TileIndex tile)
+{
+#ifdef WITH_MAP_SOA
+	return &_m.type[tile];
+#else
+	return &_m[tile];
+#endif
+}
 
 bool ValidateMapSize(uint size_x, uint size_y);
 void AllocateMap(uint size_x, uint size_y);
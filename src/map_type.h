@@ -36,6 +36,32 @@ struct TileExtended {
 	uint16 m8; ///< General purpose
 };
 
+#ifdef WITH_MAP_SOA
+/**
+ * References to the fields of a single tile, when the map is stored as
+ * one plane per field. Used in place of a #Tile reference.
+ */
+struct TileRef {
+	byte   &type;       ///< The type (bits 4..7), bridges (2..3), rainforest/desert (0..1)
+	byte   &height;     ///< The height of the northern corner.
+	uint16 &m2;         ///< Primarily used for indices to towns, industries and stations
+	byte   &m1;         ///< Primarily used for ownership information
+	byte   &m3;         ///< General purpose
+	byte   &m4;         ///< General purpose
+	byte   &m5;         ///< General purpose
+};
+
+/**
+ * References to the extended fields of a single tile, when the map is stored
+ * as one plane per field. Used in place of a #TileExtended reference.
+ */
+struct TileExtendedRef {
+	byte   &m6;         ///< General purpose
+	byte   &m7;         ///< Primarily used for newgrf support
+	uint16 &m8;         ///< General purpose
+};
+#endif /* WITH_MAP_SOA */
+
 /**
  * An offset value between to tiles.
  *
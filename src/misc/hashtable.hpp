@@ -18,8 +18,9 @@ struct CHashTableSlotT
 	typedef typename Titem_::Key Key;          // make Titem_::Key a property of HashTable
 
 	Titem_ *m_pFirst;
+	uint32  m_generation; ///< generation of the hash table this slot was last used in
 
-	inline CHashTableSlotT() : m_pFirst(nullptr) {}
+	inline CHashTableSlotT() : m_pFirst(nullptr), m_generation(0) {}
 
 	/** hash table slot helper - clears the slot by simple forgetting its items */
 	inline void Clear()
@@ -146,12 +147,13 @@ protected:
 	 */
 	typedef CHashTableSlotT<Titem_> Slot;
 
-	Slot  m_slots[Tcapacity]; // here we store our data (array of blobs)
-	int   m_num_items;        // item counter
+	Slot   m_slots[Tcapacity]; // here we store our data (array of blobs)
+	int    m_num_items;        // item counter
+	uint32 m_generation;       // slots of older generations are empty
 
 public:
 	/* default constructor */
-	inline CHashTableT() : m_num_items(0)
+	inline CHashTableT() : m_num_items(0), m_generation(0)
 	{
 	}
 
@@ -172,6 +174,17 @@ protected:
 		return CalcHash(item.GetKey());
 	}
 
+	/** return the slot with the given hash, forgetting its items first if they are from an older generation */
+	inline Slot &GetSlot(int hash)
+	{
+		Slot &slot = m_slots[hash];
+		if (slot.m_generation != m_generation) {
+			slot.Clear();
+			slot.m_generation = m_generation;
+		}
+		return slot;
+	}
+
 public:
 	/** item count */
 	inline int Count() const
@@ -179,10 +192,20 @@ public:
 		return m_num_items;
 	}
 
-	/** simple clear - forget all items - used by CSegmentCostCacheT.Flush() */
+	/**
+	 * simple clear - forget all items - used by CSegmentCostCacheT.Flush() and the node lists.
+	 *  The slots are only marked as old, they are emptied when they are used next time.
+	 */
 	inline void Clear()
 	{
-		for (int i = 0; i < Tcapacity; i++) m_slots[i].Clear();
+		m_num_items = 0;
+		if (++m_generation == 0) {
+			/* generation counter wrapped, really clear the slots so no old items come back */
+			for (int i = 0; i < Tcapacity; i++) {
+				m_slots[i].Clear();
+				m_slots[i].m_generation = 0;
+			}
+		}
 	}
 
 	/** const item search */
@@ -190,6 +213,7 @@ public:
 	{
 		int hash = CalcHash(key);
 		const Slot &slot = m_slots[hash];
+		if (slot.m_generation != m_generation) return nullptr;
 		const Titem_ *item = slot.Find(key);
 		return item;
 	}
@@ -198,7 +222,7 @@ public:
 	Titem_ *Find(const Tkey &key)
 	{
 		int hash = CalcHash(key);
-		Slot &slot = m_slots[hash];
+		Slot &slot = GetSlot(hash);
 		Titem_ *item = slot.Find(key);
 		return item;
 	}
@@ -207,7 +231,7 @@ public:
 	Titem_ *TryPop(const Tkey &key)
 	{
 		int hash = CalcHash(key);
-		Slot &slot = m_slots[hash];
+		Slot &slot = GetSlot(hash);
 		Titem_ *item = slot.Detach(key);
 		if (item != nullptr) {
 			m_num_items--;
@@ -228,7 +252,7 @@ public:
 	{
 		const Tkey &key = item.GetKey();
 		int hash = CalcHash(key);
-		Slot &slot = m_slots[hash];
+		Slot &slot = GetSlot(hash);
 		bool ret = slot.Detach(item);
 		if (ret) {
 			m_num_items--;
@@ -247,7 +271,7 @@ public:
 	void Push(Titem_ &new_item)
 	{
 		int hash = CalcHash(new_item);
-		Slot &slot = m_slots[hash];
+		Slot &slot = GetSlot(hash);
 		assert(slot.Find(new_item.GetKey()) == nullptr);
 		slot.Attach(new_item);
 		m_num_items++;
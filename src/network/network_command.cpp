@@ -203,6 +203,23 @@ void NetworkSyncCommandQueue(NetworkClientSocket *cs)
 	}
 }
 
+/**
+ * Sync the command queue of a client which is still downloading a map snapshot
+ * to the command queue of the given socket which joins using the same snapshot.
+ * The other client's queue holds all commands since the snapshot was made.
+ * @param cs The client to sync the queue to.
+ * @param from The client downloading the same map snapshot.
+ */
+void NetworkSyncCommandQueue(NetworkClientSocket *cs, NetworkClientSocket *from)
+{
+	for (CommandPacket *p = from->outgoing_queue.Peek(); p != nullptr; p = p->next) {
+		CommandPacket c = *p;
+		c.callback = 0;
+		c.my_cmd = false;
+		cs->outgoing_queue.Append(std::move(c));
+	}
+}
+
 /**
  * Execute all commands on the local command queue that ought to be executed this frame.
  */
@@ -31,6 +31,8 @@
 #include "../crashlog.h"
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
+#include <memory>
 #if defined(__MINGW32__)
 #include "../3rdparty/mingw-std-threads/mingw.mutex.h"
 #include "../3rdparty/mingw-std-threads/mingw.condition_variable.h"
@@ -57,150 +59,152 @@ INSTANTIATE_POOL_METHODS(NetworkClientSocket)
 /** Instantiate the listen sockets. */
 template SocketList TCPListenHandler<ServerNetworkGameSocketHandler, PACKET_SERVER_FULL, PACKET_SERVER_BANNED>::sockets;
 
-/** Writing a savegame directly to a number of packets. */
-struct PacketWriter : SaveFilter {
-	ServerNetworkGameSocketHandler *cs; ///< Socket we are associated with.
-	Packet *current;                    ///< The packet we're currently writing to.
-	size_t total_size;                  ///< Total size of the compressed savegame.
-	Packet *packets;                    ///< Packet queue of the savegame; send these "slowly" to the client.
-	std::mutex mutex;                   ///< Mutex for making threaded saving safe.
-	std::condition_variable exit_sig;   ///< Signal for threaded destruction of this packet writer.
+/**
+ * Compressed savegame for joining clients. All clients which request the map
+ * shortly after another client, while that one is still downloading it, share
+ * the same snapshot, so the game only has to be saved once for all of them.
+ */
+struct NetworkMapSnapshot {
+	/** Maximum amount of savegame data in a single map packet. */
+	static const size_t CHUNK_SIZE = SHRT_MAX - sizeof(PacketSize) - sizeof(PacketType);
 
 	/**
-	 * Create the packet writer.
-	 * @param cs The socket handler we're making the packets for.
+	 * Maximum age in ticks of a finished snapshot given to another joining client.
+	 * Older snapshots would leave the client with a long command backlog to replay.
+	 * A snapshot which is still being saved is always shared, as only one save can be in progress.
 	 */
-	PacketWriter(ServerNetworkGameSocketHandler *cs) : SaveFilter(nullptr), cs(cs), current(nullptr), total_size(0), packets(nullptr)
-	{
-	}
-
-	/** Make sure everything is cleaned up. */
-	~PacketWriter()
-	{
-		std::unique_lock<std::mutex> lock(this->mutex);
+	static const uint32 MAX_SHARE_AGE = 2 * DAY_TICKS;
 
-		if (this->cs != nullptr) this->exit_sig.wait(lock);
-
-		/* This must all wait until the Destroy function is called. */
-
-		while (this->packets != nullptr) {
-			Packet *p = this->packets->next;
-			delete this->packets;
-			this->packets = p;
-		}
-
-		delete this->current;
-	}
+	uint32 frame;                        ///< Frame the snapshot was made in.
+	std::mutex mutex;                    ///< Mutex for making threaded saving safe.
+	std::vector<std::vector<byte>> chunks; ///< Packet sized chunks of the compressed savegame, protected by mutex.
+	size_t total_size;                   ///< Total size of the compressed savegame, protected by mutex.
+	bool finished;                       ///< Whether the savegame has been completely written, protected by mutex.
+	std::atomic<bool> abandoned;         ///< Whether no client wants the snapshot anymore, cancels the saving.
+	uint readers;                        ///< Number of clients downloading the snapshot, only used by the main thread.
 
 	/**
-	 * Begin the destruction of this packet writer. It can happen in two ways:
-	 * in the first case the client disconnected while saving the map. In this
-	 * case the saving has not finished and killed this PacketWriter. In that
-	 * case we simply set cs to nullptr, triggering the appending to fail due to
-	 * the connection problem and eventually triggering the destructor. In the
-	 * second case the destructor is already called, and it is waiting for our
-	 * signal which we will send. Only then the packets will be removed by the
-	 * destructor.
+	 * Create an empty snapshot.
+	 * @param frame Frame the snapshot is made in.
 	 */
-	void Destroy()
-	{
-		std::unique_lock<std::mutex> lock(this->mutex);
-
-		this->cs = nullptr;
-
-		this->exit_sig.notify_all();
-		lock.unlock();
+	NetworkMapSnapshot(uint32 frame) : frame(frame), total_size(0), finished(false), abandoned(false), readers(0) {}
+};
 
-		/* Make sure the saving is completely cancelled. Yes,
-		 * we need to handle the save finish as well as the
-		 * next connection might just be requesting a map. */
-		WaitTillSaved();
-		ProcessAsyncSaveFinish();
-	}
+/** Writing a savegame directly into a shared map snapshot. */
+struct NetworkMapSnapshotWriter : SaveFilter {
+	std::shared_ptr<NetworkMapSnapshot> snapshot; ///< Snapshot we are writing.
+	std::vector<byte> current;                    ///< The chunk we're currently writing to.
 
 	/**
-	 * Checks whether there are packets.
-	 * It's not 100% threading safe, but this is only asked for when checking
-	 * whether there still is something to send. Then another call will be made
-	 * to actually get the Packet, which will be the only one popping packets
-	 * and thus eventually setting this on false.
+	 * Create the snapshot writer.
+	 * @param snapshot The snapshot to fill.
 	 */
-	bool HasPackets()
+	NetworkMapSnapshotWriter(std::shared_ptr<NetworkMapSnapshot> snapshot) : SaveFilter(nullptr), snapshot(std::move(snapshot))
 	{
-		return this->packets != nullptr;
+		this->current.reserve(NetworkMapSnapshot::CHUNK_SIZE);
 	}
 
-	/**
-	 * Pop a single created packet from the queue with packets.
-	 */
-	Packet *PopPacket()
+	/** Append the current chunk to the snapshot. */
+	void AppendChunk()
 	{
-		std::lock_guard<std::mutex> lock(this->mutex);
-
-		Packet *p = this->packets;
-		this->packets = p->next;
-		p->next = nullptr;
+		if (this->current.empty()) return;
 
-		return p;
+		std::lock_guard<std::mutex> lock(this->snapshot->mutex);
+		this->snapshot->total_size += this->current.size();
+		this->snapshot->chunks.push_back(std::move(this->current));
+		this->current.clear();
+		this->current.reserve(NetworkMapSnapshot::CHUNK_SIZE);
 	}
 
-	/** Append the current packet to the queue. */
-	void AppendQueue()
+	void Write(byte *buf, size_t size) override
 	{
-		if (this->current == nullptr) return;
+		/* We want to abort the saving when nobody wants the map anymore. */
+		if (this->snapshot->abandoned) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
 
-		Packet **p = &this->packets;
-		while (*p != nullptr) {
-			p = &(*p)->next;
-		}
-		*p = this->current;
+		byte *bufe = buf + size;
+		while (buf != bufe) {
+			size_t to_write = min<size_t>(NetworkMapSnapshot::CHUNK_SIZE - this->current.size(), bufe - buf);
+			this->current.insert(this->current.end(), buf, buf + to_write);
+			buf += to_write;
 
-		this->current = nullptr;
+			if (this->current.size() == NetworkMapSnapshot::CHUNK_SIZE) this->AppendChunk();
+		}
 	}
 
-	void Write(byte *buf, size_t size) override
+	void Finish() override
 	{
-		/* We want to abort the saving when the socket is closed. */
-		if (this->cs == nullptr) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
+		/* We want to abort the saving when nobody wants the map anymore. */
+		if (this->snapshot->abandoned) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
 
-		if (this->current == nullptr) this->current = new Packet(PACKET_SERVER_MAP_DATA);
+		/* Make sure the last chunk is flushed. */
+		this->AppendChunk();
 
-		std::lock_guard<std::mutex> lock(this->mutex);
+		std::lock_guard<std::mutex> lock(this->snapshot->mutex);
+		this->snapshot->finished = true;
+	}
+};
 
-		byte *bufe = buf + size;
-		while (buf != bufe) {
-			size_t to_write = min(SHRT_MAX - this->current->size, bufe - buf);
-			memcpy(this->current->buffer + this->current->size, buf, to_write);
-			this->current->size += (PacketSize)to_write;
-			buf += to_write;
+/** Position of a single client in the map snapshot it is downloading. */
+struct NetworkMapSnapshotReader {
+	std::shared_ptr<NetworkMapSnapshot> snapshot; ///< Snapshot being downloaded.
+	size_t next_chunk;                            ///< Index of the next chunk to send.
+	bool size_sent;                               ///< Whether the total size has been sent.
+	uint sent_packets;                            ///< How many packets we did send successfully last time.
 
-			if (this->current->size == SHRT_MAX) {
-				this->AppendQueue();
-				if (buf != bufe) this->current = new Packet(PACKET_SERVER_MAP_DATA);
-			}
-		}
+	/**
+	 * Start downloading a snapshot.
+	 * @param snapshot The snapshot to download.
+	 */
+	NetworkMapSnapshotReader(std::shared_ptr<NetworkMapSnapshot> snapshot) : snapshot(std::move(snapshot)), next_chunk(0), size_sent(false), sent_packets(4)
+	{
+		this->snapshot->readers++;
+	}
+
+	/**
+	 * Stop downloading the snapshot. When this was the last client downloading it
+	 * and it is still being saved, the saving is cancelled. Either way we wait for
+	 * the saving to be completely finished, as the next connection might just be
+	 * requesting a map.
+	 */
+	~NetworkMapSnapshotReader()
+	{
+		if (--this->snapshot->readers != 0) return;
 
-		this->total_size += size;
+		this->snapshot->abandoned = true;
+		WaitTillSaved();
+		ProcessAsyncSaveFinish();
 	}
 
-	void Finish() override
+	/**
+	 * Create the next packet to send to the client. The size is fast-tracked
+	 * as soon as the saving has finished.
+	 * @return The packet, or nullptr if nothing new has been saved yet.
+	 */
+	Packet *NextPacket()
 	{
-		/* We want to abort the saving when the socket is closed. */
-		if (this->cs == nullptr) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
+		std::lock_guard<std::mutex> lock(this->snapshot->mutex);
 
-		std::lock_guard<std::mutex> lock(this->mutex);
+		if (this->snapshot->finished && !this->size_sent) {
+			this->size_sent = true;
+			Packet *p = new Packet(PACKET_SERVER_MAP_SIZE);
+			p->Send_uint32((uint32)this->snapshot->total_size);
+			return p;
+		}
 
-		/* Make sure the last packet is flushed. */
-		this->AppendQueue();
+		if (this->next_chunk < this->snapshot->chunks.size()) {
+			const std::vector<byte> &chunk = this->snapshot->chunks[this->next_chunk++];
+			Packet *p = new Packet(PACKET_SERVER_MAP_DATA);
+			memcpy(p->buffer + p->size, chunk.data(), chunk.size());
+			p->size += (PacketSize)chunk.size();
+			return p;
+		}
 
-		/* Add a packet stating that this is the end to the queue. */
-		this->current = new Packet(PACKET_SERVER_MAP_DONE);
-		this->AppendQueue();
+		if (this->snapshot->finished && this->next_chunk == this->snapshot->chunks.size()) {
+			this->next_chunk++;
+			return new Packet(PACKET_SERVER_MAP_DONE);
+		}
 
-		/* Fast-track the size to the client. */
-		Packet *p = new Packet(PACKET_SERVER_MAP_SIZE);
-		p->Send_uint32((uint32)this->total_size);
-		this->cs->NetworkTCPSocketHandler::SendPacket(p);
+		return nullptr;
 	}
 };
 
@@ -232,10 +236,7 @@ ServerNetworkGameSocketHandler::~ServerNetworkGameSocketHandler()
 	if (_redirect_console_to_client == this->client_id) _redirect_console_to_client = INVALID_CLIENT_ID;
 	OrderBackup::ResetUser(this->client_id);
 
-	if (this->savegame != nullptr) {
-		this->savegame->Destroy();
-		this->savegame = nullptr;
-	}
+	delete this->savegame;
 }
 
 Packet *ServerNetworkGameSocketHandler::ReceivePacket()
@@ -565,60 +566,63 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendWelcome()
 	return this->SendClientInfo(NetworkClientInfo::GetByClientID(CLIENT_ID_SERVER));
 }
 
-/** Tell the client that its put in a waiting queue. */
-NetworkRecvStatus ServerNetworkGameSocketHandler::SendWait()
-{
-	int waiting = 0;
-	Packet *p;
-
-	/* Count how many clients are waiting in the queue, in front of you! */
-	for (NetworkClientSocket *new_cs : NetworkClientSocket::Iterate()) {
-		if (new_cs->status != STATUS_MAP_WAIT) continue;
-		if (new_cs->GetInfo()->join_date < this->GetInfo()->join_date || (new_cs->GetInfo()->join_date == this->GetInfo()->join_date && new_cs->client_id < this->client_id)) waiting++;
-	}
-
-	p = new Packet(PACKET_SERVER_WAIT);
-	p->Send_uint8(waiting);
-	this->SendPacket(p);
-	return NETWORK_RECV_STATUS_OKAY;
-}
-
 /** This sends the map to the client */
 NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 {
-	static uint sent_packets; // How many packets we did send successfully last time
-
 	if (this->status < STATUS_AUTHORIZED) {
 		/* Illegal call, return error and ignore the packet */
 		return this->SendError(NETWORK_ERROR_NOT_AUTHORIZED);
 	}
 
 	if (this->status == STATUS_AUTHORIZED) {
-		this->savegame = new PacketWriter(this);
+		/* Share the newest snapshot of a client that is still downloading the map, if any; when it is
+		 * finished, only if it is recent. Its command queue holds everything since the snapshot was made. */
+		NetworkClientSocket *donor = nullptr;
+		for (NetworkClientSocket *new_cs : NetworkClientSocket::Iterate()) {
+			if (new_cs == this || new_cs->status != STATUS_MAP) continue;
+			NetworkMapSnapshot *candidate = new_cs->savegame->snapshot.get();
+			if (candidate->abandoned) continue;
+			bool finished;
+			{
+				std::lock_guard<std::mutex> lock(candidate->mutex);
+				finished = candidate->finished;
+			}
+			if (finished && _frame_counter - candidate->frame > NetworkMapSnapshot::MAX_SHARE_AGE) continue;
+			if (donor == nullptr || candidate->frame > donor->savegame->snapshot->frame) donor = new_cs;
+		}
+
+		std::shared_ptr<NetworkMapSnapshot> snapshot = (donor != nullptr) ? donor->savegame->snapshot : std::make_shared<NetworkMapSnapshot>(_frame_counter);
+		this->savegame = new NetworkMapSnapshotReader(snapshot);
 
-		/* Now send the _frame_counter and how many packets are coming */
+		/* Now send the frame of the snapshot and how many packets are coming */
 		Packet *p = new Packet(PACKET_SERVER_MAP_BEGIN);
-		p->Send_uint32(_frame_counter);
+		p->Send_uint32(snapshot->frame);
 		this->SendPacket(p);
 
-		NetworkSyncCommandQueue(this);
+		if (donor != nullptr) {
+			NetworkSyncCommandQueue(this, donor);
+		} else {
+			NetworkSyncCommandQueue(this);
+		}
 		this->status = STATUS_MAP;
 		/* Mark the start of download */
 		this->last_frame = _frame_counter;
 		this->last_frame_server = _frame_counter;
 
-		sent_packets = 4; // We start with trying 4 packets
-
-		/* Make a dump of the current game */
-		if (SaveWithFilter(this->savegame, true) != SL_OK) usererror("network savedump failed");
+		/* Make a dump of the current game, after any other save, such as an autosave, has finished. */
+		if (donor == nullptr) WaitTillSaved();
+		if (donor == nullptr && SaveWithFilter(new NetworkMapSnapshotWriter(snapshot), true) != SL_OK) usererror("network savedump failed");
 	}
 
 	if (this->status == STATUS_MAP) {
 		bool last_packet = false;
 		bool has_packets = false;
 
-		for (uint i = 0; (has_packets = this->savegame->HasPackets()) && i < sent_packets; i++) {
-			Packet *p = this->savegame->PopPacket();
+		for (uint i = 0; i < this->savegame->sent_packets; i++) {
+			Packet *p = this->savegame->NextPacket();
+			if (p == nullptr) break;
+
+			has_packets = true;
 			last_packet = p->buffer[2] == PACKET_SERVER_MAP_DONE;
 
 			this->SendPacket(p);
@@ -631,34 +635,12 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 
 		if (last_packet) {
 			/* Done reading, make sure saving is done as well */
-			this->savegame->Destroy();
+			delete this->savegame;
 			this->savegame = nullptr;
 
 			/* Set the status to DONE_MAP, no we will wait for the client
 			 *  to send it is ready (maybe that happens like never ;)) */
 			this->status = STATUS_DONE_MAP;
-
-			/* Find the best candidate for joining, i.e. the first joiner. */
-			NetworkClientSocket *best = nullptr;
-			for (NetworkClientSocket *new_cs : NetworkClientSocket::Iterate()) {
-				if (new_cs->status == STATUS_MAP_WAIT) {
-					if (best == nullptr || best->GetInfo()->join_date > new_cs->GetInfo()->join_date || (best->GetInfo()->join_date == new_cs->GetInfo()->join_date && best->client_id > new_cs->client_id)) {
-						best = new_cs;
-					}
-				}
-			}
-
-			/* Is there someone else to join? */
-			if (best != nullptr) {
-				/* Let the first start joining. */
-				best->status = STATUS_AUTHORIZED;
-				best->SendMap();
-
-				/* And update the rest. */
-				for (NetworkClientSocket *new_cs : NetworkClientSocket::Iterate()) {
-					if (new_cs->status == STATUS_MAP_WAIT) new_cs->SendWait();
-				}
-			}
 		}
 
 		switch (this->SendPackets()) {
@@ -667,7 +649,7 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 
 			case SPS_ALL_SENT:
 				/* All are sent, increase the sent_packets */
-				if (has_packets) sent_packets *= 2;
+				if (has_packets && this->savegame != nullptr) this->savegame->sent_packets *= 2;
 				break;
 
 			case SPS_PARTLY_SENT:
@@ -676,7 +658,7 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 
 			case SPS_NONE_SENT:
 				/* Not everything is sent, decrease the sent_packets */
-				if (sent_packets > 1) sent_packets /= 2;
+				if (this->savegame != nullptr && this->savegame->sent_packets > 1) this->savegame->sent_packets /= 2;
 				break;
 		}
 	}
@@ -1067,16 +1049,8 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::Receive_CLIENT_GETMAP(Packet *
 		return this->SendError(NETWORK_ERROR_NOT_AUTHORIZED);
 	}
 
-	/* Check if someone else is receiving the map */
-	for (NetworkClientSocket *new_cs : NetworkClientSocket::Iterate()) {
-		if (new_cs->status == STATUS_MAP) {
-			/* Tell the new client to wait */
-			this->status = STATUS_MAP_WAIT;
-			return this->SendWait();
-		}
-	}
-
-	/* We receive a request to upload the map.. give it to the client! */
+	/* We receive a request to upload the map.. give it to the client!
+	 * When someone else is receiving the map already, it shares their copy. */
 	return this->SendMap();
 }
 
@@ -1957,7 +1931,6 @@ void NetworkServer_Tick(bool send_frame)
 				}
 				break;
 
-			case NetworkClientSocket::STATUS_MAP_WAIT:
 			case NetworkClientSocket::STATUS_CLOSE_PENDING:
 				/* This is an internal state where we do not wait
 				 * on the client to move to a different state. */
@@ -2026,7 +1999,6 @@ void NetworkServerShowStatusToConsole()
 		"authorizing (server password)",
 		"authorizing (company password)",
 		"authorized",
-		"waiting",
 		"loading map",
 		"map done",
 		"ready",
@@ -11,6 +11,8 @@
 
 #include <stdarg.h>
 #include <algorithm>
+#include <map>
+#include <memory>
 
 #include "debug.h"
 #include "fileio_func.h"
@@ -47,6 +49,7 @@
 #include "language.h"
 #include "vehicle_base.h"
 #include "road.h"
+#include "worker_thread.h"
 
 #include "table/strings.h"
 #include "table/build_industry.h"
@@ -192,7 +195,8 @@ public:
 	}
 };
 
-static GrfProcessingState _cur;
+/* Per thread, as the file scanning stages may process several files at once, see #LoadNewGRFFile. */
+static thread_local GrfProcessingState _cur;
 
 
 /**
@@ -8026,7 +8030,7 @@ static bool ChangeGRFMinVersion(size_t len, ByteReader *buf)
 	return true;
 }
 
-static GRFParameterInfo *_cur_parameter; ///< The parameter which info is currently changed by the newgrf.
+static thread_local GRFParameterInfo *_cur_parameter; ///< The parameter which info is currently changed by the newgrf.
 
 /** Callback function for 'INFO'->'PARAM'->param_num->'NAME' to set the name of a parameter. */
 static bool ChangeGRFParamName(byte langid, const char *str)
@@ -9892,6 +9896,97 @@ byte GetGRFContainerVersion()
 	return 1;
 }
 
+/** The sprite section of a NewGRF, parsed on a worker thread ahead of the loading stages which need it. */
+struct GRFSpriteOffsetScan {
+	Subdirectory subdir;       ///< The sub directory the NewGRF was looked for in.
+	byte container_ver = 0;    ///< Container version of the NewGRF, 0 if it could not be read.
+	GRFSpriteOffsets offsets;  ///< The sprite offsets of the NewGRF.
+	WorkerTaskPtr task;        ///< The task parsing the sprite section, if it has not been waited for yet.
+};
+
+/** The sprite sections being parsed by #StartGRFSpriteOffsetScans, only accessed by the thread loading the NewGRFs. */
+static std::map<const GRFConfig *, std::unique_ptr<GRFSpriteOffsetScan>> _grf_sprite_offset_scans;
+
+/**
+ * Parse the sprite section of a NewGRF.
+ * Called on a worker thread, only the Fio functions of that thread are used.
+ * @param filename The NewGRF to parse.
+ * @param scan Where to store the result.
+ */
+static void ScanGRFSpriteOffsets(const char *filename, GRFSpriteOffsetScan *scan)
+{
+	if (!FioOpenPrivateFile(filename, scan->subdir)) return;
+	scan->container_ver = GetGRFContainerVersion();
+	if (scan->container_ver != 0) ReadGRFSpriteOffsets(scan->container_ver, scan->offsets);
+	FioClosePrivateFile();
+}
+
+/**
+ * Start parsing the sprite sections of the NewGRFs to load on the worker threads.
+ * The sprite sections are needed by the init and activation stages, which have
+ * to process the NewGRFs one after another. Parsing them only depends on the
+ * files though, so it is done for all files at once ahead of these stages.
+ * @param file_index The Fio index of the first NewGRF to load.
+ * @param num_baseset Number of NewGRFs at the front of the list to look up in the baseset dir instead of the newgrf dir.
+ */
+static void StartGRFSpriteOffsetScans(uint file_index, uint num_baseset)
+{
+	if (_worker_pool.GetMaxWorkers() == 0) return;
+
+	uint slot = file_index;
+	for (const GRFConfig *c = _grfconfig; c != nullptr; c = c->next) {
+		if (c->status == GCS_DISABLED || c->status == GCS_NOT_FOUND) continue;
+
+		std::unique_ptr<GRFSpriteOffsetScan> scan(new GRFSpriteOffsetScan());
+		scan->subdir = slot++ < file_index + num_baseset ? BASESET_DIR : NEWGRF_DIR;
+		GRFSpriteOffsetScan *scan_ptr = scan.get();
+		const char *filename = c->filename;
+		scan->task = _worker_pool.Enqueue(WTP_NORMAL, "ottd:grf-offsets", [filename, scan_ptr]() { ScanGRFSpriteOffsets(filename, scan_ptr); });
+		if (scan->task != nullptr) _grf_sprite_offset_scans[c] = std::move(scan);
+	}
+}
+
+/**
+ * Get the sprite section of a NewGRF parsed by #StartGRFSpriteOffsetScans.
+ * @param config The NewGRF.
+ * @param stage The loading stage.
+ * @param subdir The sub directory the NewGRF was found in.
+ * @param[out] offsets The sprite offsets of the NewGRF.
+ * @return Whether the sprite section was parsed ahead, otherwise it has to be read now.
+ */
+static bool TakeScannedGRFSpriteOffsets(const GRFConfig *config, GrfLoadingStage stage, Subdirectory subdir, GRFSpriteOffsets &offsets)
+{
+	auto it = _grf_sprite_offset_scans.find(config);
+	if (it == _grf_sprite_offset_scans.end()) return false;
+
+	GRFSpriteOffsetScan &scan = *it->second;
+	if (scan.task != nullptr) {
+		scan.task->Wait();
+		scan.task.reset();
+	}
+	if (scan.subdir != subdir || scan.container_ver != _cur.grf_container_ver) return false;
+
+	if (stage == GLS_ACTIVATION || HasBit(config->flags, GCF_INIT_ONLY)) {
+		/* Nothing needs the sprite section after this. */
+		offsets = std::move(scan.offsets);
+		_grf_sprite_offset_scans.erase(it);
+	} else {
+		offsets = scan.offsets;
+	}
+	return true;
+}
+
+/** Wait for and discard the sprite sections parsed by #StartGRFSpriteOffsetScans which were not used. */
+static void FinishGRFSpriteOffsetScans()
+{
+	for (auto &it : _grf_sprite_offset_scans) {
+		if (it.second->task != nullptr) it.second->task->Wait();
+	}
+	_grf_sprite_offset_scans.clear();
+}
+
+static void LoadNewGRFFileFromFile(GRFConfig *config, GrfLoadingStage stage, Subdirectory subdir);
+
 /**
  * Load a particular NewGRF.
  * @param config     The configuration of the to be loaded NewGRF.
@@ -9928,12 +10023,30 @@ void LoadNewGRFFile(GRFConfig *config, uint file_index, GrfLoadingStage stage, S
 
 	free(config->full_filename);
 	config->full_filename = nullptr;
-	FioOpenFile(file_index, filename, subdir, &(config->full_filename));
 	_cur.file_index = file_index; // XXX
-	_palette_remap_grf[_cur.file_index] = (config->palette & GRFP_USE_MASK);
-
 	_cur.grfconfig = config;
 
+	if (stage == GLS_FILESCAN || stage == GLS_SAFETYSCAN) {
+		/* These stages only look at the file itself and not at any global state, so
+		 * the file is read without a file slot, to allow scanning several files at once. */
+		if (!FioOpenPrivateFile(filename, subdir, &(config->full_filename))) usererror("Cannot open file '%s'", filename);
+		LoadNewGRFFileFromFile(config, stage, subdir);
+		FioClosePrivateFile();
+	} else {
+		FioOpenFile(file_index, filename, subdir, &(config->full_filename));
+		_palette_remap_grf[_cur.file_index] = (config->palette & GRFP_USE_MASK);
+		LoadNewGRFFileFromFile(config, stage, subdir);
+	}
+}
+
+/**
+ * Load a particular NewGRF from the file the Fio functions currently read from.
+ * @param config The configuration of the to be loaded NewGRF.
+ * @param stage  The loading stage of the NewGRF.
+ * @param subdir The sub directory the NewGRF was found in.
+ */
+static void LoadNewGRFFileFromFile(GRFConfig *config, GrfLoadingStage stage, Subdirectory subdir)
+{
 	DEBUG(grf, 2, "LoadNewGRFFile: Reading NewGRF-file '%s'", config->GetDisplayPath());
 
 	_cur.grf_container_ver = GetGRFContainerVersion();
@@ -9945,7 +10058,14 @@ void LoadNewGRFFile(GRFConfig *config, uint file_index, GrfLoadingStage stage, S
 	if (stage == GLS_INIT || stage == GLS_ACTIVATION) {
 		/* We need the sprite offsets in the init stage for NewGRF sounds
 		 * and in the activation stage for real sprites. */
-		ReadGRFSpriteOffsets(_cur.grf_container_ver);
+		GRFSpriteOffsets offsets;
+		if (TakeScannedGRFSpriteOffsets(config, stage, subdir, offsets)) {
+			/* Skip sprite section offset if present. */
+			if (_cur.grf_container_ver >= 2) FioReadDword();
+		} else {
+			ReadGRFSpriteOffsets(_cur.grf_container_ver, offsets);
+		}
+		SetGRFSpriteOffsets(std::move(offsets));
 	} else {
 		/* Skip sprite section offset if present. */
 		if (_cur.grf_container_ver >= 2) FioReadDword();
@@ -10348,6 +10468,8 @@ void LoadNewGRF(uint load_index, uint file_index, uint num_baseset)
 
 	_cur.spriteid = load_index;
 
+	StartGRFSpriteOffsetScans(file_index, num_baseset);
+
 	/* Load newgrf sprites
 	 * in each loading stage, (try to) open each file specified in the config
 	 * and load information from it. */
@@ -10413,6 +10535,7 @@ void LoadNewGRF(uint load_index, uint file_index, uint num_baseset)
 
 	/* Pseudo sprite processing is finished; free temporary stuff */
 	_cur.ClearDataForNextFile();
+	FinishGRFSpriteOffsetScans();
 
 	/* Call any functions that should be run after GRFs have been loaded. */
 	AfterLoadGRFs();
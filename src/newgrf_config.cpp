@@ -25,13 +25,8 @@
 #include "fileio_func.h"
 #include "fios.h"
 
-#include "thread.h"
-#include <mutex>
-#include <condition_variable>
-#if defined(__MINGW32__)
-#include "3rdparty/mingw-std-threads/mingw.mutex.h"
-#include "3rdparty/mingw-std-threads/mingw.condition_variable.h"
-#endif
+#include "worker_thread.h"
+#include <deque>
 
 #include "safeguards.h"
 
@@ -381,15 +376,6 @@ struct GRFMD5SumState {
 	FILE *f;
 };
 
-static uint _grf_md5_parallel = 0;
-static uint _grf_md5_threads = 0;
-static std::mutex _grf_md5_lock;
-static std::vector<GRFMD5SumState> _grf_md5_pending;
-static std::condition_variable _grf_md5_full_cv;
-static std::condition_variable _grf_md5_empty_cv;
-static std::condition_variable _grf_md5_done_cv;
-static const uint GRF_MD5_PENDING_MAX = 8;
-
 static void CalcGRFMD5SumFromState(const GRFMD5SumState &state)
 {
 	Md5 checksum;
@@ -405,44 +391,6 @@ static void CalcGRFMD5SumFromState(const GRFMD5SumState &state)
 	FioFCloseFile(state.f);
 }
 
-void CalcGRFMD5Thread()
-{
-	std::unique_lock<std::mutex> lk(_grf_md5_lock);
-	while (_grf_md5_parallel > 0 || !_grf_md5_pending.empty()) {
-		if (_grf_md5_pending.empty()) {
-			_grf_md5_empty_cv.wait(lk);
-		} else {
-			const bool full = _grf_md5_pending.size() == GRF_MD5_PENDING_MAX;
-			GRFMD5SumState state = _grf_md5_pending.back();
-			_grf_md5_pending.pop_back();
-			lk.unlock();
-			if (full) _grf_md5_full_cv.notify_one();
-			CalcGRFMD5SumFromState(state);
-			lk.lock();
-		}
-	}
-	_grf_md5_threads--;
-	if (_grf_md5_threads == 0) {
-		_grf_md5_done_cv.notify_all();
-	}
-}
-
-void CalcGRFMD5ThreadingStart()
-{
-	_grf_md5_parallel = std::thread::hardware_concurrency();
-	if (_grf_md5_parallel <= 1) _grf_md5_parallel = 0;
-}
-
-void CalcGRFMD5ThreadingEnd()
-{
-	if (_grf_md5_parallel) {
-		std::unique_lock<std::mutex> lk(_grf_md5_lock);
-		_grf_md5_parallel = 0;
-		_grf_md5_empty_cv.notify_all();
-		_grf_md5_done_cv.wait(lk, []() { return _grf_md5_threads == 0; });
-	}
-}
-
 /**
  * Calculate the MD5 sum for a GRF, and store it in the config.
  * @param config GRF to compute.
@@ -466,35 +414,14 @@ static bool CalcGRFMD5Sum(GRFConfig *config, Subdirectory subdir)
 	}
 
 	/* calculate md5sum */
-	GRFMD5SumState state { config, size, f };
-	if (_grf_md5_parallel == 0) {
-		CalcGRFMD5SumFromState(state);
-		return true;
-	}
-
-	std::unique_lock<std::mutex> lk(_grf_md5_lock);
-	if (_grf_md5_pending.size() >= GRF_MD5_PENDING_MAX) {
-		_grf_md5_full_cv.wait(lk);
-	}
-	_grf_md5_pending.push_back(state);
-	bool notify_reader = (_grf_md5_pending.size() == 1); // queue was empty
-	if ((_grf_md5_threads == 0) || ((_grf_md5_pending.size() > 1) && (_grf_md5_threads < _grf_md5_parallel))) {
-		_grf_md5_threads++;
-		if (!StartNewThread(nullptr, "ottd:grf-md5", &CalcGRFMD5Thread)) {
-			_grf_md5_parallel = 0;
-			lk.unlock();
-			CalcGRFMD5Thread();
-			return true;
-		}
-	}
-	lk.unlock();
-	if (notify_reader) _grf_md5_empty_cv.notify_one();
+	CalcGRFMD5SumFromState({ config, size, f });
 	return true;
 }
 
 
 /**
  * Find the GRFID of a given grf, and calculate its md5sum.
+ * This only touches \a config, so it may be called for several grfs at once.
  * @param config    grf to fill.
  * @param is_static grf is static.
  * @param subdir    the subdirectory to search in.
@@ -716,12 +643,31 @@ compatible_grf:
 
 /** Helper for scanning for files with GRF as extension */
 class GRFFileScanner : FileScanner {
+	/** A file found by the scan. */
+	struct ScannedGRF {
+		GRFConfig *config; ///< The details of the file, filled on a worker thread.
+		bool added;        ///< Whether the file is a valid NewGRF, set when the details have been filled.
+	};
+
+	static const uint PENDING_MAX = 16; ///< Maximum number of files to have details filled at once.
+
 	uint next_update; ///< The next (realtime tick) we do update the screen.
 	uint num_scanned; ///< The number of GRFs we have scanned.
-	std::vector<GRFConfig *> grfs;
+	bool parallel;    ///< Whether the details of the files are filled on the worker threads.
+	std::deque<ScannedGRF> grfs;         ///< The files found so far, in the order they were found.
+	std::deque<std::pair<WorkerTaskPtr, const ScannedGRF *>> pending; ///< The tasks filling the details of the files.
+	const ScannedGRF *last_done;         ///< Last file whose details are known to be filled, for the progress window.
+
+	/** Wait for the details of the oldest pending file, or help out filling them. */
+	void WaitForOldest()
+	{
+		this->pending.front().first->Wait();
+		this->last_done = this->pending.front().second;
+		this->pending.pop_front();
+	}
 
 public:
-	GRFFileScanner() : next_update(_realtime_tick), num_scanned(0)
+	GRFFileScanner() : next_update(_realtime_tick), num_scanned(0), parallel(_worker_pool.GetMaxWorkers() > 0), last_done(nullptr)
 	{
 	}
 
@@ -730,13 +676,21 @@ public:
 	/** Do the scan for GRFs. */
 	static uint DoScan()
 	{
-		CalcGRFMD5ThreadingStart();
 		GRFFileScanner fs;
-		fs.grfs.clear();
-		int ret = fs.Scan(".grf", NEWGRF_DIR);
-		CalcGRFMD5ThreadingEnd();
+		fs.Scan(".grf", NEWGRF_DIR);
+		while (!fs.pending.empty()) fs.WaitForOldest();
+
+		int ret = 0;
+		for (const ScannedGRF &grf : fs.grfs) {
+			GRFConfig *c = grf.config;
+			if (!grf.added) {
+				/* File couldn't be opened, or is either not a NewGRF or is a
+				 * 'system' NewGRF or it's already known, so forget about it. */
+				delete c;
+				continue;
+			}
+			ret++;
 
-		for (GRFConfig *c : fs.grfs) {
 			bool added = true;
 			if (_all_grfs == nullptr) {
 				_all_grfs = c;
@@ -775,11 +729,21 @@ public:
 
 bool GRFFileScanner::AddFile(const char *filename, size_t basepath_length, const char *tar_filename)
 {
-	GRFConfig *c = new GRFConfig(filename + basepath_length);
+	this->grfs.push_back({ new GRFConfig(filename + basepath_length), false });
+	ScannedGRF *grf = &this->grfs.back();
 
-	bool added = FillGRFDetails(c, false);
-	if (added) {
-		this->grfs.push_back(c);
+	/* Reading the files takes much longer than finding them, so fill the details of several files at once. */
+	WorkerTaskPtr task;
+	if (this->parallel) {
+		/* Limit the number of files open at once. */
+		if (this->pending.size() >= PENDING_MAX) this->WaitForOldest();
+		task = _worker_pool.Enqueue(WTP_NORMAL, "ottd:grf-scan", [grf]() { grf->added = FillGRFDetails(grf->config, false); });
+	}
+	if (task != nullptr) {
+		this->pending.emplace_back(std::move(task), grf);
+	} else {
+		grf->added = FillGRFDetails(grf->config, false);
+		this->last_done = grf;
 	}
 
 	this->num_scanned++;
@@ -787,8 +751,13 @@ bool GRFFileScanner::AddFile(const char *filename, size_t basepath_length, const
 		_modal_progress_work_mutex.unlock();
 		_modal_progress_paint_mutex.lock();
 
+		/* Only files whose details have been filled have a name. */
 		const char *name = nullptr;
-		if (c->name != nullptr) name = GetGRFStringFromGRFText(c->name->text);
+		const GRFConfig *c = grf->config;
+		if (this->last_done != nullptr) {
+			c = this->last_done->config;
+			if (c->name != nullptr) name = GetGRFStringFromGRFText(c->name->text);
+		}
 		if (name == nullptr) name = c->filename;
 		UpdateNewGRFScanStatus(this->num_scanned, name);
 
@@ -798,13 +767,8 @@ bool GRFFileScanner::AddFile(const char *filename, size_t basepath_length, const
 		this->next_update = _realtime_tick + MODAL_PROGRESS_REDRAW_TIMEOUT;
 	}
 
-	if (!added) {
-		/* File couldn't be opened, or is either not a NewGRF or is a
-		 * 'system' NewGRF or it's already known, so forget about it. */
-		delete c;
-	}
-
-	return added;
+	/* Whether the file is really added is only known once its details have been filled. */
+	return true;
 }
 
 /**
@@ -47,6 +47,7 @@
 #include "rev.h"
 #include "highscore.h"
 #include "station_base.h"
+#include "station_func.h"
 #include "crashlog.h"
 #include "engine_func.h"
 #include "core/random_func.hpp"
@@ -80,6 +81,8 @@
 
 #include "linkgraph/linkgraphschedule.h"
 #include "tracerestrict.h"
+#include "worker_thread.h"
+#include "pathfinder/water_regions.h"
 
 #include <stdarg.h>
 #include <system_error>
@@ -407,6 +410,7 @@ static void ShutdownGame()
 
 	FreeSignalPrograms();
 	FreeSignalDependencies();
+	ClearSignalSegmentCache();
 
 	ClearZoningCaches();
 	ClearOrderDestinationRefcountMap();
@@ -844,6 +848,8 @@ int openttd_main(int argc, char *argv[])
 
 	LoadFromConfig(true);
 
+	_worker_pool.SetMaxWorkers(GetConfiguredWorkerThreadCount());
+
 	if (resolution.width != 0) _cur_resolution = resolution;
 
 	/*
@@ -1013,6 +1019,7 @@ int openttd_main(int argc, char *argv[])
 
 	/* Reset windowing system, stop drivers, free used memory, ... */
 	ShutdownGame();
+	_worker_pool.Stop();
 	goto exit_normal;
 
 exit_noshutdown:
@@ -1483,6 +1490,10 @@ void CheckCaches(bool force_check, std::function<void(const char *)> log)
 		i++;
 	}
 
+	if (!ValidateStationCatchmentIndex()) {
+		CCLOG("station catchment index mismatch");
+	}
+
 	/* Check company infrastructure cache. */
 	std::vector<CompanyInfrastructure> old_infrastructure;
 	for (const Company *c : Company::Iterate()) old_infrastructure.push_back(c->infrastructure);
@@ -1672,6 +1683,7 @@ void CheckCaches(bool force_check, std::function<void(const char *)> log)
 
 	/* Check whether the caches are still valid */
 	for (Vehicle *v : Vehicle::Iterate()) {
+		v->cargo.ApplyAging();
 		byte buff[sizeof(VehicleCargoList)];
 		memcpy(buff, &v->cargo, sizeof(VehicleCargoList));
 		v->cargo.InvalidateCache();
@@ -1708,6 +1720,10 @@ void CheckCaches(bool force_check, std::function<void(const char *)> log)
 
 	if (!CargoPacket::ValidateDeferredCargoPayments()) CCLOG("Cargo packets deferred payments validation failed");
 
+	if (!ValidateWaterRegions()) CCLOG("Water region cache mismatch");
+	if (!_vehicle_owner_type_index.Validate()) CCLOG("Vehicle owner/type index mismatch");
+	if (!_station_owner_index.Validate()) CCLOG("Station owner index mismatch");
+
 	if (_order_destination_refcount_map_valid) {
 		btree::btree_map<uint32, uint32> saved_order_destination_refcount_map = std::move(_order_destination_refcount_map);
 		for (auto iter = saved_order_destination_refcount_map.begin(); iter != saved_order_destination_refcount_map.end();) {
@@ -1862,10 +1878,18 @@ static void DoAutosave()
 		if (++_autosave_ctr >= _settings_client.gui.max_num_autosaves) _autosave_ctr = 0;
 	}
 
-	DEBUG(sl, 2, "Autosaving to '%s'", buf);
-	if (SaveOrLoad(buf, SLO_SAVE, DFT_GAME_FILE, AUTOSAVE_DIR) != SL_OK) {
+	/* Incremental autosaves only store the map blocks changed since the autosave base file was written. */
+	extern bool PrepareMapDeltaAutosave();
+	extern void FinishMapDeltaAutosave(const char *name, bool incremental, bool saved);
+	bool incremental = _settings_client.gui.incremental_autosave && PrepareMapDeltaAutosave();
+
+	DEBUG(sl, 2, "Autosaving to '%s'%s", buf, incremental ? " (incremental)" : "");
+	bool saved = SaveOrLoad(buf, SLO_SAVE, DFT_GAME_FILE, AUTOSAVE_DIR) == SL_OK;
+	if (!saved) {
 		ShowErrorMessage(STR_ERROR_AUTOSAVE_FAILED, INVALID_STRING_ID, WL_ERROR);
 	}
+
+	FinishMapDeltaAutosave(buf, incremental, saved);
 }
 
 void GameLoop()
@@ -1892,7 +1916,7 @@ void GameLoop()
 		_switch_mode = SM_NONE;
 	}
 
-	IncreaseSpriteLRU();
+	TrimSpriteCache();
 	InteractiveRandom();
 
 	/* Check for UDP stuff */
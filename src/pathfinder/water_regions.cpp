@@ -0,0 +1,228 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file water_regions.cpp Handling of the water regions, the high level graph the ship pathfinder routes on. */
+
+#include "../stdafx.h"
+#include "../tile_cmd.h"
+#include "../tunnelbridge_map.h"
+#include "../ship.h"
+#include "follow_track.hpp"
+#include "water_regions.h"
+
+#include <algorithm>
+#include <array>
+
+#include "../safeguards.h"
+
+/** A way out of a water region, it is followed when the neighbours of a patch are requested. */
+struct WaterRegionExit {
+	TileIndex tile;              ///< Tile within the region the exit starts at.
+	Trackdir trackdir;           ///< Trackdir leaving the region.
+	WaterRegionPatchLabel label; ///< Label of the patch the exit belongs to.
+
+	inline bool operator==(const WaterRegionExit &other) const { return this->tile == other.tile && this->trackdir == other.trackdir && this->label == other.label; }
+};
+
+/**
+ * The cached connectivity of the water tiles within one water region.
+ * It only depends on the tiles of the region itself, the connections to
+ * the neighbouring regions are followed when they are requested.
+ */
+struct WaterRegion {
+	std::vector<WaterRegionPatchLabel> tile_patch_labels; ///< Patch label of each tile, empty when the region has at most one patch.
+	std::vector<WaterRegionExit> exits;                   ///< The ways out of the region.
+	uint8 number_of_patches = 0;                          ///< Number of patches in the region.
+	bool initialized = false;                             ///< Whether the above is up to date.
+};
+
+static std::vector<WaterRegion> _water_regions;
+
+/**
+ * Get the trackdirs ships can use on a tile.
+ * @param tile the tile
+ * @return the trackdirs
+ */
+static inline TrackdirBits GetWaterTrackdirs(TileIndex tile)
+{
+	return TrackStatusToTrackdirBits(GetTileTrackStatus(tile, TRANSPORT_WATER, 0));
+}
+
+/**
+ * Get the tile a ship ends up on when leaving a tile in a direction, without checking whether it can actually enter it.
+ * @param tile the tile being left
+ * @param exitdir the direction it is left in
+ * @return the tile being entered
+ */
+static inline TileIndex GetWaterExitTarget(TileIndex tile, DiagDirection exitdir)
+{
+	if (IsTileType(tile, MP_TUNNELBRIDGE) && GetTunnelBridgeDirection(tile) == exitdir) return GetOtherBridgeEnd(tile);
+	return TileAddByDiagDir(tile, exitdir);
+}
+
+/**
+ * Label the patches of a water region and collect the ways out of it.
+ * @param index the water region index
+ * @param region the region to fill
+ */
+static void UpdateWaterRegion(uint32 index, WaterRegion &region)
+{
+	const TileIndex north = GetWaterRegionNorthTile(index);
+	const uint x0 = TileX(north);
+	const uint y0 = TileY(north);
+	auto tile_of = [&](uint i) -> TileIndex { return TileXY(x0 + i % WATER_REGION_EDGE_LENGTH, y0 + i / WATER_REGION_EDGE_LENGTH); };
+
+	std::array<TrackdirBits, WATER_REGION_NUMBER_OF_TILES> trackdirs;
+	for (uint i = 0; i < WATER_REGION_NUMBER_OF_TILES; i++) {
+		trackdirs[i] = GetWaterTrackdirs(tile_of(i));
+	}
+
+	std::array<WaterRegionPatchLabel, WATER_REGION_NUMBER_OF_TILES> labels;
+	labels.fill(INVALID_WATER_REGION_PATCH);
+	region.exits.clear();
+
+	uint8 patches = 0;
+	std::vector<uint> stack;
+	for (uint start = 0; start < WATER_REGION_NUMBER_OF_TILES; start++) {
+		if (trackdirs[start] == TRACKDIR_BIT_NONE || labels[start] != INVALID_WATER_REGION_PATCH) continue;
+
+		/* Should there ever be more patches than labels, the last label is shared. */
+		if (patches < UINT8_MAX) patches++;
+		const WaterRegionPatchLabel label = patches;
+		labels[start] = label;
+		stack.push_back(start);
+
+		while (!stack.empty()) {
+			const uint i = stack.back();
+			stack.pop_back();
+			const TileIndex tile = tile_of(i);
+
+			/* The trackdirs reachable on the next tile only depend on the direction it is entered from. */
+			uint8 done_exitdirs = 0;
+			for (TrackdirBits tdb = trackdirs[i]; tdb != TRACKDIR_BIT_NONE; tdb = KillFirstBit(tdb)) {
+				const Trackdir td = (Trackdir)FindFirstBit2x64(tdb);
+				const DiagDirection exitdir = TrackdirToExitdir(td);
+				if (HasBit(done_exitdirs, exitdir)) continue;
+				SetBit(done_exitdirs, exitdir);
+
+				const TileIndex target = GetWaterExitTarget(tile, exitdir);
+				if (GetWaterRegionIndex(target) != index) {
+					region.exits.push_back({ tile, td, label });
+					continue;
+				}
+
+				CFollowTrackWater F;
+				if (!F.Follow(tile, td)) continue;
+				const uint j = (TileY(target) - y0) * WATER_REGION_EDGE_LENGTH + (TileX(target) - x0);
+				if (labels[j] != INVALID_WATER_REGION_PATCH) continue;
+				labels[j] = label;
+				stack.push_back(j);
+			}
+		}
+	}
+
+	region.number_of_patches = patches;
+	if (patches > 1) {
+		region.tile_patch_labels.assign(labels.begin(), labels.end());
+	} else {
+		region.tile_patch_labels.clear();
+		region.tile_patch_labels.shrink_to_fit();
+	}
+	region.initialized = true;
+}
+
+/**
+ * Get a water region, updating it first if it is out of date.
+ * @param index the water region index
+ * @return the water region
+ */
+static const WaterRegion &GetUpdatedWaterRegion(uint32 index)
+{
+	WaterRegion &region = _water_regions[index];
+	if (!region.initialized) UpdateWaterRegion(index, region);
+	return region;
+}
+
+/**
+ * Get the patch a tile belongs to.
+ * @param tile the tile
+ * @return the patch, or a patch with an invalid label if ships can't use the tile
+ */
+WaterRegionPatchDesc GetWaterRegionPatchInfo(TileIndex tile)
+{
+	const uint32 index = GetWaterRegionIndex(tile);
+	const WaterRegion &region = GetUpdatedWaterRegion(index);
+
+	WaterRegionPatchDesc patch;
+	patch.region = index;
+	if (region.tile_patch_labels.empty()) {
+		patch.label = (region.number_of_patches != 0 && GetWaterTrackdirs(tile) != TRACKDIR_BIT_NONE) ? 1 : INVALID_WATER_REGION_PATCH;
+	} else {
+		const uint i = (TileY(tile) % WATER_REGION_EDGE_LENGTH) * WATER_REGION_EDGE_LENGTH + TileX(tile) % WATER_REGION_EDGE_LENGTH;
+		patch.label = region.tile_patch_labels[i];
+	}
+	return patch;
+}
+
+/**
+ * Get the patches of the neighbouring water regions ships can reach directly from a patch.
+ * The order of the result only depends on the map, so it is the same on all clients.
+ * @param patch the patch
+ * @param[out] neighbours the reachable patches, cleared first
+ */
+void GetWaterRegionPatchNeighbours(const WaterRegionPatchDesc &patch, std::vector<WaterRegionPatchDesc> &neighbours)
+{
+	neighbours.clear();
+	if (!patch.IsValid()) return;
+
+	const WaterRegion &region = GetUpdatedWaterRegion(patch.region);
+	for (const WaterRegionExit &exit : region.exits) {
+		if (exit.label != patch.label) continue;
+
+		CFollowTrackWater F;
+		if (!F.Follow(exit.tile, exit.trackdir)) continue;
+
+		const WaterRegionPatchDesc neighbour = GetWaterRegionPatchInfo(F.m_new_tile);
+		if (!neighbour.IsValid()) continue;
+		if (std::find(neighbours.begin(), neighbours.end(), neighbour) == neighbours.end()) neighbours.push_back(neighbour);
+	}
+}
+
+/**
+ * Mark the water region of a tile out of date.
+ * Called whenever the type of a tile changes, which covers all changes to the tracks of ships.
+ * @param tile the changed tile
+ */
+void InvalidateWaterRegion(TileIndex tile)
+{
+	const uint32 index = GetWaterRegionIndex(tile);
+	if (index < _water_regions.size()) _water_regions[index].initialized = false;
+}
+
+/** Reset the water regions for the current map size. */
+void InitializeWaterRegions()
+{
+	_water_regions.clear();
+	_water_regions.resize((MapSizeX() / WATER_REGION_EDGE_LENGTH) * (MapSizeY() / WATER_REGION_EDGE_LENGTH));
+}
+
+/**
+ * Check the cached water regions against the map.
+ * @return true if all up to date regions match the map
+ */
+bool ValidateWaterRegions()
+{
+	for (uint32 index = 0; index < _water_regions.size(); index++) {
+		const WaterRegion &region = _water_regions[index];
+		if (!region.initialized) continue;
+
+		WaterRegion check;
+		UpdateWaterRegion(index, check);
+		if (check.number_of_patches != region.number_of_patches || check.tile_patch_labels != region.tile_patch_labels || !(check.exits == region.exits)) return false;
+	}
+	return true;
+}
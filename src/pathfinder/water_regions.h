@@ -0,0 +1,110 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file water_regions.h Handling of the water regions, the high level graph the ship pathfinder routes on. */
+
+#ifndef WATER_REGIONS_H
+#define WATER_REGIONS_H
+
+#include "../tile_type.h"
+#include "../tile_map.h"
+
+#include <vector>
+
+typedef uint8 WaterRegionPatchLabel;
+
+static const uint WATER_REGION_EDGE_LENGTH = 16; ///< Length of the edges of a water region in tiles.
+static const uint WATER_REGION_NUMBER_OF_TILES = WATER_REGION_EDGE_LENGTH * WATER_REGION_EDGE_LENGTH; ///< Number of tiles in a water region.
+
+static const WaterRegionPatchLabel INVALID_WATER_REGION_PATCH = 0; ///< Label of tiles which are not part of any patch.
+
+/**
+ * A patch is a set of water tiles within one water region which ships can move
+ * between without leaving the region.
+ */
+struct WaterRegionPatchDesc {
+	uint32 region;               ///< Index of the water region.
+	WaterRegionPatchLabel label; ///< Label of the patch within the region.
+
+	inline bool IsValid() const { return this->label != INVALID_WATER_REGION_PATCH; }
+
+	/** Get a unique number for this patch, suitable as a hash key. */
+	inline uint32 Pack() const { return (this->region << 8) | this->label; }
+
+	inline bool operator==(const WaterRegionPatchDesc &other) const { return this->region == other.region && this->label == other.label; }
+	inline bool operator!=(const WaterRegionPatchDesc &other) const { return !(*this == other); }
+};
+
+/**
+ * Get the number of water regions along the x axis of the map.
+ * @return the number of water regions
+ */
+static inline uint GetWaterRegionMapSizeX()
+{
+	return MapSizeX() / WATER_REGION_EDGE_LENGTH;
+}
+
+/**
+ * Get the index of the water region a tile is in.
+ * @param tile the tile
+ * @return the water region index
+ */
+static inline uint32 GetWaterRegionIndex(TileIndex tile)
+{
+	return (TileY(tile) / WATER_REGION_EDGE_LENGTH) * GetWaterRegionMapSizeX() + TileX(tile) / WATER_REGION_EDGE_LENGTH;
+}
+
+/**
+ * Get the x coordinate of a water region in the water region grid.
+ * @param region the water region index
+ * @return the x coordinate
+ */
+static inline uint GetWaterRegionX(uint32 region)
+{
+	return region % GetWaterRegionMapSizeX();
+}
+
+/**
+ * Get the y coordinate of a water region in the water region grid.
+ * @param region the water region index
+ * @return the y coordinate
+ */
+static inline uint GetWaterRegionY(uint32 region)
+{
+	return region / GetWaterRegionMapSizeX();
+}
+
+/**
+ * Get the northern tile of a water region.
+ * @param region the water region index
+ * @return the tile with the lowest x and y coordinates in the region
+ */
+static inline TileIndex GetWaterRegionNorthTile(uint32 region)
+{
+	return TileXY(GetWaterRegionX(region) * WATER_REGION_EDGE_LENGTH, GetWaterRegionY(region) * WATER_REGION_EDGE_LENGTH);
+}
+
+/**
+ * Get the distance between two water regions in the water region grid.
+ * @param a the first water region index
+ * @param b the second water region index
+ * @return the Manhattan distance of the regions
+ */
+static inline uint GetWaterRegionDistance(uint32 a, uint32 b)
+{
+	return Delta(GetWaterRegionX(a), GetWaterRegionX(b)) + Delta(GetWaterRegionY(a), GetWaterRegionY(b));
+}
+
+WaterRegionPatchDesc GetWaterRegionPatchInfo(TileIndex tile);
+void GetWaterRegionPatchNeighbours(const WaterRegionPatchDesc &patch, std::vector<WaterRegionPatchDesc> &neighbours);
+
+/* InvalidateWaterRegion is declared in tile_map.h, as it is called by SetTileType. */
+void InitializeWaterRegions();
+
+bool ValidateWaterRegions();
+
+#endif /* WATER_REGIONS_H */
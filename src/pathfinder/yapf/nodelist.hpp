@@ -13,32 +13,180 @@
 #include "../../misc/array.hpp"
 #include "../../misc/hashtable.hpp"
 #include "../../misc/binaryheap.hpp"
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Node storage for the node lists. Items are allocated in blocks which are kept
+ *  when the arena is reset, so a reused arena does not allocate again until it
+ *  has to hold more items than in any previous search.
+ */
+template <class Titem_, uint Tblock_size_ = 4096>
+class CNodeArenaT {
+public:
+	typedef Titem_ Titem;
+	static const uint Tblock_size = Tblock_size_;
+
+protected:
+	std::vector<Titem_ *> m_blocks; ///< allocated item blocks, not constructed
+	uint                  m_items;  ///< number of items in use
+
+public:
+	CNodeArenaT() : m_items(0) {}
+
+	~CNodeArenaT()
+	{
+		this->Reset();
+		for (Titem_ *block : m_blocks) free(block);
+	}
+
+	/** Destroy all items, but keep the memory blocks. */
+	inline void Reset()
+	{
+		if (!std::is_trivially_destructible<Titem_>::value) {
+			for (uint i = 0; i < m_items; i++) (*this)[i].~Titem_();
+		}
+		m_items = 0;
+	}
+
+	/**
+	 * Free the memory blocks which are not needed to hold the given number of items.
+	 * @param keep_items number of items the arena should still be able to hold without allocating.
+	 */
+	inline void Trim(uint keep_items)
+	{
+		uint keep_blocks = max(CeilDiv(max(keep_items, m_items), Tblock_size), 1u);
+		while (m_blocks.size() > keep_blocks) {
+			free(m_blocks.back());
+			m_blocks.pop_back();
+		}
+	}
+
+	/** allocate and construct new item */
+	inline Titem_ *AppendC()
+	{
+		uint block = m_items / Tblock_size;
+		if (block == m_blocks.size()) m_blocks.push_back(MallocT<Titem_>(Tblock_size));
+		Titem_ *item = m_blocks[block] + (m_items % Tblock_size);
+		m_items++;
+		return new (item) Titem_();
+	}
+
+	/** Return actual number of items */
+	inline uint Length() const
+	{
+		return m_items;
+	}
+
+	/** indexed access (non-const) */
+	inline Titem_& operator[](uint index)
+	{
+		assert(index < m_items);
+		return m_blocks[index / Tblock_size][index % Tblock_size];
+	}
+
+	/** indexed access (const) */
+	inline const Titem_& operator[](uint index) const
+	{
+		assert(index < m_items);
+		return m_blocks[index / Tblock_size][index % Tblock_size];
+	}
+
+	/**
+	 * Helper for creating a human readable output of this data.
+	 * @param dmp The location to dump to.
+	 */
+	template <typename D> void Dump(D &dmp) const
+	{
+		dmp.WriteLine("num_items = %d", m_items);
+		CStrA name;
+		for (uint i = 0; i < m_items; i++) {
+			const Titem_ &item = (*this)[i];
+			name.Format("item[%d]", i);
+			dmp.WriteStructT(name.Data(), &item);
+		}
+	}
+};
 
 /**
  * Hash table based node list multi-container class.
  *  Implements open list, closed list and priority queue for A-star
  *  path finder.
+ *
+ *  The containers are taken from a per-thread pool when the node list is constructed
+ *  and are returned to it, emptied, when it is destroyed. As all containers reset in
+ *  constant time, consecutive searches do not allocate nor clear any memory.
  */
 template <class Titem_, int Thash_bits_open_, int Thash_bits_closed_>
 class CNodeList_HashTableT {
 public:
 	typedef Titem_ Titem;                                        ///< Make #Titem_ visible from outside of class.
 	typedef typename Titem_::Key Key;                            ///< Make Titem_::Key a property of this class.
-	typedef SmallArray<Titem_, 65536, 256> CItemArray;           ///< Type that we will use as item container.
+	typedef CNodeArenaT<Titem_> CItemArray;                      ///< Type that we will use as item container.
 	typedef CHashTableT<Titem_, Thash_bits_open_  > COpenList;   ///< How pointers to open nodes will be stored.
 	typedef CHashTableT<Titem_, Thash_bits_closed_> CClosedList; ///< How pointers to closed nodes will be stored.
 	typedef CBinaryHeapT<Titem_> CPriorityQueue;                 ///< How the priority queue will be managed.
 
+	/** Number of nodes the pooled item array keeps memory for between searches. */
+	static const uint KEEP_ITEMS = 16 * CItemArray::Tblock_size;
+
+	/** Maximum number of unused containers kept per thread, node lists may be released on another thread than they were acquired on. */
+	static const uint KEEP_STORAGES = 8;
+
 protected:
-	CItemArray      m_arr;        ///< Here we store full item data (Titem_).
-	COpenList       m_open;       ///< Hash table of pointers to open item data.
-	CClosedList     m_closed;     ///< Hash table of pointers to closed item data.
-	CPriorityQueue  m_open_queue; ///< Priority queue of pointers to open item data.
+	/** The containers of one node list, reused by later node lists on the same thread. */
+	struct Storage {
+		CItemArray      arr;
+		COpenList       open;
+		CClosedList     closed;
+		CPriorityQueue  open_queue;
+
+		Storage() : open_queue(2048) {}
+	};
+
+	/** Pool of unused containers of this node list type for the current thread. */
+	static std::vector<std::unique_ptr<Storage>> &GetStoragePool()
+	{
+		static thread_local std::vector<std::unique_ptr<Storage>> pool;
+		return pool;
+	}
+
+	static Storage *AcquireStorage()
+	{
+		std::vector<std::unique_ptr<Storage>> &pool = GetStoragePool();
+		if (pool.empty()) return new Storage();
+		Storage *storage = pool.back().release();
+		pool.pop_back();
+		return storage;
+	}
+
+	static void ReleaseStorage(Storage *storage)
+	{
+		std::vector<std::unique_ptr<Storage>> &pool = GetStoragePool();
+		if (pool.size() >= KEEP_STORAGES) {
+			delete storage;
+			return;
+		}
+		storage->arr.Reset();
+		storage->arr.Trim(KEEP_ITEMS);
+		storage->open.Clear();
+		storage->closed.Clear();
+		storage->open_queue.Clear();
+		pool.emplace_back(storage);
+	}
+
+	Storage        *m_storage;    ///< Pooled containers.
+	CItemArray     &m_arr;        ///< Here we store full item data (Titem_).
+	COpenList      &m_open;       ///< Hash table of pointers to open item data.
+	CClosedList    &m_closed;     ///< Hash table of pointers to closed item data.
+	CPriorityQueue &m_open_queue; ///< Priority queue of pointers to open item data.
 	Titem          *m_new_node;   ///< New open node under construction.
 
 public:
 	/** default constructor */
-	CNodeList_HashTableT() : m_open_queue(2048)
+	CNodeList_HashTableT()
+		: m_storage(AcquireStorage()), m_arr(m_storage->arr), m_open(m_storage->open), m_closed(m_storage->closed), m_open_queue(m_storage->open_queue)
 	{
 		m_new_node = nullptr;
 	}
@@ -46,8 +194,12 @@ public:
 	/** destructor */
 	~CNodeList_HashTableT()
 	{
+		ReleaseStorage(m_storage);
 	}
 
+	CNodeList_HashTableT(const CNodeList_HashTableT &) = delete;
+	CNodeList_HashTableT &operator=(const CNodeList_HashTableT &) = delete;
+
 	/** return number of open nodes */
 	inline int OpenCount()
 	{
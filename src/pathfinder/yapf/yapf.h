@@ -17,6 +17,8 @@
 #include "../../roadveh.h"
 #include "../pathfinder_type.h"
 
+#include <vector>
+
 /**
  * Finds the best path for given ship using YAPF.
  * @param v        the ship that needs to find a path
@@ -59,6 +61,13 @@ Trackdir YapfRoadVehicleChooseTrack(const RoadVehicle *v, TileIndex tile, DiagDi
  */
 Track YapfTrainChooseTrack(const Train *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, bool reserve_track, struct PBSTileInfo *target);
 
+/**
+ * Run the path searches of the trains which are about to enter a junction ahead on the worker threads.
+ * YapfTrainChooseTrack() uses their results if nothing they depend on has changed in the meantime.
+ * @param trains the front vehicles of all trains
+ */
+void YapfPrefetchTrainPaths(const std::vector<Train *> &trains);
+
 /**
  * Used when user sends road vehicle to the nearest depot or if road vehicle needs servicing using YAPF.
  * @param v            vehicle that needs to go to some depot
@@ -324,6 +324,12 @@ public:
 		return m_veh;
 	}
 
+	/** Set the vehicle without searching, to act on a path found by another search. */
+	inline void SetVehicle(const VehicleType *v)
+	{
+		m_veh = v;
+	}
+
 	void DumpBase(DumpTarget &dmp) const
 	{
 		dmp.WriteStructT("m_nodes", &m_nodes);
@@ -11,6 +11,8 @@
 #define YAPF_COSTCACHE_HPP
 
 #include "../../date_func.h"
+#include <vector>
+#include <unordered_map>
 
 /**
  * CYapfSegmentCostCacheNoneT - the formal only yapf cost cache provider that implements
@@ -40,6 +42,11 @@ public:
 	inline void PfNodeCacheFlush(Node &n)
 	{
 	}
+
+	/** Called by YAPF with the tiles a calculated segment depends on. Not used. */
+	inline void PfNodeCacheIndexTiles(Node &n, const TileIndex *tiles, size_t count)
+	{
+	}
 };
 
 
@@ -87,23 +94,73 @@ public:
 	inline void PfNodeCacheFlush(Node &n)
 	{
 	}
+
+	/** Called by YAPF with the tiles a calculated segment depends on. Not used. */
+	inline void PfNodeCacheIndexTiles(Node &n, const TileIndex *tiles, size_t count)
+	{
+	}
 };
 
 
 /**
- * Base class for segment cost cache providers. Contains global counter
- *  of track layout changes and static notification function called whenever
+ * Base class for segment cost cache providers. Keeps the list of all global
+ *  segment cost caches and the static notification functions called whenever
  *  the track layout changes. It is implemented as base class because it needs
- *  to be shared between all rail YAPF types (one shared counter, one notification
- *  function.
+ *  to be shared between all rail YAPF types (one shared registry, one notification
+ *  function).
  */
 struct CSegmentCostCacheBase
 {
-	static int   s_rail_change_counter;
+	static std::vector<CSegmentCostCacheBase *> s_caches; ///< all global segment cost caches
+
+	uint64 m_hits;         ///< number of segments found in the cache
+	uint64 m_misses;       ///< number of segments which had to be (re)calculated
+	uint64 m_evictions;    ///< number of segments evicted because a tile they cross changed
+	uint64 m_flushes;      ///< number of times the whole cache was flushed
+	bool   m_reservation_dependent; ///< the cached segments depend on the path reservation state
+	bool   m_flush_pending; ///< flush the cache before it is used next time
+
+	CSegmentCostCacheBase(bool reservation_dependent)
+		: m_hits(0), m_misses(0), m_evictions(0), m_flushes(0), m_reservation_dependent(reservation_dependent), m_flush_pending(false)
+	{
+		s_caches.push_back(this);
+	}
+
+	virtual ~CSegmentCostCacheBase() {}
+
+	/** flush (clear) the cache */
+	virtual void Flush() = 0;
+
+	/** evict all segments which cross, or end next to, the given tile */
+	virtual void EvictTile(TileIndex tile) = 0;
+
+	/** number of segments currently in the cache */
+	virtual uint GetSegmentCount() const = 0;
+
+	/** number of tile index entries currently in the cache */
+	virtual uint GetTileIndexSize() const = 0;
 
 	static void NotifyTrackLayoutChange(TileIndex tile, Track track)
 	{
-		s_rail_change_counter++;
+		for (CSegmentCostCacheBase *cache : s_caches) {
+			if (tile == INVALID_TILE) {
+				cache->Flush();
+			} else {
+				cache->EvictTile(tile);
+			}
+		}
+	}
+
+	/**
+	 * Called when a pathfinder reserved a path. Only caches of pathfinders which mask
+	 *  reserved tracks depend on that, they are flushed before their next use as the
+	 *  segments of the reserving pathfinder may still be referenced.
+	 */
+	static void NotifyPathReservation()
+	{
+		for (CSegmentCostCacheBase *cache : s_caches) {
+			if (cache->m_reservation_dependent) cache->m_flush_pending = true;
+		}
 	}
 };
 
@@ -117,25 +174,64 @@ struct CSegmentCostCacheBase
  *  of the segment (origin tile and exit-dir from this tile).
  *  Different CYapfCachedCostT types can share the same type of CSegmentCostCacheT.
  *  Look at CYapfRailSegment (yapf_node_rail.hpp) for the segment example
+ *
+ *  Segments are also indexed by the tiles they cross, so that a track layout
+ *  change only evicts the segments running over the changed tile. Evicted
+ *  segments are recycled by later calls to Get(). Index entries of segments
+ *  evicted via another tile are dropped lazily when the index grows too big.
  */
 template <class Tsegment>
 struct CSegmentCostCacheT : public CSegmentCostCacheBase {
 	static const int C_HASH_BITS = 14;
+	static const uint C_MIN_TILE_INDEX_COMPACT_SIZE = 1 << 16;
 
 	typedef CHashTableT<Tsegment, C_HASH_BITS> HashTable;
 	typedef SmallArray<Tsegment> Heap;
 	typedef typename Tsegment::Key Key;    ///< key to hash table
+	typedef std::unordered_multimap<TileIndex, Key> TileIndexMap;
 
 	HashTable    m_map;
 	Heap         m_heap;
+	std::vector<Tsegment *> m_free;        ///< evicted segments which can be reused
+	TileIndexMap m_tile_index;             ///< segments by the tiles they cross
+	size_t       m_tile_index_compact_size; ///< tile index size above which the index is compacted
 
-	inline CSegmentCostCacheT() {}
+	inline CSegmentCostCacheT(bool reservation_dependent) : CSegmentCostCacheBase(reservation_dependent), m_tile_index_compact_size(C_MIN_TILE_INDEX_COMPACT_SIZE) {}
 
 	/** flush (clear) the cache */
-	inline void Flush()
+	void Flush() override
 	{
 		m_map.Clear();
 		m_heap.Clear();
+		m_free.clear();
+		m_tile_index.clear();
+		m_tile_index_compact_size = C_MIN_TILE_INDEX_COMPACT_SIZE;
+		m_flush_pending = false;
+		m_flushes++;
+	}
+
+	void EvictTile(TileIndex tile) override
+	{
+		auto range = m_tile_index.equal_range(tile);
+		if (range.first == range.second) return;
+		for (auto it = range.first; it != range.second; ++it) {
+			Tsegment *item = m_map.TryPop(it->second);
+			if (item != nullptr) {
+				m_free.push_back(item);
+				m_evictions++;
+			}
+		}
+		m_tile_index.erase(range.first, range.second);
+	}
+
+	uint GetSegmentCount() const override
+	{
+		return m_map.Count();
+	}
+
+	uint GetTileIndexSize() const override
+	{
+		return (uint)m_tile_index.size();
 	}
 
 	inline Tsegment& Get(Key &key, bool *found)
@@ -143,13 +239,49 @@ struct CSegmentCostCacheT : public CSegmentCostCacheBase {
 		Tsegment *item = m_map.Find(key);
 		if (item == nullptr) {
 			*found = false;
-			item = new (m_heap.Append()) Tsegment(key);
+			m_misses++;
+			if (!m_free.empty()) {
+				item = new (m_free.back()) Tsegment(key);
+				m_free.pop_back();
+			} else {
+				item = new (m_heap.Append()) Tsegment(key);
+			}
 			m_map.Push(*item);
 		} else {
 			*found = true;
+			m_hits++;
 		}
 		return *item;
 	}
+
+	/**
+	 * Record which tiles a freshly calculated segment depends on.
+	 * @param segment the segment
+	 * @param tiles the tiles crossed by the segment, and the tile following it
+	 * @param count number of tiles
+	 */
+	void IndexSegmentTiles(const Tsegment &segment, const TileIndex *tiles, size_t count)
+	{
+		if (m_tile_index.size() + count > m_tile_index_compact_size) CompactTileIndex();
+		for (size_t i = 0; i < count; i++) {
+			if (i > 0 && tiles[i] == tiles[i - 1]) continue;
+			m_tile_index.emplace(tiles[i], segment.GetKey());
+		}
+	}
+
+private:
+	/** drop tile index entries of segments which are no longer in the cache */
+	void CompactTileIndex()
+	{
+		for (auto it = m_tile_index.begin(); it != m_tile_index.end();) {
+			if (m_map.Find(it->second) == nullptr) {
+				it = m_tile_index.erase(it);
+			} else {
+				++it;
+			}
+		}
+		m_tile_index_compact_size = std::max<size_t>(C_MIN_TILE_INDEX_COMPACT_SIZE, m_tile_index.size() * 2);
+	}
 };
 
 /**
@@ -179,11 +311,21 @@ protected:
 		return *static_cast<Tpf *>(this);
 	}
 
+public:
+	/**
+	 * Bring the global cache up to date on the main thread, so that pathfinders constructed
+	 *  on other threads afterwards only read the shared cache state.
+	 */
+	inline static void stPrepareGlobalCache()
+	{
+		stGetGlobalCache();
+	}
+
+protected:
 	inline static Cache& stGetGlobalCache()
 	{
-		static int last_rail_change_counter = 0;
 		static Date last_date = 0;
-		static Cache C;
+		static Cache C(Types::TrackFollower::DoTrackMasking());
 
 		/* some statistics */
 		if (last_date != _date) {
@@ -192,11 +334,8 @@ protected:
 			_total_pf_time_us = 0;
 		}
 
-		/* delete the cache sometimes... */
-		if (last_rail_change_counter != Cache::s_rail_change_counter) {
-			last_rail_change_counter = Cache::s_rail_change_counter;
-			C.Flush();
-		}
+		/* a reservation made by another pathfinder may have changed the segments */
+		if (C.m_flush_pending) C.Flush();
 		return C;
 	}
 
@@ -224,6 +363,15 @@ public:
 	inline void PfNodeCacheFlush(Node &n)
 	{
 	}
+
+	/**
+	 * Called by YAPF after the segment cost of the given node was calculated, with the
+	 *  tiles the segment depends on. Used to evict the segment when one of them changes.
+	 */
+	inline void PfNodeCacheIndexTiles(Node &n, const TileIndex *tiles, size_t count)
+	{
+		if (Yapf().CanUseGlobalCache(n)) m_global_cache.IndexSegmentTiles(*n.m_segment, tiles, count);
+	}
 };
 
 #endif /* YAPF_COSTCACHE_HPP */
@@ -56,6 +56,9 @@ protected:
 	int           m_max_cost;
 	CBlobT<int>   m_sig_look_ahead_costs;
 	bool          m_disable_cache;
+	std::vector<TileIndex> m_segment_tiles; ///< tiles the segment being calculated depends on
+	std::vector<TileIndex> *m_read_tiles; ///< if not nullptr, collects the tiles all calculated segments depend on
+	bool          m_speculation_failed; ///< the search needed state which is not covered by m_read_tiles
 
 public:
 	bool          m_stopped_on_first_two_way_signal;
@@ -63,7 +66,7 @@ protected:
 
 	static const int s_max_segment_cost = 10000;
 
-	CYapfCostRailT() : m_max_cost(0), m_disable_cache(false), m_stopped_on_first_two_way_signal(false)
+	CYapfCostRailT() : m_max_cost(0), m_disable_cache(false), m_read_tiles(nullptr), m_speculation_failed(false), m_stopped_on_first_two_way_signal(false)
 	{
 		/* pre-compute look-ahead penalties into array */
 		int p0 = Yapf().PfGetSettings().rail_look_ahead_signal_p0;
@@ -269,7 +272,14 @@ private:
 			flags_to_check |= TRPAUF_REVERSE;
 		}
 		if (prog && prog->actions_used_flags & flags_to_check) {
-			prog->Execute(Yapf().GetVehicle(), TraceRestrictProgramInput(tile, trackdir, &TraceRestrictPreviousSignalCallback, &n), out);
+			if (m_read_tiles != nullptr) {
+				/* The program may depend on any vehicle or company state, and must not run off the main thread. */
+				m_speculation_failed = true;
+				return false;
+			}
+			TraceRestrictProgramInput input(tile, trackdir, &TraceRestrictPreviousSignalCallback, &n);
+			input.query_actions = flags_to_check;
+			prog->Execute(Yapf().GetVehicle(), input, out);
 			if (out.flags & TRPRF_RESERVE_THROUGH && is_res_through != nullptr) {
 				*is_res_through = true;
 			}
@@ -427,6 +437,7 @@ public:
 		/* Do we already have a cached segment? */
 		CachedData &segment = *n.m_segment;
 		bool is_cached_segment = (segment.m_cost >= 0);
+		m_segment_tiles.clear();
 
 		int parent_cost = has_parent ? n.m_parent->m_cost : 0;
 
@@ -529,6 +540,13 @@ public:
 
 no_entry_cost: // jump here at the beginning if the node has no parent (it is the first node)
 
+			/* Remember the tiles of the segment, so it can be evicted from the cache when one of them changes. */
+			if (tf->m_is_station) {
+				TileIndexDiff diff = TileOffsByDiagDir(TrackdirToExitdir(cur.td));
+				for (int i = tf->m_tiles_skipped; i > 0; i--) m_segment_tiles.push_back(cur.tile - diff * i);
+			}
+			m_segment_tiles.push_back(cur.tile);
+
 			/* All other tile costs will be calculated here. */
 			segment_cost += Yapf().OneTileCost(cur.tile, cur.td);
 
@@ -641,7 +659,12 @@ no_entry_cost: // jump here at the beginning if the node has no parent (it is th
 			tf = &tf_local;
 			tf_local.Init(v, Yapf().GetCompatibleRailTypes(), &Yapf().m_perf_ts_cost);
 
-			if (!tf_local.Follow(cur.tile, cur.td)) {
+			bool followed = tf_local.Follow(cur.tile, cur.td);
+
+			/* Where the segment ends also depends on the tile following it. */
+			if (tf_local.m_new_tile != INVALID_TILE) m_segment_tiles.push_back(tf_local.m_new_tile);
+
+			if (!followed) {
 				assert(tf_local.m_err != TrackFollower::EC_NONE);
 				/* Can't move to the next tile (EOL?). */
 				if (tf_local.m_err == TrackFollower::EC_RAIL_ROAD_TYPE) {
@@ -729,6 +752,8 @@ no_entry_cost: // jump here at the beginning if the node has no parent (it is th
 			segment.m_end_segment_reason = end_segment_reason & ESRB_CACHED_MASK;
 			/* Save end of segment back to the node. */
 			n.SetLastTileTrackdir(cur.tile, cur.td);
+			Yapf().PfNodeCacheIndexTiles(n, m_segment_tiles.data(), m_segment_tiles.size());
+			if (m_read_tiles != nullptr) m_read_tiles->insert(m_read_tiles->end(), m_segment_tiles.begin(), m_segment_tiles.end());
 		}
 
 		/* Do we have an excuse why not to continue pathfinding in this direction? */
@@ -771,13 +796,18 @@ no_entry_cost: // jump here at the beginning if the node has no parent (it is th
 		return true;
 	}
 
-	inline bool CanUseGlobalCache(Node &n) const
+	/** Would the global cache be used for the node if it was not disabled for this search? */
+	inline bool IsGlobalCacheNode(Node &n) const
 	{
-		return !m_disable_cache
-			&& (n.m_parent != nullptr)
+		return (n.m_parent != nullptr)
 			&& (n.m_parent->m_num_signals_passed >= m_sig_look_ahead_costs.Size());
 	}
 
+	inline bool CanUseGlobalCache(Node &n) const
+	{
+		return !m_disable_cache && IsGlobalCacheNode(n);
+	}
+
 	inline void ConnectNodeToCachedData(Node &n, CachedData &ci)
 	{
 		n.m_segment = &ci;
@@ -791,6 +821,22 @@ no_entry_cost: // jump here at the beginning if the node has no parent (it is th
 	{
 		m_disable_cache = disable;
 	}
+
+	/**
+	 * Run the search speculatively: only map state is read and all tiles it is read from are collected.
+	 * @param read_tiles where to collect the tiles, or nullptr to disable speculative mode
+	 */
+	void SetSpeculativeReadTiles(std::vector<TileIndex> *read_tiles)
+	{
+		m_read_tiles = read_tiles;
+		m_speculation_failed = false;
+	}
+
+	/** Did a speculative search depend on state other than the collected tiles? */
+	bool HasSpeculationFailed() const
+	{
+		return m_speculation_failed;
+	}
 };
 
 #endif /* YAPF_COSTRAIL_HPP */
@@ -116,6 +116,35 @@ struct CYapfRailSegment
 	}
 };
 
+/**
+ * Call a function for the tiles of a rail segment, from its first tile to its last one.
+ * @param v the train
+ * @param railtypes the rail types the train can use
+ * @param cur the first tile
+ * @param cur_td the first trackdir
+ * @param last the last tile
+ * @param last_td the last trackdir
+ * @param obj the object to call the function on
+ * @param func the function, returning false to stop the iteration
+ * @return false if the iteration has been stopped by the function
+ */
+template <class Tbase, class Tfunc>
+inline bool IterateRailSegmentTiles(const Train *v, RailTypes railtypes, TileIndex cur, Trackdir cur_td, TileIndex last, Trackdir last_td, Tbase &obj, bool (Tfunc::*func)(TileIndex, Trackdir))
+{
+	typename Tbase::TrackFollower ft(v, railtypes);
+
+	while (cur != last || cur_td != last_td) {
+		if (!((obj.*func)(cur, cur_td))) return false;
+
+		if (!ft.Follow(cur, cur_td)) break;
+		cur = ft.m_new_tile;
+		assert(KillFirstBit(ft.m_new_td_bits) == TRACKDIR_BIT_NONE);
+		cur_td = FindFirstTrackdir(ft.m_new_td_bits);
+	}
+
+	return (obj.*func)(cur, cur_td);
+}
+
 /** Yapf Node for rail YAPF */
 template <class Tkey_>
 struct CYapfRailNodeT
@@ -199,20 +228,7 @@ struct CYapfRailNodeT
 	template <class Tbase, class Tfunc, class Tpf>
 	bool IterateTiles(const Train *v, Tpf &yapf, Tbase &obj, bool (Tfunc::*func)(TileIndex, Trackdir)) const
 	{
-		typename Tbase::TrackFollower ft(v, yapf.GetCompatibleRailTypes());
-		TileIndex cur = base::GetTile();
-		Trackdir  cur_td = base::GetTrackdir();
-
-		while (cur != GetLastTile() || cur_td != GetLastTrackdir()) {
-			if (!((obj.*func)(cur, cur_td))) return false;
-
-			if (!ft.Follow(cur, cur_td)) break;
-			cur = ft.m_new_tile;
-			assert(KillFirstBit(ft.m_new_td_bits) == TRACKDIR_BIT_NONE);
-			cur_td = FindFirstTrackdir(ft.m_new_td_bits);
-		}
-
-		return (obj.*func)(cur, cur_td);
+		return IterateRailSegmentTiles(v, yapf.GetCompatibleRailTypes(), base::GetTile(), base::GetTrackdir(), GetLastTile(), GetLastTrackdir(), obj, func);
 	}
 
 	void Dump(DumpTarget &dmp) const
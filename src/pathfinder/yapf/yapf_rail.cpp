@@ -17,6 +17,13 @@
 #include "../../viewport_func.h"
 #include "../../newgrf_station.h"
 #include "../../tracerestrict.h"
+#include "../../waypoint_base.h"
+#include "../../signal_func.h"
+#include "../../worker_thread.h"
+
+#include <atomic>
+#include <memory>
+#include <unordered_map>
 
 #include "../../safeguards.h"
 
@@ -67,6 +74,32 @@ template <typename Tpf> void DumpState(Tpf &pf1, Tpf &pf2)
 
 int _total_pf_time_us = 0;
 
+/**
+ * A node of a train path found by a search run ahead, with only what choosing the track and
+ * reserving the path need, so the search itself does not have to be kept until it is used.
+ */
+struct CYapfRailPathNode {
+	CYapfRailPathNode *m_parent;           ///< previous node of the path, nullptr for the origin
+	TileIndex m_tile;                      ///< first tile of the node
+	Trackdir m_td;                         ///< first trackdir of the node
+	TileIndex m_last_tile;                 ///< last tile of the segment of the node
+	Trackdir m_last_td;                    ///< last trackdir of the segment of the node
+	uint16 m_num_signals_passed;           ///< signals passed up to the end of the node
+	uint16 m_num_signals_res_through_passed; ///< reserve through signals passed up to the end of the node
+	bool m_global_cache;                   ///< whether a search with the segment cost cache enabled uses the global cache for the node
+
+	inline Trackdir GetTrackdir() const { return m_td; }
+	inline TileIndex GetLastTile() const { return m_last_tile; }
+	inline Trackdir GetLastTrackdir() const { return m_last_td; }
+
+	template <class Tbase, class Tfunc, class Tpf>
+	bool IterateTiles(const Train *v, Tpf &yapf, Tbase &obj, bool (Tfunc::*func)(TileIndex, Trackdir)) const
+	{
+		/* The search which found the node used the rail types of the train. */
+		return IterateRailSegmentTiles(v, v->compatible_railtypes, m_tile, m_td, m_last_tile, m_last_td, obj, func);
+	}
+};
+
 template <class Types>
 class CYapfReserveTrack
 {
@@ -85,7 +118,6 @@ protected:
 private:
 	TileIndex m_res_dest;         ///< The reservation target tile
 	Trackdir  m_res_dest_td;      ///< The reservation target trackdir
-	Node      *m_res_node;        ///< The reservation target node
 	TileIndex m_res_fail_tile;    ///< The tile where the reservation failed
 	Trackdir  m_res_fail_td;      ///< The trackdir where the reservation failed
 	TileIndex m_origin_tile;      ///< Tile our reservation will originate from
@@ -157,28 +189,45 @@ private:
 
 public:
 	/** Set the target to where the reservation should be extended. */
-	inline void SetReservationTarget(Node *node, TileIndex tile, Trackdir td)
+	inline void SetReservationTarget(TileIndex tile, Trackdir td)
 	{
-		m_res_node = node;
 		m_res_dest = tile;
 		m_res_dest_td = td;
 	}
 
-	/** Check the node for a possible reservation target. */
-	inline void FindSafePositionOnNode(Node *node)
+	/**
+	 * Check the node for a possible reservation target.
+	 * @return true if the node has a safe position, which is now the reservation target
+	 */
+	template <class TNode>
+	inline bool FindSafePositionOnNode(TNode *node)
 	{
 		assert(node->m_parent != nullptr);
 
 		/* We will never pass more than two non-reserve-through signals, no need to check for a safe tile. */
-		if (node->m_parent->m_num_signals_passed - node->m_parent->m_num_signals_res_through_passed >= 2) return;
+		if (node->m_parent->m_num_signals_passed - node->m_parent->m_num_signals_res_through_passed >= 2) return false;
 
-		if (!node->IterateTiles(Yapf().GetVehicle(), Yapf(), *this, &CYapfReserveTrack<Types>::FindSafePositionProc)) {
-			m_res_node = node;
-		}
+		return !node->IterateTiles(Yapf().GetVehicle(), Yapf(), *this, &CYapfReserveTrack<Types>::FindSafePositionProc);
+	}
+
+	/** Does reserving a path ending at the node change segments in the global segment cost cache? */
+	inline bool UsesGlobalCache(Node &node)
+	{
+		return Yapf().CanUseGlobalCache(node);
 	}
 
-	/** Try to reserve the path till the reservation target. */
-	bool TryReservePath(PBSTileInfo *target, TileIndex origin)
+	/** Does reserving a path found ahead and ending at the node change segments in the global segment cost cache, as it would for a search run now? */
+	inline bool UsesGlobalCache(CYapfRailPathNode &node)
+	{
+		return node.m_global_cache;
+	}
+
+	/**
+	 * Try to reserve the path till the reservation target.
+	 * @param res_node the node of the reservation target
+	 */
+	template <class TNode>
+	bool TryReservePath(TNode *res_node, PBSTileInfo *target, TileIndex origin)
 	{
 		m_res_fail_tile = INVALID_TILE;
 		m_origin_tile = origin;
@@ -193,11 +242,11 @@ public:
 		PBSWaitingPositionRestrictedSignalInfo restricted_signal_info;
 		if (!IsWaitingPositionFree(Yapf().GetVehicle(), m_res_dest, m_res_dest_td, false, &restricted_signal_info)) return false;
 
-		for (Node *node = m_res_node; node->m_parent != nullptr; node = node->m_parent) {
+		for (TNode *node = res_node; node->m_parent != nullptr; node = node->m_parent) {
 			node->IterateTiles(Yapf().GetVehicle(), Yapf(), *this, &CYapfReserveTrack<Types>::ReserveSingleTrack);
 			if (m_res_fail_tile != INVALID_TILE) {
 				/* Reservation failed, undo. */
-				Node *fail_node = m_res_node;
+				TNode *fail_node = res_node;
 				TileIndex stop_tile = m_res_fail_tile;
 				do {
 					/* If this is the node that failed, stop at the failed tile. */
@@ -223,8 +272,8 @@ public:
 
 		if (target != nullptr) target->okay = true;
 
-		if (Yapf().CanUseGlobalCache(*m_res_node)) {
-			YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+		if (this->UsesGlobalCache(*res_node)) {
+			CSegmentCostCacheBase::NotifyPathReservation();
 		}
 
 		return true;
@@ -444,7 +493,8 @@ public:
 
 		/* Found a destination, set as reservation target. */
 		Node *pNode = Yapf().GetBestNode();
-		this->SetReservationTarget(pNode, pNode->GetLastTile(), pNode->GetLastTrackdir());
+		Node *res_node = pNode;
+		this->SetReservationTarget(pNode->GetLastTile(), pNode->GetLastTrackdir());
 
 		/* Walk through the path back to the origin. */
 		Node *pPrev = nullptr;
@@ -452,10 +502,106 @@ public:
 			pPrev = pNode;
 			pNode = pNode->m_parent;
 
-			this->FindSafePositionOnNode(pPrev);
+			if (this->FindSafePositionOnNode(pPrev)) res_node = pPrev;
 		}
 
-		return dont_reserve || this->TryReservePath(nullptr, pNode->GetLastTile());
+		return dont_reserve || this->TryReservePath(res_node, nullptr, pNode->GetLastTile());
+	}
+};
+
+/** Bumped on every change of the track layout, which covers the station and signal data the train pathfinder reads besides the map. */
+static uint64 _yapf_track_layout_epoch = 0;
+
+/** Statistics of the speculative train path searches. */
+static struct {
+	uint64 searches; ///< searches run ahead on the worker threads
+	uint64 used;     ///< searches whose result was used by the train
+	uint64 rejected; ///< searches whose inputs had changed when the train needed them
+} _speculative_train_path_stats;
+
+/**
+ * Hash the contents of the tiles a speculative train path search has read.
+ * The heights of the other corners are included as they determine the slope of the tile.
+ * @param tiles the tiles
+ * @return the hash
+ */
+static uint64 HashSpeculativeReadTiles(const std::vector<TileIndex> &tiles)
+{
+	uint64 hash = 0xCBF29CE484222325ULL;
+	auto mix = [&hash](uint64 value) {
+		hash = (hash ^ value) * 0x100000001B3ULL;
+	};
+	for (TileIndex t : tiles) {
+		mix(t);
+		mix((uint64)_m[t].type | ((uint64)_m[t].height << 8) | ((uint64)_m[t].m1 << 16) | ((uint64)_m[t].m3 << 24) |
+				((uint64)_m[t].m4 << 32) | ((uint64)_m[t].m5 << 40) | ((uint64)_m[t].m2 << 48));
+		mix((uint64)_me[t].m6 | ((uint64)_me[t].m7 << 8) | ((uint64)_me[t].m8 << 16));
+		if (TileX(t) < MapMaxX() && TileY(t) < MapMaxY()) {
+			mix((uint64)TileHeight(t + TileDiffXY(1, 0)) | ((uint64)TileHeight(t + TileDiffXY(0, 1)) << 8) | ((uint64)TileHeight(t + TileDiffXY(1, 1)) << 16));
+		}
+	}
+	return hash;
+}
+
+/**
+ * Is the train about to enter a junction for which it has no reserved path, i.e. will
+ * it probably run the pathfinder from its current position soon?
+ * @param v the front of the train
+ * @return true if a path search can be run ahead for the train
+ */
+static bool IsSpeculativeTrainPathCandidate(const Train *v)
+{
+	if ((v->vehstatus & (VS_CRASHED | VS_STOPPED)) != 0) return false;
+	if ((v->track & (TRACK_BIT_DEPOT | TRACK_BIT_WORMHOLE)) != 0) return false;
+
+	/* Orders which ChooseTrainTrack() skips before pathfinding. */
+	if (v->current_order.IsAnyLoadingType() || v->current_order.IsType(OT_LEAVESTATION)) return false;
+	/* The look ahead for complex waypoints is not covered by the tracked tiles. */
+	if (v->current_order.IsType(OT_GOTO_WAYPOINT) && !Waypoint::Get(v->current_order.GetDestination())->IsSingleTile()) return false;
+
+	CFollowTrackRail ft(v);
+	if (!ft.Follow(v->tile, v->GetVehicleTrackdir())) return false;
+	if (ft.m_tiles_skipped == 0 && Rail90DegTurnDisallowedTilesFromTrackdir(ft.m_old_tile, ft.m_new_tile, ft.m_old_td)) {
+		ft.m_new_td_bits &= ~TrackdirCrossesTrackdirs(ft.m_old_td);
+	}
+	if (KillFirstBit(ft.m_new_td_bits) == TRACKDIR_BIT_NONE) return false;
+
+	/* A train with a path reserved into the junction follows its reservation. */
+	return !HasReservedTracks(ft.m_new_tile, TrackdirBitsToTrackBits(ft.m_new_td_bits));
+}
+
+/** Everything apart from the map contents which decides the result of a train path search. */
+struct SpeculativeTrainPathKey {
+	const Train *v;                  ///< the train
+	TileIndex tile;                  ///< tile of the train
+	PBSTileInfo origin;              ///< end of the reservation of the train, the origin of the search
+	OrderType order_type;            ///< type of the current order
+	DestinationID order_destination; ///< destination of the current order
+	TileIndex dest_tile;             ///< destination tile of the train
+	RailTypes compatible_railtypes;  ///< rail types the train can run on
+	RailType railtype;               ///< rail type of the train
+	Owner owner;                     ///< owner of the train
+	uint max_speed;                  ///< maximum speed of the train
+	uint16 total_length;             ///< length of the train
+	uint64 layout_epoch;             ///< track layout epoch
+	YAPFSettings settings;           ///< pathfinder settings
+
+	SpeculativeTrainPathKey(const Train *v)
+		: v(v), tile(v->tile), origin(FollowTrainReservation(v)), order_type(v->current_order.GetType()),
+		order_destination(v->current_order.GetDestination()), dest_tile(v->dest_tile),
+		compatible_railtypes(v->compatible_railtypes), railtype(v->railtype), owner(v->owner),
+		max_speed(v->GetDisplayMaxSpeed()), total_length(v->gcache.cached_total_length),
+		layout_epoch(_yapf_track_layout_epoch), settings(_settings_game.pf.yapf) {}
+
+	bool operator==(const SpeculativeTrainPathKey &other) const
+	{
+		return this->v == other.v && this->tile == other.tile && this->origin.tile == other.origin.tile &&
+				this->origin.trackdir == other.origin.trackdir && this->order_type == other.order_type &&
+				this->order_destination == other.order_destination && this->dest_tile == other.dest_tile &&
+				this->compatible_railtypes == other.compatible_railtypes && this->railtype == other.railtype &&
+				this->owner == other.owner && this->max_speed == other.max_speed &&
+				this->total_length == other.total_length && this->layout_epoch == other.layout_epoch &&
+				memcmp(&this->settings, &other.settings, sizeof(YAPFSettings)) == 0;
 	}
 };
 
@@ -510,8 +656,166 @@ public:
 		return 't';
 	}
 
+protected:
+	/** A train path search run ahead of the train needing it. */
+	struct SpeculativePath {
+		SpeculativeTrainPathKey key;          ///< the inputs of the search besides the map
+		bool searched;                        ///< whether the search has been run
+		bool usable;                          ///< whether the search could be run ahead, so its result is below
+		bool path_found;                      ///< whether a path has been found
+		bool stopped_on_first_two_way_signal; ///< whether the search stopped on the first two way signal
+		std::vector<CYapfRailPathNode> nodes; ///< the path from the best node back to the origin, empty if there is none
+		std::vector<TileIndex> read_tiles;    ///< tiles the search depends on
+		uint64 read_hash;                     ///< hash of the contents of read_tiles at the time of the search
+
+		SpeculativePath(const SpeculativeTrainPathKey &key) : key(key), searched(false), usable(false), path_found(false), stopped_on_first_two_way_signal(false), read_hash(0) {}
+
+		/* The nodes point to their parents in the same vector. */
+		SpeculativePath(const SpeculativePath &) = delete;
+		SpeculativePath(SpeculativePath &&) = default;
+		SpeculativePath &operator=(SpeculativePath &&) = default;
+
+		/**
+		 * Run the search, unless the result of a previous one is still valid. Called on the worker threads.
+		 * @return true if the search has been run
+		 */
+		bool Update()
+		{
+			if (this->searched && (!this->usable || HashSpeculativeReadTiles(this->read_tiles) == this->read_hash)) return false;
+
+			this->searched = true;
+			this->usable = false;
+			this->nodes.clear();
+			this->read_tiles.clear();
+
+			Tpf pf;
+			pf.DisableCache(true);
+			pf.SetSpeculativeReadTiles(&this->read_tiles);
+			this->path_found = pf.FindTrainPath(this->key.v, this->key.origin);
+			if (pf.HasSpeculationFailed()) return true;
+			pf.SetSpeculativeReadTiles(nullptr);
+
+			this->usable = true;
+			this->stopped_on_first_two_way_signal = pf.m_stopped_on_first_two_way_signal;
+			size_t count = 0;
+			for (Node *n = pf.GetBestNode(); n != nullptr; n = n->m_parent) count++;
+			this->nodes.resize(count);
+			CYapfRailPathNode *path_node = this->nodes.data();
+			for (Node *n = pf.GetBestNode(); n != nullptr; n = n->m_parent, path_node++) {
+				path_node->m_parent = (n->m_parent != nullptr) ? path_node + 1 : nullptr;
+				path_node->m_tile = n->GetTile();
+				path_node->m_td = n->GetTrackdir();
+				path_node->m_last_tile = n->GetLastTile();
+				path_node->m_last_td = n->GetLastTrackdir();
+				path_node->m_num_signals_passed = n->m_num_signals_passed;
+				path_node->m_num_signals_res_through_passed = n->m_num_signals_res_through_passed;
+				/* Only the speculative search disables the cache, complex waypoints are not searched ahead.
+				 * Whether the reservation notifies the global cache must not depend on this. */
+				path_node->m_global_cache = pf.IsGlobalCacheNode(*n);
+			}
+
+			this->read_tiles.push_back(this->key.origin.tile);
+			if (this->key.dest_tile != INVALID_TILE) this->read_tiles.push_back(this->key.dest_tile);
+			this->read_hash = HashSpeculativeReadTiles(this->read_tiles);
+			return true;
+		}
+	};
+
+	typedef std::unordered_map<VehicleID, SpeculativePath> SpeculativePaths;
+
+	static SpeculativePaths &stSpeculativePaths()
+	{
+		static SpeculativePaths paths;
+		return paths;
+	}
+
+	/**
+	 * Use the search run ahead for the train, if its inputs are unchanged: choose the track and reserve the path.
+	 * @param v the train
+	 * @param path_found [out] whether the search found a path
+	 * @param reserve_track whether to reserve the path
+	 * @param target [out] the end of the reservation
+	 * @param trackdir [out] the chosen trackdir
+	 * @return false if there is no usable search, so it has to be run now
+	 */
+	static bool stUseSpeculativePath(const Train *v, bool &path_found, bool reserve_track, PBSTileInfo *target, Trackdir &trackdir)
+	{
+		SpeculativePaths &paths = stSpeculativePaths();
+		if (paths.empty()) return false;
+		auto iter = paths.find(v->index);
+		if (iter == paths.end()) return false;
+
+		SpeculativePath path = std::move(iter->second);
+		paths.erase(iter);
+		if (!path.usable) return false;
+		if (!(path.key == SpeculativeTrainPathKey(v)) || HashSpeculativeReadTiles(path.read_tiles) != path.read_hash) {
+			_speculative_train_path_stats.rejected++;
+			return false;
+		}
+		_speculative_train_path_stats.used++;
+
+		if (target != nullptr) target->tile = INVALID_TILE;
+		path_found = path.path_found;
+		Tpf pf;
+		pf.SetVehicle(v);
+		trackdir = pf.FinishChooseRailTrack(path.nodes.empty() ? nullptr : path.nodes.data(), path.stopped_on_first_two_way_signal, path_found, reserve_track, target);
+		return true;
+	}
+
+public:
+	/**
+	 * Run the path searches of the trains about to enter a junction on the worker threads.
+	 * The map is only read meanwhile; the results are used by stChooseRailTrack() if
+	 * nothing they depend on has changed by then, so they are the same as those of a search
+	 * run at that time.
+	 * @param trains the front vehicles of all trains
+	 */
+	static void stPrefetchPaths(const std::vector<Train *> &trains)
+	{
+		SpeculativePaths &paths = stSpeculativePaths();
+		SpeculativePaths next;
+		std::vector<SpeculativePath *> pending;
+		for (const Train *v : trains) {
+			if (!IsSpeculativeTrainPathCandidate(v)) continue;
+
+			SpeculativeTrainPathKey key(v);
+			auto iter = paths.find(v->index);
+			if (iter != paths.end() && iter->second.key == key) {
+				pending.push_back(&next.emplace(v->index, std::move(iter->second)).first->second);
+			} else {
+				pending.push_back(&next.emplace(v->index, SpeculativePath(key)).first->second);
+			}
+		}
+		paths.swap(next);
+		next.clear();
+		if (pending.empty()) return;
+
+		/* Construct the shared segment cost cache now, the searches only read it. */
+		Tpf::stPrepareGlobalCache();
+
+		std::atomic<uint> searches(0);
+		WorkerParallelFor("ottd:yapf-train", pending.size(), 1, [&](size_t begin, size_t end) {
+			uint count = 0;
+			for (size_t i = begin; i < end; i++) {
+				if (pending[i]->Update()) count++;
+			}
+			searches += count;
+		});
+		_speculative_train_path_stats.searches += searches;
+	}
+
+	static void stClearSpeculativePaths()
+	{
+		stSpeculativePaths().clear();
+	}
+
 	static Trackdir stChooseRailTrack(const Train *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, bool reserve_track, PBSTileInfo *target)
 	{
+		if (_debug_yapfdesync_level < 1 && _debug_desync_level < 2) {
+			Trackdir trackdir;
+			if (stUseSpeculativePath(v, path_found, reserve_track, target, trackdir)) return trackdir;
+		}
+
 		/* create pathfinder instance */
 		Tpf pf1;
 		Trackdir result1;
@@ -538,39 +842,61 @@ public:
 	{
 		if (target != nullptr) target->tile = INVALID_TILE;
 
+		path_found = FindTrainPath(v, FollowTrainReservation(v));
+		return FinishChooseRailTrack(Yapf().GetBestNode(), Yapf().m_stopped_on_first_two_way_signal, path_found, reserve_track, target);
+	}
+
+	/**
+	 * Search the path of the train from the end of its reservation.
+	 * @param v the train
+	 * @param origin the end of the reservation of the train
+	 * @return true if the path was found
+	 */
+	inline bool FindTrainPath(const Train *v, const PBSTileInfo &origin)
+	{
 		/* set origin and destination nodes */
-		PBSTileInfo origin = FollowTrainReservation(v);
 		Yapf().SetOrigin(origin.tile, origin.trackdir, INVALID_TILE, INVALID_TRACKDIR, 1, true);
 		Yapf().SetDestination(v);
 
 		/* find the best path */
-		path_found = Yapf().FindPath(v);
+		return Yapf().FindPath(v);
+	}
 
+	/**
+	 * Pick the next trackdir from the path found by FindTrainPath() and optionally reserve it.
+	 * @param path_found [in,out] whether the path was found
+	 * @param reserve_track whether the path should be reserved
+	 * @param target [out] the target tile of the reservation
+	 * @return the trackdir to take on the junction
+	 */
+	template <class TNode>
+	inline Trackdir FinishChooseRailTrack(TNode *pNode, bool stopped_on_first_two_way_signal, bool &path_found, bool reserve_track, PBSTileInfo *target)
+	{
 		/* if path not found - return INVALID_TRACKDIR */
 		Trackdir next_trackdir = INVALID_TRACKDIR;
-		Node *pNode = Yapf().GetBestNode();
 		if (pNode != nullptr) {
 			/* reserve till end of path */
-			this->SetReservationTarget(pNode, pNode->GetLastTile(), pNode->GetLastTrackdir());
+			TNode *res_node = pNode;
+			this->SetReservationTarget(pNode->GetLastTile(), pNode->GetLastTrackdir());
 
 			/* path was found or at least suggested
 			 * walk through the path back to the origin */
-			Node *pPrev = nullptr;
+			TNode *pPrev = nullptr;
 			while (pNode->m_parent != nullptr) {
 				pPrev = pNode;
 				pNode = pNode->m_parent;
 
-				this->FindSafePositionOnNode(pPrev);
+				if (this->FindSafePositionOnNode(pPrev)) res_node = pPrev;
 			}
 			/* return trackdir from the best origin node (one of start nodes) */
-			Node &best_next_node = *pPrev;
+			TNode &best_next_node = *pPrev;
 			next_trackdir = best_next_node.GetTrackdir();
 
-			if (reserve_track && path_found) this->TryReservePath(target, pNode->GetLastTile());
+			if (reserve_track && path_found) this->TryReservePath(res_node, target, pNode->GetLastTile());
 		}
 
 		/* Treat the path as found if stopped on the first two way signal(s). */
-		path_found |= Yapf().m_stopped_on_first_two_way_signal;
+		path_found |= stopped_on_first_two_way_signal;
 		return next_trackdir;
 	}
 
@@ -647,6 +973,23 @@ struct CYapfAnySafeTileRail1 : CYapfT<CYapfRail_TypesT<CYapfAnySafeTileRail1, CF
 struct CYapfAnySafeTileRail2 : CYapfT<CYapfRail_TypesT<CYapfAnySafeTileRail2, CFollowTrackFreeRailNo90, CRailNodeListTrackDir, CYapfDestinationAnySafeTileRailT , CYapfFollowAnySafeTileRailT> > {};
 
 
+void YapfPrefetchTrainPaths(const std::vector<Train *> &trains)
+{
+	bool enabled = _settings_client.gui.speculative_train_pathfinding && _worker_pool.GetMaxWorkers() > 0 &&
+			_settings_game.pf.pathfinder_for_trains == VPF_YAPF &&
+			_debug_yapfdesync_level < 1 && _debug_desync_level < 2 && _debug_yapf_level < 2;
+
+	if (!enabled || _settings_game.pf.forbid_90_deg) CYapfRail1::stClearSpeculativePaths();
+	if (!enabled || !_settings_game.pf.forbid_90_deg) CYapfRail2::stClearSpeculativePaths();
+	if (!enabled) return;
+
+	if (_settings_game.pf.forbid_90_deg) {
+		CYapfRail2::stPrefetchPaths(trains);
+	} else {
+		CYapfRail1::stPrefetchPaths(trains);
+	}
+}
+
 Track YapfTrainChooseTrack(const Train *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, bool reserve_track, PBSTileInfo *target)
 {
 	/* default is YAPF type 2 */
@@ -755,10 +1098,33 @@ bool YapfTrainFindNearestSafeTile(const Train *v, TileIndex tile, Trackdir td, b
 	return pfnFindNearestSafeTile(v, tile, td, override_railtype);
 }
 
-/** if any track changes, this counter is incremented - that will invalidate segment cost cache */
-int CSegmentCostCacheBase::s_rail_change_counter = 0;
+/** all global segment cost caches, if any track changes they evict the segments crossing it */
+std::vector<CSegmentCostCacheBase *> CSegmentCostCacheBase::s_caches;
 
 void YapfNotifyTrackLayoutChange(TileIndex tile, Track track)
 {
+	_yapf_track_layout_epoch++;
 	CSegmentCostCacheBase::NotifyTrackLayoutChange(tile, track);
+	/* Explored signal segments depend on the track layout too. */
+	ClearSignalSegmentCache();
+}
+
+void DumpYapfSegmentCostCacheStats(char *b, const char *last)
+{
+	*b = '\0';
+	uint64 hits = 0;
+	uint64 misses = 0;
+	for (size_t i = 0; i < CSegmentCostCacheBase::s_caches.size(); i++) {
+		const CSegmentCostCacheBase *cache = CSegmentCostCacheBase::s_caches[i];
+		b += seprintf(b, last, "Cache %u%s: segments: %u, tile index: %u, hits: " OTTD_PRINTF64U ", misses: " OTTD_PRINTF64U ", evictions: " OTTD_PRINTF64U ", flushes: " OTTD_PRINTF64U "\n",
+				(uint)i, cache->m_reservation_dependent ? " (masks reserved tracks)" : "", cache->GetSegmentCount(), cache->GetTileIndexSize(),
+				cache->m_hits, cache->m_misses, cache->m_evictions, cache->m_flushes);
+		hits += cache->m_hits;
+		misses += cache->m_misses;
+	}
+	if (hits + misses > 0) {
+		b += seprintf(b, last, "Total hit ratio: %.1f%%\n", (100.0 * hits) / (hits + misses));
+	}
+	b += seprintf(b, last, "Speculative train paths: searches: " OTTD_PRINTF64U ", used: " OTTD_PRINTF64U ", rejected: " OTTD_PRINTF64U "\n",
+			_speculative_train_path_stats.searches, _speculative_train_path_stats.used, _speculative_train_path_stats.rejected);
 }
@@ -14,6 +14,9 @@
 
 #include "yapf.hpp"
 #include "yapf_node_ship.hpp"
+#include "yapf_ship_regions.h"
+
+#include <algorithm>
 
 #include "../../safeguards.h"
 
@@ -31,9 +34,15 @@ protected:
 	TrackdirBits m_destTrackdirs;
 	StationID    m_destStation;
 
+	std::vector<WaterRegionPatchDesc> m_water_region_corridor; ///< the water region patches the search may use, empty if it may use all tiles
+	bool         m_water_region_intermediate;                  ///< whether reaching the last patch of the corridor counts as reaching the destination
+
 public:
 	void SetDestination(const Ship *v)
 	{
+		m_water_region_corridor.clear();
+		m_water_region_intermediate = false;
+
 		if (v->current_order.IsType(OT_GOTO_STATION)) {
 			m_destStation   = v->current_order.GetDestination();
 			m_destTile      = CalcClosestStationTile(m_destStation, v->tile, STATION_DOCK);
@@ -45,6 +54,43 @@ public:
 		}
 	}
 
+	/**
+	 * Restrict the search to the first patches of the path on the water regions.
+	 * When the destination is further away, reaching the last of these patches counts as reaching the destination.
+	 * @param v the ship
+	 * @param origin the first tile the ship enters
+	 * @pre SetDestination has been called
+	 */
+	void RestrictToWaterRegionPath(const Ship *v, TileIndex origin)
+	{
+		if (!Yapf().PfGetSettings().ship_use_water_regions) return;
+
+		m_water_region_corridor = YapfShipFindWaterRegionPath(v, origin, YAPF_SHIP_REGION_LOOKAHEAD + 1);
+		if (m_water_region_corridor.size() > YAPF_SHIP_REGION_LOOKAHEAD) {
+			m_water_region_corridor.pop_back();
+			m_water_region_intermediate = true;
+		}
+	}
+
+	/** Whether the search is restricted to a part of the map, see #RestrictToWaterRegionPath */
+	inline bool IsRestrictedToWaterRegions() const
+	{
+		return !m_water_region_corridor.empty();
+	}
+
+	/** Whether the search ends at an intermediate destination, see #RestrictToWaterRegionPath */
+	inline bool HasIntermediateDestination() const
+	{
+		return m_water_region_intermediate;
+	}
+
+	/** Whether the search may use a tile, see #RestrictToWaterRegionPath */
+	inline bool IsTileInWaterRegionCorridor(TileIndex tile) const
+	{
+		if (m_water_region_corridor.empty()) return true;
+		return std::find(m_water_region_corridor.begin(), m_water_region_corridor.end(), GetWaterRegionPatchInfo(tile)) != m_water_region_corridor.end();
+	}
+
 protected:
 	/** to access inherited path finder */
 	inline Tpf& Yapf()
@@ -61,6 +107,8 @@ public:
 
 	inline bool PfDetectDestinationTile(TileIndex tile, Trackdir trackdir)
 	{
+		if (m_water_region_intermediate && GetWaterRegionPatchInfo(tile) == m_water_region_corridor.back()) return true;
+
 		if (m_destStation != INVALID_STATION) {
 			return IsDockingTile(tile) && IsShipDestinationTile(tile, m_destStation);
 		}
@@ -87,11 +135,18 @@ public:
 		int y1 = 2 * TileY(tile) + dg_dir_to_y_offs[(int)exitdir];
 		int x2 = 2 * TileX(m_destTile);
 		int y2 = 2 * TileY(m_destTile);
+		if (m_water_region_intermediate) {
+			/* Aim for the nearest tile of the region of the intermediate destination. */
+			const TileIndex north = GetWaterRegionNorthTile(m_water_region_corridor.back().region);
+			x2 = Clamp(x1, 2 * TileX(north), 2 * (TileX(north) + WATER_REGION_EDGE_LENGTH - 1));
+			y2 = Clamp(y1, 2 * TileY(north), 2 * (TileY(north) + WATER_REGION_EDGE_LENGTH - 1));
+		}
 		int dx = abs(x1 - x2);
 		int dy = abs(y1 - y2);
 		int dmin = min(dx, dy);
 		int dxy = abs(dx - dy);
 		int d = dmin * YAPF_TILE_CORNER_LENGTH + (dxy - 1) * (YAPF_TILE_LENGTH / 2);
+		if (m_water_region_intermediate) d = max(d, 0);
 		n.m_estimate = n.m_cost + d;
 		assert(n.m_estimate >= n.m_parent->m_estimate);
 		return true;
@@ -125,7 +180,7 @@ public:
 	inline void PfFollowNode(Node &old_node)
 	{
 		TrackFollower F(Yapf().GetVehicle());
-		if (F.Follow(old_node.m_key.m_tile, old_node.m_key.m_td)) {
+		if (F.Follow(old_node.m_key.m_tile, old_node.m_key.m_td) && Yapf().IsTileInWaterRegionCorridor(F.m_new_tile)) {
 			Yapf().AddMultipleNodes(&old_node, F);
 		}
 	}
@@ -136,7 +191,7 @@ public:
 		return 'w';
 	}
 
-	static Trackdir ChooseShipTrack(const Ship *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, ShipPathCache &path_cache)
+	static Trackdir ChooseShipTrack(const Ship *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, ShipPathCache &path_cache, bool use_water_regions)
 	{
 		/* handle special case - when next tile is destination tile */
 		if (tile == v->dest_tile) {
@@ -163,8 +218,13 @@ public:
 		/* set origin and destination nodes */
 		pf.SetOrigin(src_tile, trackdirs);
 		pf.SetDestination(v);
+		if (use_water_regions) pf.RestrictToWaterRegionPath(v, tile);
 		/* find best path */
 		path_found = pf.FindPath(v);
+		if (!path_found && pf.IsRestrictedToWaterRegions()) {
+			/* Not found within the water regions, search without them. */
+			return ChooseShipTrack(v, tile, enterdir, tracks, path_found, path_cache, false);
+		}
 
 		Trackdir next_trackdir = INVALID_TRACKDIR; // this would mean "path not found"
 
@@ -173,7 +233,7 @@ public:
 			uint steps = 0;
 			for (Node *n = pNode; n->m_parent != nullptr; n = n->m_parent) steps++;
 			uint skip = 0;
-			if (path_found) skip = YAPF_SHIP_PATH_CACHE_LENGTH / 2;
+			if (path_found && !pf.HasIntermediateDestination()) skip = YAPF_SHIP_PATH_CACHE_LENGTH / 2;
 
 			/* walk through the path back to the origin */
 			Node *pPrevNode = nullptr;
@@ -192,7 +252,7 @@ public:
 			assert(best_next_node.GetTile() == tile);
 			next_trackdir = best_next_node.GetTrackdir();
 			/* remove last element for the special case when tile == dest_tile */
-			if (path_found && !path_cache.empty()) path_cache.pop_back();
+			if (path_found && !pf.HasIntermediateDestination() && !path_cache.empty()) path_cache.pop_back();
 		}
 		return next_trackdir;
 	}
@@ -204,17 +264,23 @@ public:
 	 * @param tile Current position
 	 * @param td1 Forward direction
 	 * @param td2 Reverse direction
+	 * @param use_water_regions Whether to restrict the search to the path on the water regions
 	 * @return true if the reverse direction is better
 	 */
-	static bool CheckShipReverse(const Ship *v, TileIndex tile, Trackdir td1, Trackdir td2)
+	static bool CheckShipReverse(const Ship *v, TileIndex tile, Trackdir td1, Trackdir td2, bool use_water_regions)
 	{
 		/* create pathfinder instance */
 		Tpf pf;
 		/* set origin and destination nodes */
 		pf.SetOrigin(tile, TrackdirToTrackdirBits(td1) | TrackdirToTrackdirBits(td2));
 		pf.SetDestination(v);
+		if (use_water_regions) pf.RestrictToWaterRegionPath(v, tile);
 		/* find best path */
-		if (!pf.FindPath(v)) return false;
+		if (!pf.FindPath(v)) {
+			/* Not found within the water regions, search without them. */
+			if (pf.IsRestrictedToWaterRegions()) return CheckShipReverse(v, tile, td1, td2, false);
+			return false;
+		}
 
 		Node *pNode = pf.GetBestNode();
 		if (pNode == nullptr) return false;
@@ -351,7 +417,7 @@ static inline bool RequireTrackdirKey()
 Track YapfShipChooseTrack(const Ship *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, ShipPathCache &path_cache)
 {
 	/* default is YAPF type 2 */
-	typedef Trackdir (*PfnChooseShipTrack)(const Ship*, TileIndex, DiagDirection, TrackBits, bool &path_found, ShipPathCache &path_cache);
+	typedef Trackdir (*PfnChooseShipTrack)(const Ship*, TileIndex, DiagDirection, TrackBits, bool &path_found, ShipPathCache &path_cache, bool use_water_regions);
 	PfnChooseShipTrack pfnChooseShipTrack = CYapfShip2::ChooseShipTrack; // default: ExitDir
 
 	/* check if non-default YAPF type needed */
@@ -359,7 +425,7 @@ Track YapfShipChooseTrack(const Ship *v, TileIndex tile, DiagDirection enterdir,
 		pfnChooseShipTrack = &CYapfShip1::ChooseShipTrack; // Trackdir
 	}
 
-	Trackdir td_ret = pfnChooseShipTrack(v, tile, enterdir, tracks, path_found, path_cache);
+	Trackdir td_ret = pfnChooseShipTrack(v, tile, enterdir, tracks, path_found, path_cache, true);
 	return (td_ret != INVALID_TRACKDIR) ? TrackdirToTrack(td_ret) : INVALID_TRACK;
 }
 
@@ -369,7 +435,7 @@ bool YapfShipCheckReverse(const Ship *v)
 	Trackdir td_rev = ReverseTrackdir(td);
 	TileIndex tile = v->tile;
 
-	typedef bool (*PfnCheckReverseShip)(const Ship*, TileIndex, Trackdir, Trackdir);
+	typedef bool (*PfnCheckReverseShip)(const Ship*, TileIndex, Trackdir, Trackdir, bool);
 	PfnCheckReverseShip pfnCheckReverseShip = CYapfShip2::CheckShipReverse; // default: ExitDir
 
 	/* check if non-default YAPF type needed */
@@ -377,7 +443,7 @@ bool YapfShipCheckReverse(const Ship *v)
 		pfnCheckReverseShip = &CYapfShip1::CheckShipReverse; // Trackdir
 	}
 
-	bool reverse = pfnCheckReverseShip(v, tile, td, td_rev);
+	bool reverse = pfnCheckReverseShip(v, tile, td, td_rev, true);
 
 	return reverse;
 }
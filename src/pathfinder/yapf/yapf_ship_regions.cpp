@@ -0,0 +1,296 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file yapf_ship_regions.cpp Implementation of the high level YAPF for ships, which routes on the water regions. */
+
+#include "../../stdafx.h"
+#include "../../ship.h"
+#include "../../station_base.h"
+
+#include "yapf.hpp"
+#include "yapf_ship_regions.h"
+
+#include <algorithm>
+
+#include "../../safeguards.h"
+
+/** Yapf Node Key that represents a single patch of a water region. */
+struct CYapfRegionPatchNodeKey {
+	WaterRegionPatchDesc m_water_region_patch;
+
+	inline void Set(const WaterRegionPatchDesc &patch)
+	{
+		m_water_region_patch = patch;
+	}
+
+	inline int CalcHash() const
+	{
+		return m_water_region_patch.region ^ (m_water_region_patch.label << 24);
+	}
+
+	inline bool operator==(const CYapfRegionPatchNodeKey &other) const
+	{
+		return m_water_region_patch == other.m_water_region_patch;
+	}
+
+	void Dump(DumpTarget &dmp) const
+	{
+		dmp.WriteLine("m_water_region_patch = %u:%u", m_water_region_patch.region, m_water_region_patch.label);
+	}
+};
+
+/** Yapf Node for the water region patches */
+template <class Tkey_>
+struct CYapfRegionNodeT : CYapfNodeT<Tkey_, CYapfRegionNodeT<Tkey_> > {
+	typedef CYapfNodeT<Tkey_, CYapfRegionNodeT<Tkey_> > base;
+
+	void Set(CYapfRegionNodeT *parent, const WaterRegionPatchDesc &patch)
+	{
+		this->m_key.Set(patch);
+		this->m_hash_next = nullptr;
+		this->m_parent = parent;
+		this->m_cost = 0;
+		this->m_estimate = 0;
+		this->m_is_choice = false;
+	}
+
+	inline const WaterRegionPatchDesc &GetPatch() const
+	{
+		return this->m_key.m_water_region_patch;
+	}
+};
+
+typedef CYapfRegionNodeT<CYapfRegionPatchNodeKey> CYapfRegionNode;
+typedef CNodeList_HashTableT<CYapfRegionNode, 10, 12> CRegionNodeList;
+
+/** The region pathfinder does not follow tracks, but YAPF needs a follower type to pass around. */
+struct CFollowRegionDummy {};
+
+/** YAPF origin provider for the water region patches */
+template <class Types>
+class CYapfOriginRegionT
+{
+public:
+	typedef typename Types::Tpf Tpf;              ///< the pathfinder class (derived from THIS class)
+	typedef typename Types::NodeList::Titem Node; ///< this will be our node type
+
+protected:
+	WaterRegionPatchDesc m_origin;
+
+	/** to access inherited path finder */
+	inline Tpf& Yapf()
+	{
+		return *static_cast<Tpf *>(this);
+	}
+
+public:
+	/** Set the origin patch */
+	void SetOrigin(const WaterRegionPatchDesc &patch)
+	{
+		m_origin = patch;
+	}
+
+	/** Called when YAPF needs to place origin nodes into open list */
+	void PfSetStartupNodes()
+	{
+		Node &node = Yapf().CreateNewNode();
+		node.Set(nullptr, m_origin);
+		Yapf().AddStartupNode(node);
+	}
+};
+
+/** YAPF destination provider for the water region patches */
+template <class Types>
+class CYapfDestinationRegionT
+{
+public:
+	typedef typename Types::Tpf Tpf;              ///< the pathfinder class (derived from THIS class)
+	typedef typename Types::NodeList::Titem Node; ///< this will be our node type
+
+protected:
+	std::vector<WaterRegionPatchDesc> m_dest_patches;
+
+public:
+	/**
+	 * Set the destination patches: those of the docking tiles of the destination station, or that of the destination tile otherwise.
+	 * @param v the ship
+	 * @return true if there is at least one destination patch
+	 */
+	bool SetDestination(const Ship *v)
+	{
+		m_dest_patches.clear();
+
+		auto add_patch = [&](TileIndex tile) {
+			const WaterRegionPatchDesc patch = GetWaterRegionPatchInfo(tile);
+			if (patch.IsValid() && std::find(m_dest_patches.begin(), m_dest_patches.end(), patch) == m_dest_patches.end()) m_dest_patches.push_back(patch);
+		};
+
+		if (v->current_order.IsType(OT_GOTO_STATION)) {
+			const Station *st = Station::GetIfValid(v->current_order.GetDestination());
+			if (st == nullptr || st->docking_station.tile == INVALID_TILE) return false;
+			StationID station = st->index;
+			TILE_AREA_LOOP(tile, st->docking_station) {
+				if (IsDockingTile(tile) && IsShipDestinationTile(tile, station)) add_patch(tile);
+			}
+		} else {
+			add_patch(v->dest_tile);
+		}
+		return !m_dest_patches.empty();
+	}
+
+	/** Check whether a patch is one of the destination patches */
+	inline bool IsDestinationPatch(const WaterRegionPatchDesc &patch) const
+	{
+		return std::find(m_dest_patches.begin(), m_dest_patches.end(), patch) != m_dest_patches.end();
+	}
+
+	/** Called by YAPF to detect if node ends in the desired destination */
+	inline bool PfDetectDestination(Node &n)
+	{
+		return IsDestinationPatch(n.GetPatch());
+	}
+
+	/**
+	 * Called by YAPF to calculate cost estimate. The distance in regions to the nearest
+	 *  destination patch is added to the actual cost from origin and stored to Node::m_estimate
+	 */
+	inline bool PfCalcEstimate(Node &n)
+	{
+		uint distance = UINT_MAX;
+		for (const WaterRegionPatchDesc &dest : m_dest_patches) {
+			distance = std::min(distance, GetWaterRegionDistance(n.GetPatch().region, dest.region));
+		}
+		n.m_estimate = n.m_cost + (int)distance;
+		assert(n.m_parent == nullptr || n.m_estimate >= n.m_parent->m_estimate);
+		return true;
+	}
+};
+
+/** Node Follower module of the YAPF for water region patches */
+template <class Types>
+class CYapfFollowRegionT
+{
+public:
+	typedef typename Types::Tpf Tpf;                     ///< the pathfinder class (derived from THIS class)
+	typedef typename Types::TrackFollower TrackFollower;
+	typedef typename Types::NodeList::Titem Node;        ///< this will be our node type
+
+protected:
+	std::vector<WaterRegionPatchDesc> m_neighbours;
+
+	/** to access inherited path finder */
+	inline Tpf& Yapf()
+	{
+		return *static_cast<Tpf *>(this);
+	}
+
+public:
+	/** Called by YAPF to add a node for each patch reachable from the given node */
+	inline void PfFollowNode(Node &old_node)
+	{
+		GetWaterRegionPatchNeighbours(old_node.GetPatch(), m_neighbours);
+		TrackFollower F;
+		for (const WaterRegionPatchDesc &patch : m_neighbours) {
+			Node &n = Yapf().CreateNewNode();
+			n.Set(&old_node, patch);
+			Yapf().AddNewNode(n, F);
+		}
+	}
+
+	/** return debug report character to identify the transportation type */
+	inline char TransportTypeChar() const
+	{
+		return '^';
+	}
+
+	static std::vector<WaterRegionPatchDesc> FindWaterRegionPath(const Ship *v, TileIndex start_tile, uint max_returned_path_length)
+	{
+		std::vector<WaterRegionPatchDesc> path;
+
+		const WaterRegionPatchDesc start_patch = GetWaterRegionPatchInfo(start_tile);
+		if (!start_patch.IsValid()) return path;
+
+		Tpf pf;
+		pf.SetOrigin(start_patch);
+		if (!pf.SetDestination(v)) return path;
+		if (pf.IsDestinationPatch(start_patch)) {
+			path.push_back(start_patch);
+			return path;
+		}
+		if (!pf.FindPath(v)) return path;
+
+		Node *node = pf.GetBestNode();
+		uint length = 0;
+		for (Node *n = node; n != nullptr; n = n->m_parent) length++;
+
+		/* Keep the patches nearest to the origin. */
+		for (; length > max_returned_path_length; length--) node = node->m_parent;
+		path.resize(length);
+		for (; node != nullptr; node = node->m_parent) path[--length] = node->GetPatch();
+		return path;
+	}
+};
+
+/** Cost Provider module of the YAPF for water region patches */
+template <class Types>
+class CYapfCostRegionT
+{
+public:
+	typedef typename Types::Tpf Tpf;                     ///< the pathfinder class (derived from THIS class)
+	typedef typename Types::TrackFollower TrackFollower;
+	typedef typename Types::NodeList::Titem Node;        ///< this will be our node type
+
+	/**
+	 * Called by YAPF to calculate the cost from the origin to the given node.
+	 *  Each step costs the distance in regions it covers, which is more than one for aqueducts.
+	 */
+	inline bool PfCalcCost(Node &n, const TrackFollower *tf)
+	{
+		n.m_cost = n.m_parent->m_cost + std::max<int>(1, GetWaterRegionDistance(n.m_parent->GetPatch().region, n.GetPatch().region));
+		return true;
+	}
+};
+
+/**
+ * Config struct of the YAPF for water region patches.
+ *  Defines all 6 base YAPF modules as classes providing services for CYapfBaseT.
+ */
+template <class Tpf_, class Tnode_list>
+struct CYapfRegion_TypesT
+{
+	/** Types - shortcut for this struct type */
+	typedef CYapfRegion_TypesT<Tpf_, Tnode_list> Types;
+
+	/** Tpf - pathfinder type */
+	typedef Tpf_                              Tpf;
+	/** track follower helper class */
+	typedef CFollowRegionDummy                TrackFollower;
+	/** node list type */
+	typedef Tnode_list                        NodeList;
+	typedef Ship                              VehicleType;
+	/** pathfinder components (modules) */
+	typedef CYapfBaseT<Types>                 PfBase;        // base pathfinder class
+	typedef CYapfFollowRegionT<Types>         PfFollow;      // node follower
+	typedef CYapfOriginRegionT<Types>         PfOrigin;      // origin provider
+	typedef CYapfDestinationRegionT<Types>    PfDestination; // destination/distance provider
+	typedef CYapfSegmentCostCacheNoneT<Types> PfCache;       // segment cost cache provider
+	typedef CYapfCostRegionT<Types>           PfCost;        // cost provider
+};
+
+struct CYapfRegionWater : CYapfT<CYapfRegion_TypesT<CYapfRegionWater, CRegionNodeList> > {};
+
+/**
+ * Find the path of a ship on the water region patches.
+ * @param v the ship
+ * @param start_tile the tile to search from
+ * @param max_returned_path_length the maximum number of patches to return, counting the one of \a start_tile
+ * @return the first patches of the path, starting with the one of \a start_tile, or nothing if no path was found
+ */
+std::vector<WaterRegionPatchDesc> YapfShipFindWaterRegionPath(const Ship *v, TileIndex start_tile, uint max_returned_path_length)
+{
+	return CYapfRegionWater::FindWaterRegionPath(v, start_tile, max_returned_path_length);
+}
@@ -532,8 +532,10 @@ bool IsSafeWaitingPosition(const Train *v, TileIndex tile, Trackdir trackdir, bo
 			if (IsRestrictedSignal(ft.m_new_tile)) {
 				const TraceRestrictProgram *prog = GetExistingTraceRestrictProgram(ft.m_new_tile, TrackdirToTrack(td));
 				if (prog && prog->actions_used_flags & TRPAUF_RESERVE_THROUGH) {
+					TraceRestrictProgramInput input(ft.m_new_tile, td, &VehiclePosTraceRestrictPreviousSignalCallback, nullptr);
+					input.query_actions = TRPAUF_RESERVE_THROUGH;
 					TraceRestrictProgramResult out;
-					prog->Execute(v, TraceRestrictProgramInput(ft.m_new_tile, td, &VehiclePosTraceRestrictPreviousSignalCallback, nullptr), out);
+					prog->Execute(v, input, out);
 					if (out.flags & TRPRF_RESERVE_THROUGH) {
 						return false;
 					}
@@ -586,6 +588,7 @@ bool IsWaitingPositionFree(const Train *v, TileIndex tile, Trackdir trackdir, bo
 			if (prog && prog->actions_used_flags & TRPAUF_PBS_RES_END_WAIT) {
 				TraceRestrictProgramInput input(t, td, &VehiclePosTraceRestrictPreviousSignalCallback, nullptr);
 				input.permitted_slot_operations = TRPISP_PBS_RES_END_ACQ_DRY;
+				input.query_actions = TRPAUF_PBS_RES_END_WAIT;
 				TraceRestrictProgramResult out;
 				prog->Execute(v, input, out);
 				if (out.flags & TRPRF_PBS_RES_END_WAIT) {
@@ -2396,7 +2396,10 @@ bool AfterLoadGame()
 		 * The conversion affects oil rigs and buoys too, but it doesn't matter as
 		 * they have st->owner == OWNER_NONE already. */
 		for (Station *st : Station::Iterate()) {
-			if (!Company::IsValidID(st->owner)) st->owner = OWNER_NONE;
+			if (!Company::IsValidID(st->owner)) {
+				st->owner = OWNER_NONE;
+				_station_owner_index.Update(st);
+			}
 		}
 	}
 
@@ -3772,6 +3775,11 @@ bool AfterLoadGame()
 		_settings_game.game_creation.generation_unique_id = _interactive_random.Next(UINT32_MAX-1) + 1; /* Generates between [1;UINT32_MAX] */
 	}
 
+	if (SlXvIsFeatureMissing(XSLFI_SHIP_WATER_REGIONS)) {
+		/* Keep the ship routes of existing games, the water regions are only used by default in new games */
+		_settings_game.pf.yapf.ship_use_water_regions = false;
+	}
+
 	/* This needs to be done after conversion. */
 	RebuildViewportKdtree();
 
@@ -3795,6 +3803,9 @@ bool AfterLoadGame()
 	InvalidateVehicleTickCaches();
 	ClearVehicleTickCaches();
 
+	/* The track layout may have been converted above, after signals were updated */
+	ClearSignalSegmentCache();
+
 	/* Show this message last to avoid covering up an error message if we bail out part way */
 	switch (gcf_res) {
 		case GLC_COMPATIBLE: ShowErrorMessage(STR_NEWGRF_COMPATIBLE_LOAD_WARNING, INVALID_STRING_ID, WL_CRITICAL); break;
@@ -3864,6 +3875,8 @@ void ReloadNewGRFData()
 		}
 	}
 
+	/* Station tiles may be blocked differently by the reloaded NewGRFs. */
+	ClearSignalSegmentCache();
 	/* Update company statistics. */
 	AfterLoadCompanyStats();
 	/* Check and update house and town values */
@@ -133,6 +133,9 @@ const SaveLoad *GetCargoPacketDesc()
  */
 static void Save_CAPA()
 {
+	/* Vehicles age their cargo lazily, make sure the packets are up to date. */
+	for (Vehicle *v : Vehicle::Iterate()) v->cargo.ApplyAging();
+
 	std::vector<SaveLoad> filtered_packet_desc = SlFilterObject(GetCargoPacketDesc());
 	for (CargoPacket *cp : CargoPacket::Iterate()) {
 		SlSetArrayIndex(cp->index);
@@ -112,6 +112,8 @@ const SlxiSubChunkInfo _sl_xv_sub_chunk_infos[] = {
 	{ XSLFI_DEBUG,                  XSCF_IGNORABLE_ALL,       1,   1, "debug",                     nullptr, nullptr, "DBGL"      },
 	{ XSLFI_FLOW_STAT_FLAGS,        XSCF_NULL,                1,   1, "flow_stat_flags",           nullptr, nullptr, nullptr        },
 	{ XSLFI_SPEED_RESTRICTION,      XSCF_NULL,                1,   1, "speed_restriction",         nullptr, nullptr, "VESR"         },
+	{ XSLFI_MAP_DELTA,              XSCF_NULL,                0,   1, "map_delta",                 nullptr, nullptr, nullptr        },
+	{ XSLFI_SHIP_WATER_REGIONS,     XSCF_IGNORABLE_ALL,       1,   1, "ship_water_regions",        nullptr, nullptr, nullptr        },
 	{ XSLFI_NULL, XSCF_NULL, 0, 0, nullptr, nullptr, nullptr, nullptr },// This is the end marker
 };
 
@@ -197,6 +199,10 @@ void SlXvSetCurrentState()
 	if (MapSizeX() > 8192 || MapSizeY() > 8192) {
 		_sl_xv_feature_versions[XSLFI_EXTRA_LARGE_MAP] = 1;
 	}
+	extern bool _sl_map_delta_save;
+	if (_sl_map_delta_save) {
+		_sl_xv_feature_versions[XSLFI_MAP_DELTA] = 1;
+	}
 }
 
 /**
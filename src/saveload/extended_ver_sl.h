@@ -77,6 +77,8 @@ enum SlXvFeatureIndex {
 	XSLFI_DEBUG,                                  ///< Debugging info
 	XSLFI_FLOW_STAT_FLAGS,                        ///< FlowStat flags
 	XSLFI_SPEED_RESTRICTION,                      ///< Train speed restrictions
+	XSLFI_MAP_DELTA,                              ///< Map chunk only holds the changes relative to an incremental autosave base file
+	XSLFI_SHIP_WATER_REGIONS,                     ///< Ship pathfinder may be restricted to the path found on the water regions
 
 	XSLFI_RIFF_HEADER_60_BIT,                     ///< Size field in RIFF chunk header is 60 bit
 	XSLFI_HEIGHT_8_BIT,                           ///< Map tile height is 8 bit instead of 4 bit, but savegame version may be before this became true in trunk
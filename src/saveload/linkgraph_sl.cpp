@@ -157,9 +157,15 @@ void Save_LinkGraph(LinkGraph &lg)
 	for (NodeID from = 0; from < size; ++from) {
 		Node *node = &lg.nodes[from];
 		SlObjectSaveFiltered(node, _filtered_node_desc.data());
-		/* ... but as that wasted a lot of space we save a sparse matrix now. */
-		for (NodeID to = from; to != INVALID_NODE; to = lg.edges[from][to].next_edge) {
-			SlObjectSaveFiltered(&lg.edges[from][to], _filtered_edge_desc.data());
+		/* ... but as that wasted a lot of space we save a sparse matrix now.
+		 * The edge from the node to itself holds the start of the next_edge chain. */
+		LinkGraph::BaseEdgeSet &edges = lg.edges[from];
+		Edge start;
+		start.Init();
+		start.next_edge = edges.first_edge;
+		SlObjectSaveFiltered(&start, _filtered_edge_desc.data());
+		for (NodeID to = edges.first_edge; to != INVALID_NODE; to = edges.Find(to)->next_edge) {
+			SlObjectSaveFiltered(edges.Find(to), _filtered_edge_desc.data());
 		}
 	}
 }
@@ -171,18 +177,32 @@ void Save_LinkGraph(LinkGraph &lg)
 void Load_LinkGraph(LinkGraph &lg)
 {
 	uint size = lg.Size();
+	std::vector<Edge> column;
 	for (NodeID from = 0; from < size; ++from) {
 		Node *node = &lg.nodes[from];
 		SlObjectLoadFiltered(node, _filtered_node_desc.data());
+		LinkGraph::BaseEdgeSet &edges = lg.edges[from];
 		if (IsSavegameVersionBefore(SLV_191)) {
 			/* We used to save the full matrix ... */
+			column.resize(size);
 			for (NodeID to = 0; to < size; ++to) {
-				SlObjectLoadFiltered(&lg.edges[from][to], _filtered_edge_desc.data());
+				SlObjectLoadFiltered(&column[to], _filtered_edge_desc.data());
+			}
+			/* Only keep the edges which are linked from the edge to the node itself. */
+			edges.first_edge = column[from].next_edge;
+			for (NodeID to = edges.first_edge; to != INVALID_NODE; to = column[to].next_edge) {
+				column[to].dest_node = to;
+				edges.Insert(to) = column[to];
 			}
 		} else {
 			/* ... but as that wasted a lot of space we save a sparse matrix now. */
-			for (NodeID to = from; to != INVALID_NODE; to = lg.edges[from][to].next_edge) {
-				SlObjectLoadFiltered(&lg.edges[from][to], _filtered_edge_desc.data());
+			Edge start;
+			SlObjectLoadFiltered(&start, _filtered_edge_desc.data());
+			edges.first_edge = start.next_edge;
+			for (NodeID to = edges.first_edge; to != INVALID_NODE;) {
+				Edge &edge = edges.Insert(to);
+				SlObjectLoadFiltered(&edge, _filtered_edge_desc.data());
+				to = edge.next_edge;
 			}
 		}
 	}
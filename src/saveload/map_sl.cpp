@@ -12,11 +12,21 @@
 #include "../core/bitmath_func.hpp"
 #include "../core/endian_func.hpp"
 #include "../core/endian_type.hpp"
+#include "../fileio_func.h"
 #include "../fios.h"
+#include "../string_func.h"
+#include "../debug.h"
+#include "../worker_thread.h"
 #include <array>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
 
 #include "saveload.h"
 #include "saveload_buffer.h"
+#include "saveload_filter.h"
 
 #include "../safeguards.h"
 
@@ -25,6 +35,8 @@ static uint32 _map_dim_y;
 
 extern bool _sl_maybe_chillpp;
 
+bool _sl_map_delta_save = false; ///< Whether the current save stores the map as a delta against the incremental autosave base file.
+
 static const SaveLoadGlobVarList _map_dimensions[] = {
 	SLEG_CONDVAR(_map_dim_x, SLE_UINT32, SLV_6, SL_MAX_VERSION),
 	SLEG_CONDVAR(_map_dim_y, SLE_UINT32, SLV_6, SL_MAX_VERSION),
@@ -212,16 +224,24 @@ static void Load_MAP8()
 	}
 }
 
+static void Load_WMAP_delta();
+static void Save_WMAP_delta();
+
 static void Load_WMAP()
 {
 	assert_compile(sizeof(Tile) == 8);
 	assert_compile(sizeof(TileExtended) == 4);
 	assert(_sl_xv_feature_versions[XSLFI_WHOLE_MAP_CHUNK] == 1 || _sl_xv_feature_versions[XSLFI_WHOLE_MAP_CHUNK] == 2);
 
+	if (SlXvIsFeaturePresent(XSLFI_MAP_DELTA)) {
+		Load_WMAP_delta();
+		return;
+	}
+
 	ReadBuffer *reader = ReadBuffer::GetCurrent();
 	const TileIndex size = MapSize();
 
-#if TTD_ENDIAN == TTD_LITTLE_ENDIAN
+#if TTD_ENDIAN == TTD_LITTLE_ENDIAN && !defined(WITH_MAP_SOA)
 	reader->CopyBytes((byte *) _m, size * 8);
 #else
 	for (TileIndex i = 0; i != size; i++) {
@@ -245,7 +265,7 @@ static void Load_WMAP()
 			_me[i].m7 = reader->RawReadByte();
 		}
 	} else if (_sl_xv_feature_versions[XSLFI_WHOLE_MAP_CHUNK] == 2) {
-#if TTD_ENDIAN == TTD_LITTLE_ENDIAN
+#if TTD_ENDIAN == TTD_LITTLE_ENDIAN && !defined(WITH_MAP_SOA)
 		reader->CopyBytes((byte *) _me, size * 4);
 #else
 		for (TileIndex i = 0; i != size; i++) {
@@ -268,11 +288,16 @@ static void Save_WMAP()
 	assert_compile(sizeof(TileExtended) == 4);
 	assert(_sl_xv_feature_versions[XSLFI_WHOLE_MAP_CHUNK] == 2);
 
+	if (_sl_map_delta_save) {
+		Save_WMAP_delta();
+		return;
+	}
+
 	MemoryDumper *dumper = MemoryDumper::GetCurrent();
 	const TileIndex size = MapSize();
 	SlSetLength(size * 12);
 
-#if TTD_ENDIAN == TTD_LITTLE_ENDIAN
+#if TTD_ENDIAN == TTD_LITTLE_ENDIAN && !defined(WITH_MAP_SOA)
 	dumper->CopyBytes((byte *) _m, size * 8);
 	dumper->CopyBytes((byte *) _me, size * 4);
 #else
@@ -297,6 +322,457 @@ static void Save_WMAP()
 #endif
 }
 
+/*
+ * Incremental autosaves store the map as a delta against a base file.
+ * A base file holds the whole map, compressed with the savegame format, and is named after the checksum of
+ * that map. The map chunk of an incremental autosave then only holds the blocks of tiles which differ from
+ * its base file. The blocks are compared by hash, so no bookkeeping of changed tiles is needed.
+ * When a new base file is needed, the autosave holds all blocks of the map instead, so it does not depend on
+ * any base file, and the save thread copies these blocks from the memory dump to the new base file.
+ * Base files written by this process are deleted once neither the current base nor any autosave of this
+ * process depends on them anymore. Base files of other processes are never deleted.
+ */
+
+static const uint MAP_DELTA_BLOCK_TILES = 4096;                  ///< Number of tiles in a block of the map delta.
+static const uint MAP_DELTA_BLOCK_BYTES = MAP_DELTA_BLOCK_TILES * 12; ///< Number of bytes of a block of the map delta.
+static const uint MAP_DELTA_RECORD_BYTES = 4 + MAP_DELTA_BLOCK_BYTES; ///< Number of bytes of a block and its index in the map delta.
+static const uint32 MAP_DELTA_BASE_MAGIC = TO_BE32X('OTMB');     ///< Identifier of the map delta base file.
+
+static std::vector<uint64> _map_delta_base_hashes; ///< Hashes of the blocks of the map in the current base file.
+static uint64 _map_delta_base_id;                 ///< Checksum of the whole map in the current base file.
+static std::vector<uint32> _map_delta_blocks;     ///< Blocks of the current save which differ from its base file.
+static uint64 _map_delta_save_id;                 ///< Checksum of the base file of the current save.
+
+/** A base file which is written by the save thread from the memory dump of an autosave holding all blocks. */
+struct MapDeltaPendingBase {
+	std::vector<uint64> hashes;           ///< Hashes of the blocks of the map.
+	uint64 id = 0;                        ///< Checksum of the whole map.
+	const MemoryDumper *dumper = nullptr; ///< Memory dump of the autosave holding all blocks, nullptr when not saved yet.
+	size_t offset = 0;                    ///< Offset of the first block in the memory dump.
+	bool written = false;                 ///< Whether the save thread has written the base file completely.
+};
+
+static bool _map_delta_base_pending = false;          ///< Whether #_map_delta_pending_base is in use.
+static MapDeltaPendingBase _map_delta_pending_base;   ///< The base file being written by the save thread.
+static std::map<std::string, uint64> _map_delta_autosave_bases; ///< Checksum of the base file each incremental autosave of this process depends on.
+/** Checksums of the base files written or loaded by this process, with the autosaves not written by this process which might depend on them. */
+static std::map<uint64, std::set<std::string>> _map_delta_tracked_bases;
+
+/**
+ * Get the name of the base file of a map.
+ * @param buf The buffer to write the name to.
+ * @param last The last element of the buffer.
+ * @param id The checksum of the map in the base file.
+ */
+static void GetMapDeltaBaseName(char *buf, const char *last, uint64 id)
+{
+	seprintf(buf, last, "autosave_base_" OTTD_PRINTFHEX64 ".dat", id);
+}
+
+/**
+ * Copy a range of tiles to a buffer in the layout of the WMAP chunk.
+ * @param begin The first tile.
+ * @param count The number of tiles.
+ * @param buf The buffer of 12 * \a count bytes.
+ */
+static void MapRangeToBuffer(TileIndex begin, uint count, byte *buf)
+{
+#if TTD_ENDIAN == TTD_LITTLE_ENDIAN && !defined(WITH_MAP_SOA)
+	memcpy(buf, _m + begin, count * 8);
+	memcpy(buf + count * 8, _me + begin, count * 4);
+#else
+	for (TileIndex i = begin; i != begin + count; i++) {
+		*buf++ = _m[i].type;
+		*buf++ = _m[i].height;
+		*buf++ = GB(_m[i].m2, 0, 8);
+		*buf++ = GB(_m[i].m2, 8, 8);
+		*buf++ = _m[i].m1;
+		*buf++ = _m[i].m3;
+		*buf++ = _m[i].m4;
+		*buf++ = _m[i].m5;
+	}
+	for (TileIndex i = begin; i != begin + count; i++) {
+		*buf++ = _me[i].m6;
+		*buf++ = _me[i].m7;
+		*buf++ = GB(_me[i].m8, 0, 8);
+		*buf++ = GB(_me[i].m8, 8, 8);
+	}
+#endif
+}
+
+/**
+ * Copy a buffer in the layout of the WMAP chunk to a range of tiles.
+ * @param buf The buffer of 12 * \a count bytes.
+ * @param begin The first tile.
+ * @param count The number of tiles.
+ */
+static void BufferToMapRange(const byte *buf, TileIndex begin, uint count)
+{
+#if TTD_ENDIAN == TTD_LITTLE_ENDIAN && !defined(WITH_MAP_SOA)
+	memcpy(_m + begin, buf, count * 8);
+	memcpy(_me + begin, buf + count * 8, count * 4);
+#else
+	for (TileIndex i = begin; i != begin + count; i++) {
+		_m[i].type = *buf++;
+		_m[i].height = *buf++;
+		_m[i].m2 = buf[0] | (buf[1] << 8);
+		buf += 2;
+		_m[i].m1 = *buf++;
+		_m[i].m3 = *buf++;
+		_m[i].m4 = *buf++;
+		_m[i].m5 = *buf++;
+	}
+	for (TileIndex i = begin; i != begin + count; i++) {
+		_me[i].m6 = *buf++;
+		_me[i].m7 = *buf++;
+		_me[i].m8 = buf[0] | (buf[1] << 8);
+		buf += 2;
+	}
+#endif
+}
+
+/**
+ * Continue a hash over some bytes in the layout of the WMAP chunk.
+ * @param hash The hash so far.
+ * @param data The bytes to hash.
+ * @param length The number of bytes, a multiple of 8.
+ * @return The new hash.
+ */
+static uint64 HashMapBytes(uint64 hash, const byte *data, size_t length)
+{
+	for (size_t i = 0; i < length; i += 8) {
+		uint64 word;
+		memcpy(&word, data + i, 8);
+		hash = ROL<uint64>(hash ^ (FROM_LE64(word) * 0x9E3779B97F4A7C15ULL), 31) * 0xC2B2AE3D27D4EB4FULL;
+	}
+	return hash;
+}
+
+/**
+ * Hash a block of the map.
+ * @param block The index of the block.
+ * @return The hash of the tiles of the block.
+ */
+static uint64 HashMapBlock(uint32 block)
+{
+	TileIndex begin = block * MAP_DELTA_BLOCK_TILES;
+#if TTD_ENDIAN == TTD_LITTLE_ENDIAN && !defined(WITH_MAP_SOA)
+	uint64 hash = HashMapBytes(block, (const byte *)(_m + begin), MAP_DELTA_BLOCK_TILES * 8);
+	return HashMapBytes(hash, (const byte *)(_me + begin), MAP_DELTA_BLOCK_TILES * 4);
+#else
+	std::array<byte, MAP_DELTA_BLOCK_BYTES> buf;
+	MapRangeToBuffer(begin, MAP_DELTA_BLOCK_TILES, buf.data());
+	uint64 hash = HashMapBytes(block, buf.data(), MAP_DELTA_BLOCK_TILES * 8);
+	return HashMapBytes(hash, buf.data() + MAP_DELTA_BLOCK_TILES * 8, MAP_DELTA_BLOCK_TILES * 4);
+#endif
+}
+
+/**
+ * Combine the hashes of all blocks into a checksum of the whole map.
+ * @param hashes The hashes of the blocks.
+ * @return The checksum.
+ */
+static uint64 CombineMapBlockHashes(const std::vector<uint64> &hashes)
+{
+	return HashMapBytes(hashes.size(), (const byte *)hashes.data(), hashes.size() * 8);
+}
+
+/**
+ * Write a base file from the memory dump of an autosave holding all blocks of the map.
+ * The file is written under a temporary name first, so a base file never exists partially.
+ * @param dumper The memory dump, which has been flushed.
+ * @param offset The offset of the first block in the memory dump.
+ * @param id The checksum of the map.
+ * @return Whether the file has been written completely.
+ */
+static bool WriteMapDeltaBaseFile(const MemoryDumper *dumper, size_t offset, uint64 id)
+{
+	char name[MAX_PATH];
+	GetMapDeltaBaseName(name, lastof(name), id);
+	char tmp_name[MAX_PATH];
+	seprintf(tmp_name, lastof(tmp_name), "%s.tmp", name);
+
+	try {
+		std::unique_ptr<SaveFilter> writer(CreateCompressedFileWriter(tmp_name, AUTOSAVE_DIR, MAP_DELTA_BASE_MAGIC));
+		if (writer == nullptr) return false;
+
+		uint32 header[4] = { TO_LE32(MapSizeX()), TO_LE32(MapSizeY()), TO_LE32((uint32)id), TO_LE32((uint32)(id >> 32)) };
+		writer->Write((byte *)header, sizeof(header));
+		dumper->WriteRange(writer.get(), offset, (size_t)(MapSize() / MAP_DELTA_BLOCK_TILES) * MAP_DELTA_RECORD_BYTES);
+		writer->Finish();
+	} catch (...) {
+		return false;
+	}
+
+	char tmp_path[MAX_PATH];
+	if (FioFindFullPath(tmp_path, lastof(tmp_path), AUTOSAVE_DIR, tmp_name) == nullptr) return false;
+	char path[MAX_PATH];
+	strecpy(path, tmp_path, lastof(path));
+	path[strlen(path) - strlen(".tmp")] = '\0';
+	remove(path);
+	return rename(tmp_path, path) == 0;
+}
+
+/**
+ * Write the pending base file, if the memory dump belongs to the autosave which holds its blocks.
+ * Called from the save thread once the memory dump has been written to the savegame.
+ * @param dumper The memory dump of the save.
+ */
+void SaveMapDeltaBase(const MemoryDumper *dumper)
+{
+	MapDeltaPendingBase &pending = _map_delta_pending_base;
+	if (!_map_delta_base_pending || pending.dumper != dumper) return;
+
+	pending.written = WriteMapDeltaBaseFile(dumper, pending.offset, pending.id);
+	pending.dumper = nullptr;
+}
+
+/**
+ * Delete a base file written by this process.
+ * @param id The checksum of the map in the base file.
+ */
+static void DeleteMapDeltaBaseFile(uint64 id)
+{
+	char name[MAX_PATH];
+	GetMapDeltaBaseName(name, lastof(name), id);
+	char path[MAX_PATH];
+	if (FioFindFullPath(path, lastof(path), AUTOSAVE_DIR, name) == nullptr) return;
+
+	DEBUG(sl, 2, "Incremental autosave: deleting unused base file '%s'", name);
+	remove(path);
+}
+
+/**
+ * Delete the base files written or loaded by this process which are neither the current base nor used by an autosave.
+ * A loaded base file is kept until all autosaves which were in the autosave directory when it was loaded have been overwritten.
+ */
+static void PruneMapDeltaBases()
+{
+	for (auto it = _map_delta_tracked_bases.begin(); it != _map_delta_tracked_bases.end();) {
+		uint64 id = it->first;
+		bool used = (!_map_delta_base_hashes.empty() && id == _map_delta_base_id) || !it->second.empty();
+		for (const auto &autosave : _map_delta_autosave_bases) {
+			if (autosave.second == id) used = true;
+		}
+		if (used) {
+			++it;
+		} else {
+			DeleteMapDeltaBaseFile(id);
+			it = _map_delta_tracked_bases.erase(it);
+		}
+	}
+}
+
+/**
+ * Make the pending base file the current base file when the save thread has written it.
+ * The save thread must have finished.
+ */
+static void AdoptPendingMapDeltaBase()
+{
+	_map_delta_base_pending = false;
+	MapDeltaPendingBase &pending = _map_delta_pending_base;
+	if (!pending.written) {
+		DEBUG(sl, 0, "Incremental autosave: could not write base file for map " OTTD_PRINTFHEX64 ", keeping the previous one", pending.id);
+		return;
+	}
+
+	_map_delta_base_hashes = std::move(pending.hashes);
+	_map_delta_base_id = pending.id;
+	_map_delta_tracked_bases.emplace(pending.id, std::set<std::string>());
+	pending = MapDeltaPendingBase();
+	PruneMapDeltaBases();
+}
+
+/**
+ * Read exactly the given number of bytes from a filter.
+ * @param reader The filter to read from.
+ * @param buf The buffer to read to.
+ * @param length The number of bytes to read.
+ */
+static void ReadMapDeltaBaseBytes(LoadFilter *reader, byte *buf, size_t length)
+{
+	while (length > 0) {
+		size_t read = reader->Read(buf, length);
+		if (read == 0) SlErrorCorrupt("Incremental autosave base file is truncated");
+		buf += read;
+		length -= read;
+	}
+}
+
+/** Scanner for the savegames in the autosave directory which have not been written by this process. */
+class MapDeltaAutosaveScanner : public FileScanner {
+public:
+	std::set<std::string> names; ///< Names of the found savegames.
+
+	bool AddFile(const char *filename, size_t basepath_length, const char *tar_filename) override
+	{
+		const char *name = filename + basepath_length;
+		if (_map_delta_autosave_bases.count(name) != 0) return false;
+		this->names.insert(name);
+		return true;
+	}
+};
+
+/**
+ * Load the whole map from a base file and remember its block hashes as the current base.
+ * The base file is tracked for deletion; as the autosaves of an earlier process might depend on it,
+ * it is only deleted once all the autosaves in the autosave directory have been overwritten.
+ * @param id The checksum of the map the base file holds.
+ */
+static void LoadMapDeltaBase(uint64 id)
+{
+	char name[MAX_PATH];
+	GetMapDeltaBaseName(name, lastof(name), id);
+	std::unique_ptr<LoadFilter> reader(CreateCompressedFileReader(name, AUTOSAVE_DIR, MAP_DELTA_BASE_MAGIC));
+	if (reader == nullptr) SlErrorCorruptFmt("Incremental autosave base file '%s' is missing or unreadable", name);
+
+	uint32 header[4];
+	ReadMapDeltaBaseBytes(reader.get(), (byte *)header, sizeof(header));
+	uint64 base_id = FROM_LE32(header[2]) | ((uint64)FROM_LE32(header[3]) << 32);
+	if (FROM_LE32(header[0]) != MapSizeX() || FROM_LE32(header[1]) != MapSizeY() || base_id != id) {
+		SlErrorCorruptFmt("Incremental autosave base file '%s' does not match the autosave", name);
+	}
+
+	std::vector<uint64> hashes(MapSize() / MAP_DELTA_BLOCK_TILES);
+	std::array<byte, MAP_DELTA_RECORD_BYTES> buf;
+	for (uint32 block = 0; block != hashes.size(); block++) {
+		ReadMapDeltaBaseBytes(reader.get(), buf.data(), buf.size());
+		if (((uint32)buf[0] << 24 | buf[1] << 16 | buf[2] << 8 | buf[3]) != block) {
+			SlErrorCorruptFmt("Incremental autosave base file '%s' is corrupt", name);
+		}
+		BufferToMapRange(buf.data() + 4, block * MAP_DELTA_BLOCK_TILES, MAP_DELTA_BLOCK_TILES);
+		hashes[block] = HashMapBlock(block);
+	}
+	if (CombineMapBlockHashes(hashes) != id) SlErrorCorruptFmt("Incremental autosave base file '%s' is corrupt", name);
+
+	_map_delta_base_hashes = std::move(hashes);
+	_map_delta_base_id = id;
+
+	MapDeltaAutosaveScanner scanner;
+	scanner.Scan(".sav", AUTOSAVE_DIR, false, false);
+	_map_delta_tracked_bases[id].insert(scanner.names.begin(), scanner.names.end());
+}
+
+static void Load_WMAP_delta()
+{
+	uint64 id = SlReadUint64();
+	uint32 block_tiles = SlReadUint32();
+	uint32 count = SlReadUint32();
+	if (block_tiles != MAP_DELTA_BLOCK_TILES) SlErrorCorruptFmt("Invalid map delta block size: %u", block_tiles);
+	if (count > MapSize() / MAP_DELTA_BLOCK_TILES) SlErrorCorruptFmt("Invalid map delta block count: %u", count);
+
+	/* An autosave holding all blocks does not depend on a base file. */
+	if (count != MapSize() / MAP_DELTA_BLOCK_TILES) LoadMapDeltaBase(id);
+
+	ReadBuffer *reader = ReadBuffer::GetCurrent();
+	std::array<byte, MAP_DELTA_BLOCK_BYTES> buf;
+	for (uint32 i = 0; i != count; i++) {
+		uint32 block = SlReadUint32();
+		if (block >= MapSize() / MAP_DELTA_BLOCK_TILES) SlErrorCorruptFmt("Invalid map delta block: %u", block);
+		reader->CopyBytes(buf.data(), buf.size());
+		BufferToMapRange(buf.data(), block * MAP_DELTA_BLOCK_TILES, MAP_DELTA_BLOCK_TILES);
+	}
+}
+
+static void Save_WMAP_delta()
+{
+	SlSetLength(16 + _map_delta_blocks.size() * MAP_DELTA_RECORD_BYTES);
+	SlWriteUint64(_map_delta_save_id);
+	SlWriteUint32(MAP_DELTA_BLOCK_TILES);
+	SlWriteUint32((uint32)_map_delta_blocks.size());
+
+	MemoryDumper *dumper = MemoryDumper::GetCurrent();
+	if (_map_delta_base_pending && _map_delta_save_id == _map_delta_pending_base.id) {
+		/* The blocks of this save are copied to the pending base file by the save thread. */
+		_map_delta_pending_base.dumper = dumper;
+		_map_delta_pending_base.offset = dumper->GetSize();
+	}
+
+	std::array<byte, MAP_DELTA_BLOCK_BYTES> buf;
+	for (uint32 block : _map_delta_blocks) {
+		SlWriteUint32(block);
+		MapRangeToBuffer(block * MAP_DELTA_BLOCK_TILES, MAP_DELTA_BLOCK_TILES, buf.data());
+		dumper->CopyBytes(buf.data(), buf.size());
+	}
+}
+
+/**
+ * Prepare the map for an incremental autosave.
+ * The blocks of the map are compared with those of the current base file. When too much has changed since
+ * the base file was written, or there is no suitable base file, the autosave holds all blocks instead and
+ * the save thread writes a new base file from them.
+ * @return Whether the next save should store the map as a delta; when false a regular save has to be made.
+ */
+bool PrepareMapDeltaAutosave()
+{
+	assert_compile(MIN_MAP_SIZE * MIN_MAP_SIZE % MAP_DELTA_BLOCK_TILES == 0);
+
+	if (_map_delta_base_pending) {
+		/* The previous autosave wrote a new base file; it has normally finished long ago. */
+		WaitTillSaved();
+		AdoptPendingMapDeltaBase();
+	}
+
+	std::vector<uint64> hashes(MapSize() / MAP_DELTA_BLOCK_TILES);
+	WorkerParallelFor("ottd:mapdelta", hashes.size(), 256, [&](size_t begin, size_t end) {
+		for (size_t block = begin; block != end; block++) hashes[block] = HashMapBlock((uint32)block);
+	});
+
+	_map_delta_blocks.clear();
+	if (_map_delta_base_hashes.size() == hashes.size()) {
+		for (uint32 block = 0; block != hashes.size(); block++) {
+			if (hashes[block] != _map_delta_base_hashes[block]) _map_delta_blocks.push_back(block);
+		}
+		/* Write a new base file when a quarter of the map has changed, later deltas would be needlessly large. */
+		if (_map_delta_blocks.size() <= hashes.size() / 4) {
+			DEBUG(sl, 2, "Incremental autosave: %u of %u map blocks changed", (uint)_map_delta_blocks.size(), (uint)hashes.size());
+			_map_delta_save_id = _map_delta_base_id;
+			_sl_map_delta_save = true;
+			return true;
+		}
+	}
+
+	DEBUG(sl, 2, "Incremental autosave: saving all map blocks and writing a new base file");
+	_map_delta_blocks.resize(hashes.size());
+	for (uint32 block = 0; block != hashes.size(); block++) _map_delta_blocks[block] = block;
+
+	MapDeltaPendingBase &pending = _map_delta_pending_base;
+	pending = MapDeltaPendingBase();
+	pending.id = CombineMapBlockHashes(hashes);
+	pending.hashes = std::move(hashes);
+	_map_delta_base_pending = true;
+	_map_delta_save_id = pending.id;
+	_sl_map_delta_save = true;
+	return true;
+}
+
+/**
+ * Finish an autosave and delete the base files which are not used anymore.
+ * @param name The name of the autosave.
+ * @param incremental Whether the autosave has been prepared by #PrepareMapDeltaAutosave.
+ * @param saved Whether the autosave has been made; the save thread might still be writing it.
+ */
+void FinishMapDeltaAutosave(const char *name, bool incremental, bool saved)
+{
+	_sl_map_delta_save = false;
+	_map_delta_blocks.clear();
+
+	if (!saved) {
+		/* The save thread has not been started, so the pending base file will not be written. */
+		if (incremental) _map_delta_base_pending = false;
+		return;
+	}
+
+	if (incremental) {
+		_map_delta_autosave_bases[name] = _map_delta_save_id;
+	} else {
+		_map_delta_autosave_bases.erase(name);
+	}
+	/* The autosave has been overwritten, so it no longer depends on a loaded base file. */
+	for (auto &it : _map_delta_tracked_bases) it.second.erase(name);
+	PruneMapDeltaBases();
+}
+
 extern const ChunkHandler _map_chunk_handlers[] = {
 	{ 'MAPS', Save_MAPS, Load_MAPS, nullptr, Check_MAPS, CH_RIFF },
 	{ 'MAPT', nullptr,      Load_MAPT, nullptr, nullptr,       CH_RIFF },
@@ -47,7 +47,11 @@ void FixOldMapArray()
 {
 	/* TTO/TTD/TTDP savegames could have buoys at tile 0
 	 * (without assigned station struct) */
+#ifdef WITH_MAP_SOA
+	_m.Clear(0, 1);
+#else
 	MemSetT(&_m[0], 0);
+#endif
 	SetTileType(0, MP_WATER);
 	SetTileOwner(0, OWNER_WATER);
 }
@@ -1465,8 +1469,13 @@ static bool LoadOldGameDifficulty(LoadgameState *ls, int num)
 static bool LoadOldMapPart1(LoadgameState *ls, int num)
 {
 	if (_savegame_type == SGT_TTO) {
+#ifdef WITH_MAP_SOA
+		_m.Clear(0, OLD_MAP_SIZE);
+		_me.Clear(0, OLD_MAP_SIZE);
+#else
 		MemSetT(_m, 0, OLD_MAP_SIZE);
 		MemSetT(_me, 0, OLD_MAP_SIZE);
+#endif
 	}
 
 	for (uint i = 0; i < OLD_MAP_SIZE; i++) {
@@ -377,6 +377,8 @@ void DoExitSave();
 
 SaveOrLoadResult SaveWithFilter(struct SaveFilter *writer, bool threaded);
 SaveOrLoadResult LoadWithFilter(struct LoadFilter *reader);
+struct SaveFilter *CreateCompressedFileWriter(const char *filename, Subdirectory sb, uint32 magic);
+struct LoadFilter *CreateCompressedFileReader(const char *filename, Subdirectory sb, uint32 magic);
 
 typedef void ChunkSaveLoadProc();
 typedef void AutolengthProc(void *arg);
@@ -1050,7 +1052,7 @@ void NORETURN CDECL SlErrorCorruptFmt(const char *format, ...) WARN_FORMAT(1, 2)
 
 bool SaveloadCrashWithMissingNewGRFs();
 
-extern char _savegame_format[8];
+extern char _savegame_format[16];
 extern bool _do_autosave;
 
 #endif /* SAVELOAD_H */
@@ -256,6 +256,7 @@ struct MemoryDumper {
 	}
 
 	void Flush(SaveFilter *writer);
+	void WriteRange(SaveFilter *writer, size_t offset, size_t length) const;
 	size_t GetSize() const;
 	void StartAutoLength();
 	std::pair<byte *, size_t> StopAutoLength();
@@ -111,7 +111,13 @@ struct GUISettings {
 	bool   disable_unsuitable_building;      ///< disable infrastructure building when no suitable vehicles are available
 	byte   autosave;                         ///< how often should we do autosaves?
 	bool   threaded_saves;                   ///< should we do threaded saves?
+	uint8  worker_threads;                   ///< maximum number of worker threads for background tasks, 0 = automatic
+	bool   speculative_train_pathfinding;    ///< run the path searches of trains about to enter a junction ahead on the worker threads
+	bool   parallel_viewport_sort;           ///< sort the sprites of the parts of large viewport redraws on the worker threads
+	bool   parallel_sprite_prefetch;         ///< decode the sprites a viewport is about to draw on the worker threads
+	uint8  linkgraph_mcf_threads;            ///< number of threads to use for the path searches of the link graph MCF solver (0 or 1 = single threaded)
 	bool   keep_all_autosave;                ///< name the autosave in a different way
+	bool   incremental_autosave;             ///< autosaves only store the map blocks changed since the autosave base file was written
 	bool   autosave_on_exit;                 ///< save an autosave when you quit the game, but do not ask "Do you really want to quit?"
 	bool   autosave_on_network_disconnect;   ///< save an autosave when you get disconnected from a network game with an error?
 	uint8  date_format_in_default_names;     ///< should the default savegame/screenshot name use long dates (31th Dec 2008), short dates (31-12-2008) or ISO dates (2008-12-31)
@@ -478,6 +484,7 @@ struct YAPFSettings {
 	uint32 rail_shorter_platform_per_tile_penalty; ///< penalty for shorter station platform than train (per tile)
 	uint32 ship_curve45_penalty;                   ///< penalty for 45-deg curve for ships
 	uint32 ship_curve90_penalty;                   ///< penalty for 90-deg curve for ships
+	bool   ship_use_water_regions;                 ///< restrict the ship pathfinder to the path found on the water regions
 };
 
 /** Settings related to all pathfinders. */
@@ -21,6 +21,9 @@
 #include "error.h"
 #include "infrastructure_func.h"
 
+#include <algorithm>
+#include <unordered_map>
+
 #include "safeguards.h"
 
 /// List of signals dependent upon this one
@@ -221,6 +224,109 @@ static Vehicle *TrainInWormholeTileEnum(Vehicle *v, void *data)
 	return v;
 }
 
+/** Type of a check for trains done while exploring a signal segment */
+enum SignalSegmentTrainCheckType : uint8 {
+	SSTCT_ON_TILE,       ///< Any train on the tile, not in a depot, see TrainOnTileEnum
+	SSTCT_ON_TRACK_BITS, ///< Any train on the given track bits of the tile
+	SSTCT_IN_WORMHOLE,   ///< The front or back of a train in the wormhole or on the ramp of another tile, see TrainInWormholeTileEnum
+};
+
+/** A check for trains done while exploring a signal segment, which can be repeated without exploring the segment again */
+struct SignalSegmentTrainCheck {
+	TileIndex tile;                    ///< Tile to search for vehicles on
+	TileIndex ramp_tile;               ///< Tunnel or bridge end the train has to be on, for SSTCT_IN_WORMHOLE
+	TrackBits tracks;                  ///< Track bits to check, for SSTCT_ON_TRACK_BITS
+	SignalSegmentTrainCheckType type;  ///< Type of check
+
+	static SignalSegmentTrainCheck OnTile(TileIndex tile)
+	{
+		return { tile, INVALID_TILE, TRACK_BIT_NONE, SSTCT_ON_TILE };
+	}
+
+	static SignalSegmentTrainCheck OnTrackBits(TileIndex tile, TrackBits tracks)
+	{
+		return { tile, INVALID_TILE, tracks, SSTCT_ON_TRACK_BITS };
+	}
+
+	static SignalSegmentTrainCheck InWormhole(TileIndex tile, TileIndex ramp_tile)
+	{
+		return { tile, ramp_tile, TRACK_BIT_NONE, SSTCT_IN_WORMHOLE };
+	}
+
+	bool IsTrainPresent() const
+	{
+		switch (this->type) {
+			case SSTCT_ON_TILE:
+				return HasVehicleOnPos(this->tile, nullptr, &TrainOnTileEnum);
+
+			case SSTCT_ON_TRACK_BITS:
+				return EnsureNoTrainOnTrackBits(this->tile, this->tracks).Failed();
+
+			case SSTCT_IN_WORMHOLE: {
+				TileIndex ramp_tile = this->ramp_tile;
+				return HasVehicleOnPos(this->tile, &ramp_tile, &TrainInWormholeTileEnum);
+			}
+
+			default:
+				NOT_REACHED();
+		}
+	}
+};
+
+/**
+ * Everything ExploreSegment did when exploring a segment from a given starting point, which only depends on the track layout.
+ * Replaying it gives the same result as exploring the segment again, without walking over the tiles of the segment.
+ */
+struct SignalSegmentCacheItem {
+	std::vector<SignalSegmentTrainCheck> train_checks;                   ///< Checks for trains in the segment
+	std::vector<std::pair<TileIndex, Trackdir>> update_signals;          ///< Signals added to _tbuset, in order
+	std::vector<std::pair<TileIndex, DiagDirection>> globset_removals;   ///< Items removed from _globset, in order
+	std::vector<std::pair<TileIndex, Trackdir>> presignal_exits;         ///< Pre-signal exits in the segment
+	std::vector<TileIndex> train_check_tiles;                            ///< Distinct tiles of the train checks
+	uint occupied_tiles;                                                 ///< Number of train_check_tiles which have trains indexed on them
+	bool pbs;                                                            ///< Whether the segment is a PBS segment
+	bool no_segment;                                                     ///< The starting point did not lead to any track, nothing was explored
+
+	void Clear()
+	{
+		this->train_checks.clear();
+		this->update_signals.clear();
+		this->globset_removals.clear();
+		this->presignal_exits.clear();
+		this->train_check_tiles.clear();
+		this->occupied_tiles = 0;
+		this->pbs = false;
+		this->no_segment = false;
+	}
+
+	size_t Size() const
+	{
+		return this->train_checks.size() + this->update_signals.size() + this->globset_removals.size() + this->presignal_exits.size() + this->train_check_tiles.size();
+	}
+};
+
+/** Trains on a tile checked by items of the signal segment cache. */
+struct SignalSegmentCacheTile {
+	uint trains = 0;            ///< Number of trains indexed on the tile, see CountTrainsIndexedOnTile
+	std::vector<uint64> items;  ///< Keys of the cache items checking the tile
+};
+
+static const size_t SIGNAL_SEGMENT_CACHE_MAX_SIZE = 1 << 20; ///< Total number of recorded items after which the signal segment cache is emptied
+
+/**
+ * Cache of explored signal segments, keyed by the starting point taken from _globset, and the owner.
+ * The track layout must not change while items are in the cache, see SuspendSignalSegmentCache.
+ */
+static std::unordered_map<uint64, SignalSegmentCacheItem> _signal_segment_cache;
+static std::unordered_map<TileIndex, SignalSegmentCacheTile> _signal_segment_cache_tiles; ///< Tiles checked for trains by the items of _signal_segment_cache
+static size_t _signal_segment_cache_size = 0;       ///< Total size of the items in _signal_segment_cache
+static uint _signal_segment_cache_suspend_count = 0; ///< While non-zero the track layout may be changing, and the cache is not used
+
+static inline uint64 GetSignalSegmentCacheKey(TileIndex tile, DiagDirection dir, Owner owner)
+{
+	return ((uint64)tile << 16) | ((uint64)(byte)dir << 8) | (uint64)(byte)owner;
+}
+
 /**
  * Perform some operations before adding data into Todo set
  * The new and reverse direction is removed from _globset, because we are sure
@@ -232,12 +338,17 @@ static Vehicle *TrainInWormholeTileEnum(Vehicle *v, void *data)
  * @param d1 direction (tile side) we are entering
  * @param t2 tile we are leaving
  * @param d2 direction (tile side) we are leaving
+ * @param record where to record the changes to _globset, may be nullptr
  * @return false iff reverse direction was in Todo set
  */
-static inline bool CheckAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2)
+static inline bool CheckAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2, SignalSegmentCacheItem *record)
 {
 	_globset.Remove(t1, d1); // it can be in Global but not in Todo
 	_globset.Remove(t2, d2); // remove in all cases
+	if (record != nullptr) {
+		record->globset_removals.push_back({ t1, d1 });
+		record->globset_removals.push_back({ t2, d2 });
+	}
 
 	assert(!_tbdset.IsIn(t1, d1)); // it really shouldn't be there already
 
@@ -258,11 +369,12 @@ static inline bool CheckAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t
  * @param d1 direction (tile side) we are entering
  * @param t2 tile we are leaving
  * @param d2 direction (tile side) we are leaving
+ * @param record where to record the changes to _globset, may be nullptr
  * @return false iff the Todo buffer would be overrun
  */
-static inline bool MaybeAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2)
+static inline bool MaybeAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2, SignalSegmentCacheItem *record)
 {
-	if (!CheckAddToTodoSet(t1, d1, t2, d2)) return true;
+	if (!CheckAddToTodoSet(t1, d1, t2, d2, record)) return true;
 
 	return _tbdset.Add(t1, d1);
 }
@@ -294,12 +406,22 @@ struct SigInfo {
  * Search signal block
  *
  * @param owner owner whose signals we are updating
+ * @param record where to record the exploration for the signal segment cache, may be nullptr
  * @return SigFlags
  */
-static SigInfo ExploreSegment(Owner owner)
+static SigInfo ExploreSegment(Owner owner, SignalSegmentCacheItem *record)
 {
 	SigInfo info;
 
+	auto check_train = [&](const SignalSegmentTrainCheck &check) {
+		if (record != nullptr) record->train_checks.push_back(check);
+		if (!(info.flags & SF_TRAIN) && check.IsTrainPresent()) info.flags |= SF_TRAIN;
+	};
+	auto add_signal_to_update = [&](TileIndex tile, Trackdir trackdir) -> bool {
+		if (record != nullptr) record->update_signals.push_back({ tile, trackdir });
+		return _tbuset.Add(tile, trackdir);
+	};
+
 	TileIndex tile;
 	DiagDirection enterdir;
 
@@ -313,13 +435,13 @@ static SigInfo ExploreSegment(Owner owner)
 
 				if (IsRailDepot(tile)) {
 					if (enterdir == INVALID_DIAGDIR) { // from 'inside' - train just entered or left the depot
-						if (!(info.flags & SF_TRAIN) && HasVehicleOnPos(tile, nullptr, &TrainOnTileEnum)) info.flags |= SF_TRAIN;
+						check_train(SignalSegmentTrainCheck::OnTile(tile));
 						exitdir = GetRailDepotDirection(tile);
 						tile += TileOffsByDiagDir(exitdir);
 						enterdir = ReverseDiagDir(exitdir);
 						break;
 					} else if (enterdir == GetRailDepotDirection(tile)) { // entered a depot
-						if (!(info.flags & SF_TRAIN) && HasVehicleOnPos(tile, nullptr, &TrainOnTileEnum)) info.flags |= SF_TRAIN;
+						check_train(SignalSegmentTrainCheck::OnTile(tile));
 						continue;
 					} else {
 						continue;
@@ -333,10 +455,10 @@ static SigInfo ExploreSegment(Owner owner)
 				if (tracks == TRACK_BIT_HORZ || tracks == TRACK_BIT_VERT) { // there is exactly one incidating track, no need to check
 					tracks = tracks_masked;
 					/* If no train detected yet, and there is not no train -> there is a train -> set the flag */
-					if (!(info.flags & SF_TRAIN) && EnsureNoTrainOnTrackBits(tile, tracks).Failed()) info.flags |= SF_TRAIN;
+					check_train(SignalSegmentTrainCheck::OnTrackBits(tile, tracks));
 				} else {
 					if (tracks_masked == TRACK_BIT_NONE) continue; // no incidating track
-					if (!(info.flags & SF_TRAIN) && HasVehicleOnPos(tile, nullptr, &TrainOnTileEnum)) info.flags |= SF_TRAIN;
+					check_train(SignalSegmentTrainCheck::OnTile(tile));
 				}
 
 				if (HasSignals(tile)) { // there is exactly one track - not zero, because there is exit from this tile
@@ -351,7 +473,7 @@ static SigInfo ExploreSegment(Owner owner)
 						if (HasSignalOnTrackdir(tile, reversedir)) {
 							if (IsPbsSignal(sig)) {
 								info.flags |= SF_PBS;
-							} else if (!_tbuset.Add(tile, reversedir)) {
+							} else if (!add_signal_to_update(tile, reversedir)) {
 								info.flags |= SF_FULL;
 								return info;
 							}
@@ -360,6 +482,7 @@ static SigInfo ExploreSegment(Owner owner)
 
 						/* if it is a presignal EXIT in OUR direction, count it */
 						if (IsPresignalExit(tile, track) && HasSignalOnTrackdir(tile, trackdir)) { // found presignal exit
+							if (record != nullptr) record->presignal_exits.push_back({ tile, trackdir });
 							info.num_exits++;
 							if (GetSignalStateByTrackdir(tile, trackdir) == SIGNAL_STATE_GREEN) { // found green presignal exit
 								info.num_green++;
@@ -374,7 +497,7 @@ static SigInfo ExploreSegment(Owner owner)
 					if (dir != enterdir && (tracks & _enterdir_to_trackbits[dir])) { // any track incidating?
 						TileIndex newtile = tile + TileOffsByDiagDir(dir);  // new tile to check
 						DiagDirection newdir = ReverseDiagDir(dir); // direction we are entering from
-						if (!MaybeAddToTodoSet(newtile, newdir, tile, dir)) {
+						if (!MaybeAddToTodoSet(newtile, newdir, tile, dir, record)) {
 							info.flags |= SF_FULL;
 							return info;
 						}
@@ -390,7 +513,7 @@ static SigInfo ExploreSegment(Owner owner)
 				if (DiagDirToAxis(enterdir) != GetRailStationAxis(tile)) continue; // different axis
 				if (IsStationTileBlocked(tile)) continue; // 'eye-candy' station tile
 
-				if (!(info.flags & SF_TRAIN) && HasVehicleOnPos(tile, nullptr, &TrainOnTileEnum)) info.flags |= SF_TRAIN;
+				check_train(SignalSegmentTrainCheck::OnTile(tile));
 				tile += TileOffsByDiagDir(exitdir);
 				break;
 
@@ -399,7 +522,7 @@ static SigInfo ExploreSegment(Owner owner)
 				if (!IsOneSignalBlock(owner, GetTileOwner(tile))) continue;
 				if (DiagDirToAxis(enterdir) == GetCrossingRoadAxis(tile)) continue; // different axis
 
-				if (!(info.flags & SF_TRAIN) && HasVehicleOnPos(tile, nullptr, &TrainOnTileEnum)) info.flags |= SF_TRAIN;
+				check_train(SignalSegmentTrainCheck::OnTile(tile));
 				if (_settings_game.vehicle.safer_crossings) info.flags |= SF_PBS;
 				tile += TileOffsByDiagDir(exitdir);
 				break;
@@ -414,15 +537,15 @@ static SigInfo ExploreSegment(Owner owner)
 				TrackBits tracks = GetTunnelBridgeTrackBits(tile);
 				TrackBits across_tracks = GetAcrossTunnelBridgeTrackBits(tile);
 
-				auto check_train_present = [tile, tracks, across_tracks](DiagDirection enterdir) -> bool {
+				auto check_train_present = [&check_train, tile, tracks, across_tracks](DiagDirection enterdir) {
 					if (tracks == TRACK_BIT_HORZ || tracks == TRACK_BIT_VERT) {
 						if (_enterdir_to_trackbits[enterdir] & across_tracks) {
-							return EnsureNoTrainOnTrackBits(tile, TRACK_BIT_WORMHOLE | across_tracks).Failed();
+							check_train(SignalSegmentTrainCheck::OnTrackBits(tile, TRACK_BIT_WORMHOLE | across_tracks));
 						} else {
-							return EnsureNoTrainOnTrackBits(tile, tracks & (~across_tracks)).Failed();
+							check_train(SignalSegmentTrainCheck::OnTrackBits(tile, tracks & (~across_tracks)));
 						}
 					} else {
-						return HasVehicleOnPos(tile, nullptr, &TrainOnTileEnum);
+						check_train(SignalSegmentTrainCheck::OnTile(tile));
 					}
 				};
 
@@ -432,11 +555,11 @@ static SigInfo ExploreSegment(Owner owner)
 				if (IsTunnelBridgeWithSignalSimulation(tile)) {
 					if (enterdir == INVALID_DIAGDIR) {
 						// incoming from the wormhole, onto signal
-						if (!(info.flags & SF_TRAIN) && IsTunnelBridgeSignalSimulationExit(tile)) { // tunnel entrance is ignored
-							if (HasVehicleOnPos(GetOtherTunnelBridgeEnd(tile), &tile, &TrainInWormholeTileEnum)) info.flags |= SF_TRAIN;
-							if (!(info.flags & SF_TRAIN) && HasVehicleOnPos(tile, &tile, &TrainInWormholeTileEnum)) info.flags |= SF_TRAIN;
+						if (IsTunnelBridgeSignalSimulationExit(tile)) { // tunnel entrance is ignored
+							check_train(SignalSegmentTrainCheck::InWormhole(GetOtherTunnelBridgeEnd(tile), tile));
+							check_train(SignalSegmentTrainCheck::InWormhole(tile, tile));
 						}
-						if (IsTunnelBridgeSignalSimulationExit(tile) && !_tbuset.Add(tile, INVALID_TRACKDIR)) {
+						if (IsTunnelBridgeSignalSimulationExit(tile) && !add_signal_to_update(tile, INVALID_TRACKDIR)) {
 							info.flags |= SF_FULL;
 							return info;
 						}
@@ -450,38 +573,36 @@ static SigInfo ExploreSegment(Owner owner)
 						if (IsTunnelBridgeSignalSimulationExit(tile)) {
 							if (IsTunnelBridgePBS(tile)) {
 								info.flags |= SF_PBS;
-							} else if (!_tbuset.Add(tile, INVALID_TRACKDIR)) {
+							} else if (!add_signal_to_update(tile, INVALID_TRACKDIR)) {
 								info.flags |= SF_FULL;
 								return info;
 							}
 						}
-						if (!(info.flags & SF_TRAIN)) {
-							if (HasVehicleOnPos(tile, &tile, &TrainInWormholeTileEnum)) info.flags |= SF_TRAIN;
-							if (!(info.flags & SF_TRAIN) && IsTunnelBridgeSignalSimulationExit(tile)) {
-								if (HasVehicleOnPos(GetOtherTunnelBridgeEnd(tile), &tile, &TrainInWormholeTileEnum)) info.flags |= SF_TRAIN;
-							}
+						check_train(SignalSegmentTrainCheck::InWormhole(tile, tile));
+						if (IsTunnelBridgeSignalSimulationExit(tile)) {
+							check_train(SignalSegmentTrainCheck::InWormhole(GetOtherTunnelBridgeEnd(tile), tile));
 						}
 						continue;
 					}
 				}
 				if (enterdir == INVALID_DIAGDIR) { // incoming from the wormhole
-					if (!(info.flags & SF_TRAIN) && check_train_present(tunnel_bridge_dir)) info.flags |= SF_TRAIN;
+					check_train_present(tunnel_bridge_dir);
 					enterdir = tunnel_bridge_dir;
 				} else if (enterdir != tunnel_bridge_dir) { // NOT incoming from the wormhole!
 					if (tracks_masked == TRACK_BIT_NONE) continue; // no incidating track
-					if (!(info.flags & SF_TRAIN) && check_train_present(enterdir)) info.flags |= SF_TRAIN;
+					check_train_present(enterdir);
 				}
 				for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) { // test all possible exit directions
 					if (dir != enterdir && (tracks & _enterdir_to_trackbits[dir])) { // any track incidating?
 						if (dir == tunnel_bridge_dir) {
-							if (!MaybeAddToTodoSet(GetOtherTunnelBridgeEnd(tile), INVALID_DIAGDIR, tile, INVALID_DIAGDIR)) {
+							if (!MaybeAddToTodoSet(GetOtherTunnelBridgeEnd(tile), INVALID_DIAGDIR, tile, INVALID_DIAGDIR, record)) {
 								info.flags |= SF_FULL;
 								return info;
 							}
 						} else {
 							TileIndex newtile = tile + TileOffsByDiagDir(dir);  // new tile to check
 							DiagDirection newdir = ReverseDiagDir(dir); // direction we are entering from
-							if (!MaybeAddToTodoSet(newtile, newdir, tile, dir)) {
+							if (!MaybeAddToTodoSet(newtile, newdir, tile, dir, record)) {
 								info.flags |= SF_FULL;
 								return info;
 							}
@@ -495,11 +616,51 @@ static SigInfo ExploreSegment(Owner owner)
 				continue; // continue the while() loop
 		}
 
-		if (!MaybeAddToTodoSet(tile, enterdir, oldtile, exitdir)) {
+		if (!MaybeAddToTodoSet(tile, enterdir, oldtile, exitdir, record)) {
 			info.flags |= SF_FULL;
 		}
 	}
 
+	if (record != nullptr) record->pbs = (info.flags & SF_PBS) != 0;
+
+	return info;
+}
+
+/**
+ * Repeat the exploration of a signal segment recorded by ExploreSegment
+ *
+ * @param item the recorded exploration
+ * @return the same as ExploreSegment would return
+ */
+static SigInfo ReplaySegment(const SignalSegmentCacheItem &item)
+{
+	SigInfo info;
+	if (item.pbs) info.flags |= SF_PBS;
+
+	for (const auto &it : item.globset_removals) {
+		if (_globset.IsEmpty()) break;
+		_globset.Remove(it.first, it.second);
+	}
+
+	for (const auto &it : item.update_signals) {
+		_tbuset.Add(it.first, it.second);
+	}
+
+	/* Without any trains on the checked tiles none of the checks can find a train. */
+	if (item.occupied_tiles != 0) {
+		for (const SignalSegmentTrainCheck &check : item.train_checks) {
+			if (check.IsTrainPresent()) {
+				info.flags |= SF_TRAIN;
+				break;
+			}
+		}
+	}
+
+	for (const auto &it : item.presignal_exits) {
+		info.num_exits++;
+		if (GetSignalStateByTrackdir(it.first, it.second) == SIGNAL_STATE_GREEN) info.num_green++;
+	}
+
 	return info;
 }
 
@@ -590,6 +751,129 @@ static void UpdateSignalsAroundSegment(SigInfo info)
 }
 
 
+/**
+ * Put the starting point of a signal segment into _tbdset
+ *
+ * @param tile tile taken from _globset
+ * @param dir direction taken from _globset
+ * @return false if there is no track to start the search from
+ */
+static bool StartSegmentSearch(TileIndex tile, DiagDirection dir)
+{
+	/* After updating signal, data stored are always MP_RAILWAY with signals.
+	 * Other situations happen when data are from outside functions -
+	 * modification of railbits (including both rail building and removal),
+	 * train entering/leaving block, train leaving depot...
+	 */
+	switch (GetTileType(tile)) {
+		case MP_TUNNELBRIDGE: {
+			/* 'optimization assert' - do not try to update signals when it is not needed */
+			assert_tile(GetTunnelBridgeTransportType(tile) == TRANSPORT_RAIL, tile);
+			if (IsTunnel(tile)) assert(dir == INVALID_DIAGDIR || dir == ReverseDiagDir(GetTunnelBridgeDirection(tile)));
+			TrackBits across = GetAcrossTunnelBridgeTrackBits(tile);
+			if (dir == INVALID_DIAGDIR || _enterdir_to_trackbits[dir] & across) {
+				_tbdset.Add(tile, INVALID_DIAGDIR);  // we can safely start from wormhole centre
+				if (!IsTunnelBridgeWithSignalSimulation(tile)) {  // Don't worry with other side of tunnel.
+					_tbdset.Add(GetOtherTunnelBridgeEnd(tile), INVALID_DIAGDIR);
+				}
+				break;
+			}
+		}
+			FALLTHROUGH;
+
+		case MP_RAILWAY:
+			if (IsRailDepotTile(tile)) {
+				/* 'optimization assert' do not try to update signals in other cases */
+				assert(dir == INVALID_DIAGDIR || dir == GetRailDepotDirection(tile));
+				_tbdset.Add(tile, INVALID_DIAGDIR); // start from depot inside
+				break;
+			}
+			FALLTHROUGH;
+
+		case MP_STATION:
+		case MP_ROAD:
+			if ((TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_RAIL, 0)) & _enterdir_to_trackbits[dir]) != TRACK_BIT_NONE) {
+				/* only add to set when there is some 'interesting' track */
+				_tbdset.Add(tile, dir);
+				_tbdset.Add(tile + TileOffsByDiagDir(dir), ReverseDiagDir(dir));
+				break;
+			}
+			FALLTHROUGH;
+
+		default:
+			/* jump to next tile */
+			tile = tile + TileOffsByDiagDir(dir);
+			dir = ReverseDiagDir(dir);
+			if ((TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_RAIL, 0)) & _enterdir_to_trackbits[dir]) != TRACK_BIT_NONE) {
+				_tbdset.Add(tile, dir);
+				break;
+			}
+			/* happens when removing a rail that wasn't connected at one or both sides */
+			return false;
+	}
+
+	assert(!_tbdset.Overflowed()); // it really shouldn't overflow by these one or two items
+	assert(!_tbdset.IsEmpty()); // it wouldn't hurt anyone, but shouldn't happen too
+
+	return true;
+}
+
+/**
+ * Add an explored segment to the signal segment cache
+ *
+ * @param key cache key of the starting point of the search
+ * @param record the recorded search
+ */
+static void StoreSignalSegment(uint64 key, const SignalSegmentCacheItem &record)
+{
+	if (_signal_segment_cache_size + record.Size() > SIGNAL_SEGMENT_CACHE_MAX_SIZE) ClearSignalSegmentCache();
+
+	SignalSegmentCacheItem &item = _signal_segment_cache[key];
+	item = record;
+	for (const SignalSegmentTrainCheck &check : item.train_checks) item.train_check_tiles.push_back(check.tile);
+	std::sort(item.train_check_tiles.begin(), item.train_check_tiles.end());
+	item.train_check_tiles.erase(std::unique(item.train_check_tiles.begin(), item.train_check_tiles.end()), item.train_check_tiles.end());
+
+	for (TileIndex tile : item.train_check_tiles) {
+		auto result = _signal_segment_cache_tiles.emplace(tile, SignalSegmentCacheTile());
+		if (result.second) result.first->second.trains = CountTrainsIndexedOnTile(tile);
+		result.first->second.items.push_back(key);
+		if (result.first->second.trains != 0) item.occupied_tiles++;
+	}
+	_signal_segment_cache_size += item.Size();
+}
+
+/**
+ * Update the train counts of the signal segment cache when a train moved to another tile in the vehicle tile index.
+ * @param old_tile tile the train was indexed on, or INVALID_TILE
+ * @param new_tile tile the train is indexed on now, or INVALID_TILE
+ */
+void NotifySignalSegmentCacheTrainMoved(TileIndex old_tile, TileIndex new_tile)
+{
+	if (_signal_segment_cache_tiles.empty()) return;
+
+	auto update_tile = [](TileIndex tile, int delta) {
+		auto it = _signal_segment_cache_tiles.find(tile);
+		if (it == _signal_segment_cache_tiles.end()) return;
+
+		SignalSegmentCacheTile &cache_tile = it->second;
+		const bool was_occupied = cache_tile.trains != 0;
+		cache_tile.trains += delta;
+		if (was_occupied == (cache_tile.trains != 0)) return;
+
+		for (uint64 key : cache_tile.items) {
+			SignalSegmentCacheItem &item = _signal_segment_cache.find(key)->second;
+			if (was_occupied) {
+				item.occupied_tiles--;
+			} else {
+				item.occupied_tiles++;
+			}
+		}
+	};
+	if (old_tile != INVALID_TILE) update_tile(old_tile, -1);
+	if (new_tile != INVALID_TILE) update_tile(new_tile, 1);
+}
+
 /** Reset all sets after one set overflowed */
 static inline void ResetSets()
 {
@@ -621,63 +905,29 @@ static SigSegState UpdateSignalsInBuffer(Owner owner)
 		assert(_tbuset.IsEmpty());
 		assert(_tbdset.IsEmpty());
 
-		/* After updating signal, data stored are always MP_RAILWAY with signals.
-		 * Other situations happen when data are from outside functions -
-		 * modification of railbits (including both rail building and removal),
-		 * train entering/leaving block, train leaving depot...
-		 */
-		switch (GetTileType(tile)) {
-			case MP_TUNNELBRIDGE: {
-				/* 'optimization assert' - do not try to update signals when it is not needed */
-				assert_tile(GetTunnelBridgeTransportType(tile) == TRANSPORT_RAIL, tile);
-				if (IsTunnel(tile)) assert(dir == INVALID_DIAGDIR || dir == ReverseDiagDir(GetTunnelBridgeDirection(tile)));
-				TrackBits across = GetAcrossTunnelBridgeTrackBits(tile);
-				if (dir == INVALID_DIAGDIR || _enterdir_to_trackbits[dir] & across) {
-					_tbdset.Add(tile, INVALID_DIAGDIR);  // we can safely start from wormhole centre
-					if (!IsTunnelBridgeWithSignalSimulation(tile)) {  // Don't worry with other side of tunnel.
-						_tbdset.Add(GetOtherTunnelBridgeEnd(tile), INVALID_DIAGDIR);
-					}
-					break;
+		SigInfo info;
+		const uint64 cache_key = GetSignalSegmentCacheKey(tile, dir, owner);
+		const auto cached = _signal_segment_cache_suspend_count == 0 ? _signal_segment_cache.find(cache_key) : _signal_segment_cache.end();
+		if (cached != _signal_segment_cache.end()) {
+			if (cached->second.no_segment) continue;
+			info = ReplaySegment(cached->second);
+		} else {
+			static SignalSegmentCacheItem record;
+			record.Clear();
+			const bool use_cache = _signal_segment_cache_suspend_count == 0;
+
+			if (!StartSegmentSearch(tile, dir)) {
+				if (use_cache) {
+					record.no_segment = true;
+					StoreSignalSegment(cache_key, record);
 				}
+				continue; // continue the while() loop
 			}
-				FALLTHROUGH;
-
-			case MP_RAILWAY:
-				if (IsRailDepotTile(tile)) {
-					/* 'optimization assert' do not try to update signals in other cases */
-					assert(dir == INVALID_DIAGDIR || dir == GetRailDepotDirection(tile));
-					_tbdset.Add(tile, INVALID_DIAGDIR); // start from depot inside
-					break;
-				}
-				FALLTHROUGH;
-
-			case MP_STATION:
-			case MP_ROAD:
-				if ((TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_RAIL, 0)) & _enterdir_to_trackbits[dir]) != TRACK_BIT_NONE) {
-					/* only add to set when there is some 'interesting' track */
-					_tbdset.Add(tile, dir);
-					_tbdset.Add(tile + TileOffsByDiagDir(dir), ReverseDiagDir(dir));
-					break;
-				}
-				FALLTHROUGH;
 
-			default:
-				/* jump to next tile */
-				tile = tile + TileOffsByDiagDir(dir);
-				dir = ReverseDiagDir(dir);
-				if ((TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_RAIL, 0)) & _enterdir_to_trackbits[dir]) != TRACK_BIT_NONE) {
-					_tbdset.Add(tile, dir);
-					break;
-				}
-				/* happens when removing a rail that wasn't connected at one or both sides */
-				continue; // continue the while() loop
+			info = ExploreSegment(owner, use_cache ? &record : nullptr);
+			if (use_cache && !(info.flags & SF_FULL)) StoreSignalSegment(cache_key, record);
 		}
 
-		assert(!_tbdset.Overflowed()); // it really shouldn't overflow by these one or two items
-		assert(!_tbdset.IsEmpty()); // it wouldn't hurt anyone, but shouldn't happen too
-
-		SigInfo info = ExploreSegment(owner);
-
 		if (first) {
 			first = false;
 			/* SIGSEG_FREE is set by default */
@@ -819,6 +1069,35 @@ void SetSignalsOnBothDir(TileIndex tile, Track track, Owner owner)
 	UpdateSignalsInBuffer(owner);
 }
 
+/**
+ * Empty the signal segment cache.
+ * Call whenever the track layout may have changed outside of a command, e.g. when loading a game.
+ */
+void ClearSignalSegmentCache()
+{
+	_signal_segment_cache.clear();
+	_signal_segment_cache_tiles.clear();
+	_signal_segment_cache_size = 0;
+}
+
+/**
+ * Stop using the signal segment cache until the matching ResumeSignalSegmentCache call.
+ * Call before changing the track layout, or anything else ExploreSegment depends upon.
+ */
+void SuspendSignalSegmentCache()
+{
+	_signal_segment_cache_suspend_count++;
+	ClearSignalSegmentCache();
+}
+
+/** Use the signal segment cache again after the track layout has been changed, see SuspendSignalSegmentCache. */
+void ResumeSignalSegmentCache()
+{
+	assert(_signal_segment_cache_suspend_count > 0);
+	_signal_segment_cache_suspend_count--;
+	ClearSignalSegmentCache();
+}
+
 void AddSignalDependency(SignalReference on, SignalReference dep)
 {
 	assert(GetTileOwner(on.tile) == GetTileOwner(dep.tile));
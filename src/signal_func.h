@@ -139,4 +139,9 @@ void AddTrackToSignalBuffer(TileIndex tile, Track track, Owner owner);
 void AddSideToSignalBuffer(TileIndex tile, DiagDirection side, Owner owner);
 void UpdateSignalsInBuffer();
 
+void ClearSignalSegmentCache();
+void SuspendSignalSegmentCache();
+void ResumeSignalSegmentCache();
+void NotifySignalSegmentCacheTrainMoved(TileIndex old_tile, TileIndex new_tile);
+
 #endif /* SIGNAL_FUNC_H */
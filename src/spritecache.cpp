@@ -19,6 +19,7 @@
 #include "core/math_func.hpp"
 #include "core/mem_func.hpp"
 #include "scope_info.h"
+#include "worker_thread.h"
 
 #include "table/sprites.h"
 #include "table/strings.h"
@@ -28,13 +29,219 @@
 
 #include <vector>
 #include <algorithm>
+#include <memory>
 
 #include "safeguards.h"
 
 /* Default of 4MB spritecache */
 uint _sprite_cache_size = 4;
 
-static size_t _spritecache_bytes_used = 0;
+/**
+ * Allocator for the data of the cached sprites.
+ * Small allocations are rounded up to a size class, four per power of two, and
+ * carved out of slabs which only hold blocks of that class. This keeps the
+ * sprites from fragmenting the heap as they are loaded and evicted over and over.
+ * Larger allocations are passed on to malloc.
+ */
+class SpriteCacheAllocator {
+	static const uint MIN_CLASS_SHIFT = 6;                     ///< Log2 of the size of the smallest size class.
+	static const uint MIN_CLASS_SIZE = 1 << MIN_CLASS_SHIFT;   ///< Size of the smallest size class.
+	static const uint MAX_CLASS_SIZE = 32 * 1024;              ///< Size of the largest size class.
+	static const uint NUM_CLASSES = 37;                        ///< Number of size classes from #MIN_CLASS_SIZE up to #MAX_CLASS_SIZE.
+	static const uint SLAB_TARGET_SIZE = 64 * 1024;            ///< Preferred size of a slab.
+	static const uint MIN_SLAB_BLOCKS = 8;                     ///< Minimum number of blocks of a slab.
+	static const uint MAX_SLAB_BLOCKS = 256;                   ///< Maximum number of blocks of a slab.
+
+	/** A slab of blocks of one size class. Free blocks start with a pointer to the next free block of the slab. */
+	struct Slab {
+		byte *memory;          ///< Start of the blocks.
+		void *free_head;       ///< First free block.
+		Slab *prev_partial;    ///< Previous slab of the size class with free blocks.
+		Slab *next_partial;    ///< Next slab of the size class with free blocks.
+		uint16 free_blocks;    ///< Number of free blocks.
+		uint16 total_blocks;   ///< Number of blocks.
+		uint8 size_class;      ///< Size class of the blocks.
+	};
+
+	/** The slabs of one size class. */
+	struct SizeClass {
+		Slab *partial = nullptr;  ///< Slabs with free blocks, allocations are taken from the first one.
+		uint slabs = 0;           ///< Number of slabs.
+		uint used_blocks = 0;     ///< Number of blocks in use.
+	};
+
+	SizeClass classes[NUM_CLASSES];
+	btree::btree_map<const byte *, Slab *> slabs;  ///< All slabs, by the start of their blocks.
+	size_t used_bytes = 0;                         ///< Bytes in use, rounded up to the size classes.
+	size_t reserved_bytes = 0;                     ///< Bytes of all slabs and large allocations.
+	uint large_allocations = 0;                    ///< Number of allocations larger than #MAX_CLASS_SIZE.
+
+	static uint GetSizeClass(size_t size)
+	{
+		assert(size <= MAX_CLASS_SIZE);
+		if (size <= MIN_CLASS_SIZE) return 0;
+
+		/* 2^b < size <= 2^(b + 1), which is split into four classes. */
+		const uint b = FindLastBit(size - 1);
+		return (b - MIN_CLASS_SHIFT) * 4 + CeilDiv((uint)size - (1 << b), 1 << (b - 2));
+	}
+
+	static uint GetClassSize(uint size_class)
+	{
+		if (size_class == 0) return MIN_CLASS_SIZE;
+		const uint b = MIN_CLASS_SHIFT + (size_class - 1) / 4;
+		return (1 << b) + ((size_class - 1) % 4 + 1) * (1 << (b - 2));
+	}
+
+	static uint GetSlabBlocks(uint size_class)
+	{
+		return Clamp(SLAB_TARGET_SIZE / GetClassSize(size_class), MIN_SLAB_BLOCKS, MAX_SLAB_BLOCKS);
+	}
+
+	void LinkPartial(Slab *slab)
+	{
+		SizeClass &sc = this->classes[slab->size_class];
+		slab->prev_partial = nullptr;
+		slab->next_partial = sc.partial;
+		if (sc.partial != nullptr) sc.partial->prev_partial = slab;
+		sc.partial = slab;
+	}
+
+	void UnlinkPartial(Slab *slab)
+	{
+		SizeClass &sc = this->classes[slab->size_class];
+		if (slab->prev_partial != nullptr) {
+			slab->prev_partial->next_partial = slab->next_partial;
+		} else {
+			sc.partial = slab->next_partial;
+		}
+		if (slab->next_partial != nullptr) slab->next_partial->prev_partial = slab->prev_partial;
+		slab->prev_partial = nullptr;
+		slab->next_partial = nullptr;
+	}
+
+	Slab *NewSlab(uint size_class)
+	{
+		const uint block_size = GetClassSize(size_class);
+		const uint blocks = GetSlabBlocks(size_class);
+
+		Slab *slab = new Slab();
+		slab->memory = MallocT<byte>(block_size * blocks);
+		slab->free_head = nullptr;
+		slab->free_blocks = blocks;
+		slab->total_blocks = blocks;
+		slab->size_class = size_class;
+		for (uint i = blocks; i-- > 0;) {
+			void *block = slab->memory + i * block_size;
+			*static_cast<void **>(block) = slab->free_head;
+			slab->free_head = block;
+		}
+
+		this->slabs[slab->memory] = slab;
+		this->classes[size_class].slabs++;
+		this->reserved_bytes += block_size * blocks;
+		this->LinkPartial(slab);
+		return slab;
+	}
+
+	void DeleteSlab(Slab *slab)
+	{
+		assert(slab->free_blocks == slab->total_blocks);
+		this->UnlinkPartial(slab);
+		this->slabs.erase(slab->memory);
+		this->classes[slab->size_class].slabs--;
+		this->reserved_bytes -= GetClassSize(slab->size_class) * slab->total_blocks;
+		free(slab->memory);
+		delete slab;
+	}
+
+public:
+	~SpriteCacheAllocator()
+	{
+		for (auto &it : this->slabs) {
+			free(it.second->memory);
+			delete it.second;
+		}
+	}
+
+	/**
+	 * Get the number of bytes an allocation really takes.
+	 * @param size The requested size.
+	 * @return The size rounded up to its size class.
+	 */
+	static size_t GetAllocationSize(size_t size)
+	{
+		return size > MAX_CLASS_SIZE ? size : GetClassSize(GetSizeClass(size));
+	}
+
+	void *Allocate(size_t size)
+	{
+		if (size > MAX_CLASS_SIZE) {
+			this->large_allocations++;
+			this->used_bytes += size;
+			this->reserved_bytes += size;
+			return MallocT<byte>(size);
+		}
+
+		const uint size_class = GetSizeClass(size);
+		SizeClass &sc = this->classes[size_class];
+		Slab *slab = sc.partial != nullptr ? sc.partial : this->NewSlab(size_class);
+
+		void *block = slab->free_head;
+		slab->free_head = *static_cast<void **>(block);
+		slab->free_blocks--;
+		if (slab->free_blocks == 0) this->UnlinkPartial(slab);
+
+		sc.used_blocks++;
+		this->used_bytes += GetClassSize(size_class);
+		return block;
+	}
+
+	void Free(void *ptr, size_t size)
+	{
+		if (size > MAX_CLASS_SIZE) {
+			this->large_allocations--;
+			this->used_bytes -= size;
+			this->reserved_bytes -= size;
+			free(ptr);
+			return;
+		}
+
+		const uint size_class = GetSizeClass(size);
+		auto it = this->slabs.upper_bound(static_cast<const byte *>(ptr));
+		assert(it != this->slabs.begin());
+		Slab *slab = (--it)->second;
+		assert(slab->size_class == size_class);
+
+		*static_cast<void **>(ptr) = slab->free_head;
+		slab->free_head = ptr;
+		if (slab->free_blocks == 0) this->LinkPartial(slab);
+		slab->free_blocks++;
+
+		SizeClass &sc = this->classes[size_class];
+		sc.used_blocks--;
+		this->used_bytes -= GetClassSize(size_class);
+
+		/* Keep the last slab of a class around, to not allocate and free it over and over. */
+		if (slab->free_blocks == slab->total_blocks && sc.slabs > 1) this->DeleteSlab(slab);
+	}
+
+	size_t GetUsedBytes() const { return this->used_bytes; }
+
+	char *DumpStats(char *b, const char *last) const
+	{
+		b += seprintf(b, last, "Allocator: in use: " PRINTF_SIZE " bytes, reserved: " PRINTF_SIZE " bytes, slabs: %u, large allocations: %u\n",
+				this->used_bytes, this->reserved_bytes, (uint)this->slabs.size(), this->large_allocations);
+		for (uint i = 0; i < NUM_CLASSES; i++) {
+			const SizeClass &sc = this->classes[i];
+			if (sc.slabs == 0) continue;
+			b += seprintf(b, last, "  Size %5u: slabs: %3u, blocks in use: %5u of %5u\n", GetClassSize(i), sc.slabs, sc.used_blocks, sc.slabs * GetSlabBlocks(i));
+		}
+		return b;
+	}
+};
+
+static SpriteCacheAllocator _spritecache_allocator;
 
 PACK_N(class SpriteDataBuffer {
 	void *ptr = nullptr;
@@ -46,17 +253,15 @@ public:
 
 	void Allocate(uint32 size)
 	{
-		_spritecache_bytes_used -= this->size;
-		free(this->ptr);
-		this->ptr = MallocT<byte>(size);
+		this->Clear();
+		this->ptr = _spritecache_allocator.Allocate(size);
 		this->size = size;
-		_spritecache_bytes_used += this->size;
 	}
 
 	void Clear()
 	{
-		_spritecache_bytes_used -= this->size;
-		free(this->ptr);
+		if (this->ptr == nullptr) return;
+		_spritecache_allocator.Free(this->ptr, this->size);
 		this->ptr = nullptr;
 		this->size = 0;
 	}
@@ -90,7 +295,8 @@ PACK_N(struct SpriteCache {
 	size_t file_pos;
 	SpriteDataBuffer buffer;
 	uint32 id;
-	uint32 lru;
+	uint32 lru_prev;         ///< Sprite used more recently than this one, if it is in the LRU list.
+	uint32 lru_next;         ///< Sprite used less recently than this one, if it is in the LRU list.
 	uint16 file_slot;
 
 	/**
@@ -103,12 +309,15 @@ PACK_N(struct SpriteCache {
 
 	void *GetPtr() { return this->buffer.GetPtr(); }
 
+	/** Whether the sprite is in the LRU list, that is whether it is cached and may be evicted. */
+	bool IsInLRU() { return this->GetPtr() != nullptr && this->GetType() != ST_RECOLOUR; }
+
 	SpriteType GetType() const { return (SpriteType) GB(this->type_field, 0, 7); }
 	void SetType(SpriteType type) { SB(this->type_field, 0, 7, type); }
 	bool GetWarned() const { return GB(this->type_field, 7, 1); }
 	void SetWarned(bool warned) { SB(this->type_field, 7, 1, warned ? 1 : 0); }
 }, 4);
-assert_compile(sizeof(SpriteCache) <= 32);
+assert_compile(sizeof(SpriteCache) <= 36);
 
 static std::vector<SpriteCache> _spritecache;
 static SpriteDataBuffer _last_sprite_allocation;
@@ -132,9 +341,77 @@ static SpriteCache *AllocateSpriteCache(uint index)
 	return GetSpriteCache(index);
 }
 
-static uint32 _sprite_lru_counter;
+/**
+ * The cached sprites which may be evicted, linked through #SpriteCache::lru_prev and
+ * #SpriteCache::lru_next from the most to the least recently used one.
+ */
+static const uint32 SPRITE_LRU_END = UINT32_MAX;
+static uint32 _sprite_lru_head = SPRITE_LRU_END;  ///< Most recently used sprite.
+static uint32 _sprite_lru_tail = SPRITE_LRU_END;  ///< Least recently used sprite, the first to be evicted.
+static uint _sprite_lru_count = 0;                ///< Number of sprites in the LRU list.
+
+/** Statistics of the sprite cache, for the dump_sprite_cache_stats console command. */
+struct SpriteCacheStats {
+	uint64 hits = 0;           ///< Requested sprites which were cached.
+	uint64 misses = 0;         ///< Requested sprites which had to be loaded.
+	uint64 prefetched = 0;     ///< Sprites loaded by #PrefetchSprites.
+	uint64 evictions = 0;      ///< Sprites evicted to keep the cache within its size.
+	uint64 evicted_bytes = 0;  ///< Bytes freed by the evictions.
+	uint64 trims = 0;          ///< Number of times sprites had to be evicted.
+};
+static SpriteCacheStats _spritecache_stats;
+
+/**
+ * Add a sprite to the front of the LRU list.
+ * @param id The sprite, it must not be in the list.
+ */
+static void LinkSpriteLRU(SpriteID id)
+{
+	SpriteCache *sc = GetSpriteCache(id);
+	sc->lru_prev = SPRITE_LRU_END;
+	sc->lru_next = _sprite_lru_head;
+	if (_sprite_lru_head != SPRITE_LRU_END) {
+		GetSpriteCache(_sprite_lru_head)->lru_prev = id;
+	} else {
+		_sprite_lru_tail = id;
+	}
+	_sprite_lru_head = id;
+	_sprite_lru_count++;
+}
+
+/**
+ * Remove a sprite from the LRU list.
+ * @param id The sprite, it must be in the list.
+ */
+static void UnlinkSpriteLRU(SpriteID id)
+{
+	SpriteCache *sc = GetSpriteCache(id);
+	if (sc->lru_prev != SPRITE_LRU_END) {
+		GetSpriteCache(sc->lru_prev)->lru_next = sc->lru_next;
+	} else {
+		_sprite_lru_head = sc->lru_next;
+	}
+	if (sc->lru_next != SPRITE_LRU_END) {
+		GetSpriteCache(sc->lru_next)->lru_prev = sc->lru_prev;
+	} else {
+		_sprite_lru_tail = sc->lru_prev;
+	}
+	_sprite_lru_count--;
+}
+
+/**
+ * Store the last sprite allocation as the cached data of a sprite.
+ * @param id The sprite, it must not be cached.
+ */
+static void CacheLastSpriteAllocation(SpriteID id)
+{
+	SpriteCache *sc = GetSpriteCache(id);
+	sc->buffer = std::move(_last_sprite_allocation);
+	if (sc->IsInLRU()) LinkSpriteLRU(id);
+}
 
 static void *AllocSprite(size_t mem_req);
+static void DeleteEntryFromSpriteCache(uint item);
 
 /**
  * Skip the given amount of sprite graphics data.
@@ -437,6 +714,28 @@ static void *ReadRecolourSprite(uint16 file_slot, uint num)
 	return dest;
 }
 
+/**
+ * Load the zoom levels of a sprite from its GRF, without touching the sprite cache.
+ * This is safe to do on the worker threads.
+ * @param sc          Location of sprite.
+ * @param sprite_type Type of sprite.
+ * @param[out] sprite The zoom levels.
+ * @return Bit mask of the zoom levels loaded, 0 if the sprite could not be loaded.
+ */
+static uint8 LoadGrfSprite(const SpriteCache *sc, SpriteType sprite_type, SpriteLoader::Sprite *sprite)
+{
+	SpriteLoaderGrf sprite_loader(sc->container_ver);
+	uint8 sprite_avail = 0;
+	if (sprite_type != ST_MAPGEN && BlitterFactory::GetCurrentBlitter()->GetScreenDepth() == 32) {
+		/* Try for 32bpp sprites first. */
+		sprite_avail = sprite_loader.LoadSprite(sprite, sc->file_slot, sc->file_pos, sprite_type, true);
+	}
+	if (sprite_avail == 0) {
+		sprite_avail = sprite_loader.LoadSprite(sprite, sc->file_slot, sc->file_pos, sprite_type, false);
+	}
+	return sprite_avail;
+}
+
 /**
  * Read a sprite from disk.
  * @param sc          Location of sprite.
@@ -459,17 +758,8 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 	DEBUG(sprite, 9, "Load sprite %d", id);
 
 	SpriteLoader::Sprite sprite[ZOOM_LVL_COUNT];
-	uint8 sprite_avail = 0;
 	sprite[ZOOM_LVL_NORMAL].type = sprite_type;
-
-	SpriteLoaderGrf sprite_loader(sc->container_ver);
-	if (sprite_type != ST_MAPGEN && BlitterFactory::GetCurrentBlitter()->GetScreenDepth() == 32) {
-		/* Try for 32bpp sprites first. */
-		sprite_avail = sprite_loader.LoadSprite(sprite, file_slot, file_pos, sprite_type, true);
-	}
-	if (sprite_avail == 0) {
-		sprite_avail = sprite_loader.LoadSprite(sprite, file_slot, file_pos, sprite_type, false);
-	}
+	uint8 sprite_avail = LoadGrfSprite(sc, sprite_type, sprite);
 
 	if (sprite_avail == 0) {
 		if (sprite_type == ST_MAPGEN) return nullptr;
@@ -524,7 +814,7 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 
 
 /** Map from sprite numbers to position in the GRF file. */
-static btree::btree_map<uint32, size_t> _grf_sprite_offsets;
+static GRFSpriteOffsets _grf_sprite_offsets;
 
 /**
  * Get the file offset for a specific sprite in the sprite section of a GRF.
@@ -533,17 +823,21 @@ static btree::btree_map<uint32, size_t> _grf_sprite_offsets;
  */
 size_t GetGRFSpriteOffset(uint32 id)
 {
-	auto iter = _grf_sprite_offsets.find(id);
-	return iter != _grf_sprite_offsets.end() ? iter->second : SIZE_MAX;
+	auto iter = std::lower_bound(_grf_sprite_offsets.begin(), _grf_sprite_offsets.end(), id, [](const std::pair<uint32, size_t> &entry, uint32 value) {
+		return entry.first < value;
+	});
+	return iter != _grf_sprite_offsets.end() && iter->first == id ? iter->second : SIZE_MAX;
 }
 
 /**
- * Parse the sprite section of GRFs.
+ * Parse the sprite section of a GRF.
+ * This only uses the Fio functions of the current thread, so it may be called for several GRFs at once.
  * @param container_version Container version of the GRF we're currently processing.
+ * @param[out] offsets The file offsets of the sprites of the GRF.
  */
-void ReadGRFSpriteOffsets(byte container_version)
+void ReadGRFSpriteOffsets(byte container_version, GRFSpriteOffsets &offsets)
 {
-	_grf_sprite_offsets.clear();
+	offsets.clear();
 
 	if (container_version >= 2) {
 		/* Seek to sprite section of the GRF. */
@@ -555,16 +849,43 @@ void ReadGRFSpriteOffsets(byte container_version)
 		 * offset for each newly encountered ID. */
 		uint32 id, prev_id = 0;
 		while ((id = FioReadDword()) != 0) {
-			if (id != prev_id) _grf_sprite_offsets[id] = FioGetPos() - 4;
+			if (id != prev_id) offsets.emplace_back(id, FioGetPos() - 4);
 			prev_id = id;
 			FioSkipBytes(FioReadDword());
 		}
 
+		/* Sort by ID; of IDs which are in the sprite section more than once the last entry is used. */
+		std::stable_sort(offsets.begin(), offsets.end(), [](const std::pair<uint32, size_t> &a, const std::pair<uint32, size_t> &b) {
+			return a.first < b.first;
+		});
+		auto last = std::unique(offsets.rbegin(), offsets.rend(), [](const std::pair<uint32, size_t> &a, const std::pair<uint32, size_t> &b) {
+			return a.first == b.first;
+		});
+		offsets.erase(offsets.begin(), last.base());
+
 		/* Continue processing the data section. */
 		FioSeekTo(old_pos, SEEK_SET);
 	}
 }
 
+/**
+ * Parse the sprite section of GRFs, and use it for #GetGRFSpriteOffset and #LoadNextSprite.
+ * @param container_version Container version of the GRF we're currently processing.
+ */
+void ReadGRFSpriteOffsets(byte container_version)
+{
+	ReadGRFSpriteOffsets(container_version, _grf_sprite_offsets);
+}
+
+/**
+ * Use the sprite section of a GRF parsed earlier for #GetGRFSpriteOffset and #LoadNextSprite.
+ * @param offsets The file offsets of the sprites of the GRF, as read by #ReadGRFSpriteOffsets.
+ */
+void SetGRFSpriteOffsets(GRFSpriteOffsets &&offsets)
+{
+	_grf_sprite_offsets = std::move(offsets);
+}
+
 
 /**
  * Load a real or recolour sprite.
@@ -626,17 +947,17 @@ bool LoadNextSprite(int load_index, uint file_slot, uint file_sprite_id, byte co
 	}
 
 	SpriteCache *sc = AllocateSpriteCache(load_index);
+	DeleteEntryFromSpriteCache(load_index);
 	sc->file_slot = file_slot;
 	sc->file_pos = file_pos;
-	if (data != nullptr) {
-		assert(data == _last_sprite_allocation.GetPtr());
-		sc->buffer = std::move(_last_sprite_allocation);
-	}
-	sc->lru = 0;
 	sc->id = file_sprite_id;
 	sc->SetType(type);
 	sc->SetWarned(false);
 	sc->container_ver = container_version;
+	if (data != nullptr) {
+		assert(data == _last_sprite_allocation.GetPtr());
+		CacheLastSpriteAllocation(load_index);
+	}
 
 	return true;
 }
@@ -647,6 +968,7 @@ void DupSprite(SpriteID old_spr, SpriteID new_spr)
 	SpriteCache *scnew = AllocateSpriteCache(new_spr); // may reallocate: so put it first
 	SpriteCache *scold = GetSpriteCache(old_spr);
 
+	DeleteEntryFromSpriteCache(new_spr);
 	scnew->file_slot = scold->file_slot;
 	scnew->file_pos = scold->file_pos;
 	scnew->id = scold->id;
@@ -657,7 +979,7 @@ void DupSprite(SpriteID old_spr, SpriteID new_spr)
 
 static size_t GetSpriteCacheUsage()
 {
-	return _spritecache_bytes_used;
+	return _spritecache_allocator.GetUsedBytes();
 }
 
 /**
@@ -666,90 +988,36 @@ static size_t GetSpriteCacheUsage()
  */
 static void DeleteEntryFromSpriteCache(uint item)
 {
-	GetSpriteCache(item)->buffer.Clear();
+	SpriteCache *sc = GetSpriteCache(item);
+	if (sc->IsInLRU()) UnlinkSpriteLRU(item);
+	sc->buffer.Clear();
 }
 
-static void DeleteEntriesFromSpriteCache(size_t target)
-{
-	const size_t initial_in_use = GetSpriteCacheUsage();
-
-	struct SpriteInfo {
-		uint32 lru;
-		SpriteID id;
-		uint32 size;
-
-		bool operator<(const SpriteInfo &other) const
-		{
-			return this->lru < other.lru;
-		}
-	};
-	std::vector<SpriteInfo> candidates;
-	size_t candidate_bytes = 0;
-
-	auto push = [&](SpriteInfo info) {
-		candidates.push_back(info);
-		std::push_heap(candidates.begin(), candidates.end());
-		candidate_bytes += info.size;
-	};
-
-	auto pop = [&]() {
-		candidate_bytes -= candidates.front().size;
-		std::pop_heap(candidates.begin(), candidates.end());
-		candidates.pop_back();
-	};
-
-	SpriteID i = 0;
-	for (; i != _spritecache.size() && candidate_bytes < target; i++) {
-		SpriteCache *sc = GetSpriteCache(i);
-		if (sc->GetType() != ST_RECOLOUR && sc->GetPtr() != nullptr) {
-			push({ sc->lru, i, sc->buffer.GetSize() });
-			if (candidate_bytes >= target) break;
-		}
-	}
-	for (; i != _spritecache.size(); i++) {
-		SpriteCache *sc = GetSpriteCache(i);
-		if (sc->GetType() != ST_RECOLOUR && sc->GetPtr() != nullptr && sc->lru <= candidates.front().lru) {
-			push({ sc->lru, i, sc->buffer.GetSize() });
-			while (!candidates.empty() && candidate_bytes - candidates.front().size >= target) {
-				pop();
-			}
-		}
-	}
-
-	for (auto &it : candidates) {
-		DeleteEntryFromSpriteCache(it.id);
-	}
-
-	DEBUG(sprite, 3, "DeleteEntriesFromSpriteCache, deleted: " PRINTF_SIZE ", freed: " PRINTF_SIZE ", in use: " PRINTF_SIZE " --> " PRINTF_SIZE ", delta: " PRINTF_SIZE ", requested: " PRINTF_SIZE,
-			candidates.size(), candidate_bytes, initial_in_use, GetSpriteCacheUsage(), initial_in_use - GetSpriteCacheUsage(), target);
-}
-
-void IncreaseSpriteLRU()
+/**
+ * Evict the least recently used sprites when the sprite cache has grown beyond its size.
+ * Called once per game loop, so no sprite is evicted while it is being drawn.
+ */
+void TrimSpriteCache()
 {
 	int bpp = BlitterFactory::GetCurrentBlitter()->GetScreenDepth();
-	uint target_size = (bpp > 0 ? _sprite_cache_size * bpp / 8 : 1) * 1024 * 1024;
-	if (_spritecache_bytes_used > target_size) {
-		DeleteEntriesFromSpriteCache(_spritecache_bytes_used - target_size + 512 * 1024);
+	const size_t target_size = (size_t)(bpp > 0 ? _sprite_cache_size * bpp / 8 : 1) * 1024 * 1024;
+	const size_t initial_in_use = GetSpriteCacheUsage();
+	if (initial_in_use <= target_size) return;
+
+	/* Free some more, so this does not have to be done again right away. */
+	const size_t target = target_size - min<size_t>(target_size, 512 * 1024);
+	uint deleted = 0;
+	while (GetSpriteCacheUsage() > target && _sprite_lru_tail != SPRITE_LRU_END) {
+		DeleteEntryFromSpriteCache(_sprite_lru_tail);
+		deleted++;
 	}
 
-	/* Increase all LRU values */
-	if (_sprite_lru_counter >= 0xC0000000) {
-		SpriteID i;
+	_spritecache_stats.trims++;
+	_spritecache_stats.evictions += deleted;
+	_spritecache_stats.evicted_bytes += initial_in_use - GetSpriteCacheUsage();
 
-		DEBUG(sprite, 3, "Fixing lru %u, inuse=" PRINTF_SIZE, _sprite_lru_counter, GetSpriteCacheUsage());
-
-		for (i = 0; i != _spritecache.size(); i++) {
-			SpriteCache *sc = GetSpriteCache(i);
-			if (sc->GetPtr() != nullptr) {
-				if (sc->lru > 0x80000000) {
-					sc->lru -= 0x80000000;
-				} else {
-					sc->lru = 0;
-				}
-			}
-		}
-		_sprite_lru_counter -= 0x80000000;
-	}
+	DEBUG(sprite, 3, "TrimSpriteCache, deleted: %u, in use: " PRINTF_SIZE " --> " PRINTF_SIZE ", target: " PRINTF_SIZE,
+			deleted, initial_in_use, GetSpriteCacheUsage(), target);
 }
 
 static void *AllocSprite(size_t mem_req)
@@ -831,14 +1099,19 @@ void *GetRawSprite(SpriteID sprite, SpriteType type, AllocatorProc *allocator)
 	if (allocator == nullptr) {
 		/* Load sprite into/from spritecache */
 
-		/* Update LRU */
-		sc->lru = ++_sprite_lru_counter;
-
-		/* Load the sprite, if it is not loaded, yet */
 		if (sc->GetPtr() == nullptr) {
+			/* Load the sprite, if it is not loaded, yet */
+			_spritecache_stats.misses++;
 			void *ptr = ReadSprite(sc, sprite, type, AllocSprite);
 			assert(ptr == _last_sprite_allocation.GetPtr());
-			sc->buffer = std::move(_last_sprite_allocation);
+			CacheLastSpriteAllocation(sprite);
+		} else {
+			/* Update LRU */
+			_spritecache_stats.hits++;
+			if (type != ST_RECOLOUR && _sprite_lru_head != sprite) {
+				UnlinkSpriteLRU(sprite);
+				LinkSpriteLRU(sprite);
+			}
 		}
 
 		return sc->GetPtr();
@@ -848,6 +1121,75 @@ void *GetRawSprite(SpriteID sprite, SpriteType type, AllocatorProc *allocator)
 	}
 }
 
+/** A sprite decoded on a worker thread by #PrefetchSprites, waiting to be encoded. */
+struct PrefetchedSprite {
+	bool valid = false;                                                 ///< Whether the sprite was decoded without any problems.
+	SpriteLoader::Sprite sprite[ZOOM_LVL_COUNT];                        ///< The zoom levels of the sprite.
+	std::unique_ptr<SpriteLoader::CommonPixel[]> data[ZOOM_LVL_COUNT];  ///< Copies of the pixels of the zoom levels.
+};
+
+/**
+ * Load normal sprites into the sprite cache in bulk, before they are drawn.
+ * The sprites are read and decoded on the worker threads; only encoding them
+ * for the blitter and storing them in the cache is done on the main thread.
+ * Sprites which are already cached, or which could not be decoded without
+ * any problems, are left to #GetRawSprite.
+ * @param sprites The sprites which are about to be drawn, the list is changed.
+ */
+void PrefetchSprites(std::vector<SpriteID> &sprites)
+{
+	/* Decode the sprites in batches, to limit the memory the decoded pixels take. */
+	static const size_t PREFETCH_BATCH_SIZE = 256;
+	/* Fewer sprites are not worth the hand over to the worker threads. */
+	static const size_t PREFETCH_MIN_SPRITES = 16;
+
+	std::sort(sprites.begin(), sprites.end());
+	sprites.erase(std::unique(sprites.begin(), sprites.end()), sprites.end());
+	sprites.erase(std::remove_if(sprites.begin(), sprites.end(), [](SpriteID sprite) {
+		if (!SpriteExists(sprite)) return true;
+		SpriteCache *sc = GetSpriteCache(sprite);
+		/* Files which are not mapped into memory can only be read on the main thread. */
+		return sc->GetType() != ST_NORMAL || sc->GetPtr() != nullptr || !FioHasFileView(sc->file_slot);
+	}), sprites.end());
+	if (sprites.size() < PREFETCH_MIN_SPRITES) return;
+
+	std::vector<PrefetchedSprite> decoded;
+	for (size_t batch = 0; batch < sprites.size(); batch += PREFETCH_BATCH_SIZE) {
+		const size_t count = min(PREFETCH_BATCH_SIZE, sprites.size() - batch);
+		decoded.clear();
+		decoded.resize(count);
+
+		WorkerParallelFor("ottd:sprite-load", count, 4, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				PrefetchedSprite &ps = decoded[i];
+				const SpriteCache *sc = GetSpriteCache(sprites[batch + i]);
+
+				_sprite_loader_warning_suppressed = false;
+				ps.sprite[ZOOM_LVL_NORMAL].type = ST_NORMAL;
+				uint8 sprite_avail = LoadGrfSprite(sc, ST_NORMAL, ps.sprite);
+				if (sprite_avail == 0 || !ResizeSprites(ps.sprite, sprite_avail, sc->file_slot, sc->id) || _sprite_loader_warning_suppressed) continue;
+
+				/* The loaded pixels are in the buffers of this thread, which are reused for the next sprite. */
+				for (ZoomLevel zoom = ZOOM_LVL_BEGIN; zoom != ZOOM_LVL_END; zoom++) {
+					const size_t size = ps.sprite[zoom].width * ps.sprite[zoom].height;
+					ps.data[zoom].reset(new SpriteLoader::CommonPixel[size]);
+					MemCpyT(ps.data[zoom].get(), ps.sprite[zoom].data, size);
+					ps.sprite[zoom].data = ps.data[zoom].get();
+				}
+				ps.valid = true;
+			}
+		});
+
+		for (size_t i = 0; i < count; i++) {
+			if (!decoded[i].valid) continue;
+			void *ptr = BlitterFactory::GetCurrentBlitter()->Encode(decoded[i].sprite, AllocSprite);
+			assert(ptr == _last_sprite_allocation.GetPtr());
+			CacheLastSpriteAllocation(sprites[batch + i]);
+			_spritecache_stats.prefetched++;
+		}
+	}
+}
+
 /**
  * Reads a sprite and finds its most representative colour.
  * @param sprite Sprite to read.
@@ -949,7 +1291,10 @@ void GfxInitSpriteMem()
 {
 	/* Reset the spritecache 'pool' */
 	_spritecache.clear();
-	assert(_spritecache_bytes_used == 0);
+	_sprite_lru_head = SPRITE_LRU_END;
+	_sprite_lru_tail = SPRITE_LRU_END;
+	_sprite_lru_count = 0;
+	assert(GetSpriteCacheUsage() == 0);
 }
 
 /**
@@ -961,8 +1306,26 @@ void GfxClearSpriteCache()
 	/* Clear sprite ptr for all cached items */
 	for (uint i = 0; i != _spritecache.size(); i++) {
 		SpriteCache *sc = GetSpriteCache(i);
-		if (sc->GetType() != ST_RECOLOUR && sc->GetPtr() != nullptr) DeleteEntryFromSpriteCache(i);
+		if (sc->IsInLRU()) DeleteEntryFromSpriteCache(i);
+	}
+	assert(_sprite_lru_count == 0);
+}
+
+/**
+ * Dump the size, hit rate and evictions of the sprite cache.
+ * @param b Buffer to write to.
+ * @param last Last valid position of the buffer.
+ */
+void DumpSpriteCacheStats(char *b, const char *last)
+{
+	const SpriteCacheStats &stats = _spritecache_stats;
+	b += seprintf(b, last, "Sprite cache: size: %u MB, cached sprites: %u of %u\n", _sprite_cache_size, _sprite_lru_count, (uint)_spritecache.size());
+	b = _spritecache_allocator.DumpStats(b, last);
+	b += seprintf(b, last, "Hits: " OTTD_PRINTF64U ", misses: " OTTD_PRINTF64U ", prefetched: " OTTD_PRINTF64U "\n", stats.hits, stats.misses, stats.prefetched);
+	if (stats.hits + stats.misses > 0) {
+		b += seprintf(b, last, "Hit ratio: %.1f%%\n", (100.0 * stats.hits) / (stats.hits + stats.misses));
 	}
+	b += seprintf(b, last, "Evictions: " OTTD_PRINTF64U ", evicted bytes: " OTTD_PRINTF64U ", trims: " OTTD_PRINTF64U "\n", stats.evictions, stats.evicted_bytes, stats.trims);
 }
 
-/* static */ ReusableBuffer<SpriteLoader::CommonPixel> SpriteLoader::Sprite::buffer[ZOOM_LVL_COUNT];
+/* static */ thread_local ReusableBuffer<SpriteLoader::CommonPixel> SpriteLoader::Sprite::buffer[ZOOM_LVL_COUNT];
@@ -12,6 +12,8 @@
 
 #include "gfx_type.h"
 
+#include <vector>
+
 /** Data structure describing a sprite. */
 struct Sprite {
 	uint16 height; ///< Height of the sprite.
@@ -48,9 +50,13 @@ static inline const byte *GetNonSprite(SpriteID sprite, SpriteType type)
 
 void GfxInitSpriteMem();
 void GfxClearSpriteCache();
-void IncreaseSpriteLRU();
+void TrimSpriteCache();
+
+typedef std::vector<std::pair<uint32, size_t>> GRFSpriteOffsets; ///< File offsets of the sprites in the sprite section of a GRF, sorted by sprite ID.
 
 void ReadGRFSpriteOffsets(byte container_version);
+void ReadGRFSpriteOffsets(byte container_version, GRFSpriteOffsets &offsets);
+void SetGRFSpriteOffsets(GRFSpriteOffsets &&offsets);
 size_t GetGRFSpriteOffset(uint32 id);
 bool LoadNextSprite(int load_index, uint file_index, uint file_sprite_id, byte container_version);
 bool SkipSpriteData(byte type, uint16 num);
@@ -58,4 +64,6 @@ void DupSprite(SpriteID old_spr, SpriteID new_spr);
 
 uint32 GetSpriteMainColour(SpriteID sprite_id, PaletteID palette_id);
 
+void PrefetchSprites(std::vector<SpriteID> &sprites);
+
 #endif /* SPRITECACHE_H */
@@ -20,4 +20,7 @@ public:
 	uint8 LoadSprite(SpriteLoader::Sprite *sprite, uint file_slot, size_t file_pos, SpriteType sprite_type, bool load_32bpp);
 };
 
+/** Set on a worker thread when a message about a sprite it loaded was suppressed. */
+extern thread_local bool _sprite_loader_warning_suppressed;
+
 #endif /* SPRITELOADER_GRF_HPP */
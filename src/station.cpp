@@ -32,12 +32,17 @@
 
 #include "table/strings.h"
 
+#include <map>
+#include <memory>
+
 #include "safeguards.h"
 
 /** The pool of stations. */
 StationPool _station_pool("Station");
 INSTANTIATE_POOL_METHODS(Station)
 
+/** Index of the company owned stations, see #GetCompanyStations. */
+StationOwnerIndex _station_owner_index;
 
 StationKdtree _station_kdtree(Kdtree_StationXYFunc);
 
@@ -50,6 +55,211 @@ void RebuildStationKdtree()
 	_station_kdtree.Build(stids.begin(), stids.end());
 }
 
+/**
+ * Index from each tile to the set of stations whose catchment covers it.
+ * The map is split in blocks, which are only allocated when a catchment
+ * covers any of their tiles. Each tile of a block refers to one of the
+ * distinct sets of stations, which are shared between all tiles with the
+ * same set.
+ */
+struct StationCatchmentIndex {
+	static const uint BLOCK_BITS = 6;                      ///< Log2 of the edge length of a block.
+	static const uint BLOCK_SIZE = 1 << BLOCK_BITS;        ///< Edge length of a block.
+
+	struct Block {
+		uint32 sets[BLOCK_SIZE * BLOCK_SIZE];                ///< Set of each tile in the block, 0 when no station catches it.
+		uint used_tiles;                                     ///< Number of tiles caught by any station.
+	};
+
+	std::vector<std::unique_ptr<Block>> blocks;            ///< Blocks of the map, nullptr when none of their tiles is caught.
+	uint map_size_x = 0;                                   ///< Map size the blocks were allocated for.
+	uint map_size_y = 0;                                   ///< Map size the blocks were allocated for.
+
+	std::vector<std::vector<StationID>> sets;              ///< Sorted station IDs of each set, set 0 is empty.
+	std::vector<uint> set_refs;                            ///< Number of tiles referring to each set.
+	std::vector<uint32> free_sets;                         ///< Unused set IDs.
+	std::map<std::vector<StationID>, uint32> set_ids;      ///< Set ID of each set of stations.
+
+	/* The tiles of a catchment mostly share the same set, remember the last change. */
+	uint32 last_from = 0;
+	uint32 last_to = 0;
+	StationID last_station = INVALID_STATION;
+	bool last_add = false;
+
+	StationCatchmentIndex() : sets(1), set_refs(1) {}
+
+	void Clear()
+	{
+		this->blocks.clear();
+		this->map_size_x = this->map_size_y = 0;
+		this->sets.assign(1, {});
+		this->set_refs.assign(1, 0);
+		this->free_sets.clear();
+		this->set_ids.clear();
+		this->last_station = INVALID_STATION;
+	}
+
+	inline uint BlockIndex(TileIndex tile) const
+	{
+		return (TileY(tile) >> BLOCK_BITS) * (this->map_size_x >> BLOCK_BITS) + (TileX(tile) >> BLOCK_BITS);
+	}
+
+	static inline uint TileInBlock(TileIndex tile)
+	{
+		return (TileY(tile) & (BLOCK_SIZE - 1)) * BLOCK_SIZE + (TileX(tile) & (BLOCK_SIZE - 1));
+	}
+
+	uint32 GetSet(TileIndex tile) const
+	{
+		if (this->blocks.empty()) return 0;
+		const Block *block = this->blocks[this->BlockIndex(tile)].get();
+		return block == nullptr ? 0 : block->sets[TileInBlock(tile)];
+	}
+
+	/**
+	 * Get the set with a station added to or removed from another set.
+	 * @param from The original set.
+	 * @param station The station.
+	 * @param add Whether to add or to remove the station.
+	 * @return The ID of the resulting set, its reference is not counted yet.
+	 */
+	uint32 GetChangedSet(uint32 from, StationID station, bool add)
+	{
+		if (from == this->last_from && station == this->last_station && add == this->last_add) return this->last_to;
+
+		std::vector<StationID> stations = this->sets[from];
+		auto it = std::lower_bound(stations.begin(), stations.end(), station);
+		if (add) {
+			assert(it == stations.end() || *it != station);
+			stations.insert(it, station);
+		} else {
+			assert(it != stations.end() && *it == station);
+			stations.erase(it);
+		}
+
+		uint32 to = 0;
+		if (!stations.empty()) {
+			auto id = this->set_ids.find(stations);
+			if (id != this->set_ids.end()) {
+				to = id->second;
+			} else {
+				if (this->free_sets.empty()) {
+					to = (uint32)this->sets.size();
+					this->sets.emplace_back();
+					this->set_refs.push_back(0);
+				} else {
+					to = this->free_sets.back();
+					this->free_sets.pop_back();
+				}
+				this->set_ids[stations] = to;
+				this->sets[to] = std::move(stations);
+			}
+		}
+
+		this->last_from = from;
+		this->last_to = to;
+		this->last_station = station;
+		this->last_add = add;
+		return to;
+	}
+
+	void ChangeTile(TileIndex tile, StationID station, bool add)
+	{
+		std::unique_ptr<Block> &block = this->blocks[this->BlockIndex(tile)];
+		if (block == nullptr) {
+			assert(add);
+			block.reset(new Block());
+		}
+		uint32 &set = block->sets[TileInBlock(tile)];
+		const uint32 from = set;
+		const uint32 to = this->GetChangedSet(from, station, add);
+		set = to;
+
+		if (to != 0) this->set_refs[to]++;
+		if (from != 0 && --this->set_refs[from] == 0) {
+			this->set_ids.erase(this->sets[from]);
+			this->sets[from].clear();
+			this->free_sets.push_back(from);
+			this->last_station = INVALID_STATION;
+		}
+
+		if (from == 0) block->used_tiles++;
+		if (to == 0 && --block->used_tiles == 0) block.reset();
+	}
+
+	void ChangeStation(const Station *st, bool add)
+	{
+		if (st->catchment_tiles.tile == INVALID_TILE) return;
+		if (this->map_size_x != MapSizeX() || this->map_size_y != MapSizeY()) {
+			assert(add);
+			this->Clear();
+			this->map_size_x = MapSizeX();
+			this->map_size_y = MapSizeY();
+			this->blocks.resize((this->map_size_x >> BLOCK_BITS) * (this->map_size_y >> BLOCK_BITS));
+		}
+
+		BitmapTileIterator it(st->catchment_tiles);
+		for (TileIndex tile = it; tile != INVALID_TILE; tile = ++it) {
+			this->ChangeTile(tile, st->index, add);
+		}
+	}
+};
+
+static StationCatchmentIndex _station_catchment_index;
+
+/**
+ * Get the stations whose catchment covers a tile.
+ * This includes stations which only serve their neutral industry.
+ * @param tile The tile.
+ * @return The IDs of the stations, in ascending order.
+ */
+const std::vector<StationID> &GetStationsCatchingTile(TileIndex tile)
+{
+	return _station_catchment_index.sets[_station_catchment_index.GetSet(tile)];
+}
+
+/**
+ * Check the station catchment index against the catchment tiles of the stations.
+ * @return true if the index is consistent
+ */
+bool ValidateStationCatchmentIndex()
+{
+	const StationCatchmentIndex &index = _station_catchment_index;
+
+	std::map<TileIndex, std::vector<StationID>> expected;
+	for (const Station *st : Station::Iterate()) {
+		if (st->catchment_tiles.tile == INVALID_TILE) continue;
+		BitmapTileIterator it(st->catchment_tiles);
+		for (TileIndex tile = it; tile != INVALID_TILE; tile = ++it) {
+			expected[tile].push_back(st->index);
+		}
+	}
+
+	uint caught_tiles = 0;
+	std::vector<uint> refs(index.sets.size());
+	for (uint b = 0; b < index.blocks.size(); b++) {
+		const StationCatchmentIndex::Block *block = index.blocks[b].get();
+		if (block == nullptr) continue;
+		uint used_tiles = 0;
+		for (uint i = 0; i < lengthof(block->sets); i++) {
+			if (block->sets[i] == 0) continue;
+			used_tiles++;
+			refs[block->sets[i]]++;
+		}
+		if (used_tiles == 0 || used_tiles != block->used_tiles) return false;
+		caught_tiles += used_tiles;
+	}
+	if (caught_tiles != expected.size()) return false;
+
+	for (const auto &it : expected) {
+		if (index.sets[index.GetSet(it.first)] != it.second) return false;
+	}
+	for (uint32 set = 1; set < index.sets.size(); set++) {
+		if (refs[set] != index.set_refs[set]) return false;
+	}
+	return true;
+}
+
 
 BaseStation::~BaseStation()
 {
@@ -77,6 +287,8 @@ Station::Station(TileIndex tile) :
 	time_since_unload(255)
 {
 	/* this->random_bits is set in Station::AddFacility() */
+
+	_station_owner_index.Add(this);
 }
 
 /**
@@ -95,6 +307,8 @@ Station::~Station()
 		return;
 	}
 
+	_station_owner_index.Remove(this);
+
 	while (!this->loading_vehicles.empty()) {
 		this->loading_vehicles.front()->LeaveStation();
 	}
@@ -135,6 +349,7 @@ Station::~Station()
 
 	/* Remove station from industries and towns that reference it. */
 	this->RemoveFromAllNearbyLists();
+	_station_catchment_index.ChangeStation(this, false);
 
 	/* Clear the persistent storage. */
 	delete this->airport.psa;
@@ -168,6 +383,37 @@ Station::~Station()
 }
 
 
+/**
+ * Station pool is about to be cleaned
+ */
+void BaseStation::PreCleanPool()
+{
+	_station_owner_index.Clear();
+	_station_catchment_index.Clear();
+}
+
+/**
+ * Get the bucket of a station in #_station_owner_index.
+ * @param st The station.
+ * @return The bucket, or UINT_MAX if the station is not owned by a company.
+ */
+uint GetStationOwnerIndexBucket(const Station *st)
+{
+	return st->owner < MAX_COMPANIES ? (uint)st->owner : UINT_MAX;
+}
+
+/**
+ * Get all stations of a company.
+ * @param owner The company.
+ * @return The stations, in order of their index.
+ */
+const std::vector<Station *> &GetCompanyStations(Owner owner)
+{
+	static const std::vector<Station *> none;
+	if (owner >= MAX_COMPANIES) return none;
+	return _station_owner_index.Get(owner);
+}
+
 /**
  * Invalidating of the JoinStation window has to be done
  * after removing item from the pool.
@@ -213,6 +459,7 @@ void Station::AddFacility(StationFacility new_facility_bit, TileIndex facil_xy)
 	this->facilities |= new_facility_bit;
 	this->owner = _current_company;
 	this->build_date = _date;
+	_station_owner_index.Update(this);
 }
 
 /**
@@ -425,6 +672,7 @@ void Station::RecomputeCatchment(bool no_clear_nearby_lists)
 {
 	this->industries_near.clear();
 	if (!no_clear_nearby_lists) this->RemoveFromAllNearbyLists();
+	_station_catchment_index.ChangeStation(this, false);
 
 	if (this->rect.IsEmpty()) {
 		this->catchment_tiles.Reset();
@@ -446,6 +694,7 @@ void Station::RecomputeCatchment(bool no_clear_nearby_lists)
 		this->industry->stations_near.clear();
 		this->industry->stations_near.insert(this);
 		this->industries_near.insert(this->industry);
+		_station_catchment_index.ChangeStation(this, true);
 		return;
 	}
 
@@ -463,6 +712,7 @@ void Station::RecomputeCatchment(bool no_clear_nearby_lists)
 		TileArea ta2 = TileArea(tile, 1, 1).Expand(r);
 		TILE_AREA_LOOP(tile2, ta2) this->catchment_tiles.SetTile(tile2);
 	}
+	_station_catchment_index.ChangeStation(this, true);
 
 	/* Search catchment tiles for towns and industries */
 	BitmapTileIterator it(this->catchment_tiles);
@@ -797,6 +797,8 @@ public:
 	IndustryList industries_near; ///< Cached list of industries near the station that can accept cargo, @see DeliverGoodsToIndustry()
 	Industry *industry;           ///< NOSAVE: Associated industry for neutral stations. (Rebuilt on load from Industry->st)
 
+	PoolBucketIndexNode owner_index_node; ///< NOSAVE: Position in #_station_owner_index.
+
 	Station(TileIndex tile = INVALID_TILE);
 	~Station();
 
@@ -847,6 +849,14 @@ public:
 	void GetTileArea(TileArea *ta, StationType type) const override;
 };
 
+uint GetStationOwnerIndexBucket(const Station *st);
+
+/** Index of the company owned stations by owner. */
+typedef PoolBucketIndex<Station, MAX_COMPANIES, &Station::owner_index_node, &GetStationOwnerIndexBucket> StationOwnerIndex;
+extern StationOwnerIndex _station_owner_index;
+
+const std::vector<Station *> &GetCompanyStations(Owner owner);
+
 /** Iterator to iterate over all tiles belonging to an airport. */
 class AirportTileIterator : public OrthogonalTileIterator {
 private:
@@ -20,9 +20,13 @@
 #include "linkgraph/linkgraph_type.h"
 #include "industry_type.h"
 
+#include <vector>
+
 void ModifyStationRatingAround(TileIndex tile, Owner owner, int amount, uint radius);
 
 void FindStationsAroundTiles(const TileArea &location, StationList *stations, bool use_nearby = true, IndustryID industry_filter = INVALID_INDUSTRY);
+const std::vector<StationID> &GetStationsCatchingTile(TileIndex tile);
+bool ValidateStationCatchmentIndex();
 
 void ShowStationViewWindow(StationID station);
 void UpdateAllStationVirtCoords();
@@ -97,7 +97,7 @@ void ClearTraceRestrictMapping() {
 }
 
 /**
- * Flags used for the program execution condition stack
+ * Flags used for the program validation condition stack
  * Each 'if' pushes onto the stack
  * Each 'end if' pops from the stack
  * Elif/orif/else may modify the stack top
@@ -231,42 +231,37 @@ static bool TestStationCondition(StationID station, TraceRestrictItem item)
 
 /**
  * Execute program on train and store results in out
+ * Conditional blocks which contain none of the actions in input.query_actions are skipped without evaluating their conditions
  * @p v may not be nullptr
  * @p out should be zero-initialised
  */
 void TraceRestrictProgram::Execute(const Train* v, const TraceRestrictProgramInput &input, TraceRestrictProgramResult& out) const
 {
-	// static to avoid needing to re-alloc/resize on each execution
-	static std::vector<TraceRestrictCondStackFlags> condstack;
-	condstack.clear();
+	const TraceRestrictProgramActionsUsedFlags query = input.query_actions;
+	if (query != 0 && (this->actions_used_flags & query) == 0) return;
 
 	bool have_previous_signal = false;
 	TileIndex previous_signal_tile = INVALID_TILE;
 
-	size_t size = this->items.size();
-	for (size_t i = 0; i < size; i++) {
-		TraceRestrictItem item = this->items[i];
-		TraceRestrictItemType type = GetTraceRestrictType(item);
-
-		if (IsTraceRestrictConditional(item)) {
-			TraceRestrictCondFlags condflags = GetTraceRestrictCondFlags(item);
-			TraceRestrictCondOp condop = GetTraceRestrictCondOp(item);
+	const size_t size = this->compiled.size();
+	size_t pc = 0;
+	while (pc < size) {
+		const TraceRestrictCompiledInstruction &inst = this->compiled[pc];
+		const TraceRestrictItem item = inst.item;
 
-			if (type == TRIT_COND_ENDIF) {
-				assert(!condstack.empty());
-				if (condflags & TRCF_ELSE) {
-					// else
-					assert(!(condstack.back() & TRCSF_SEEN_ELSE));
-					HandleCondition(condstack, condflags, true);
-					condstack.back() |= TRCSF_SEEN_ELSE;
-				} else {
-					// end if
-					condstack.pop_back();
+		switch (inst.op) {
+			case TRCOP_IF:
+				if (query != 0 && (inst.block_actions & query) == 0) {
+					pc = inst.end;
+					break;
 				}
-			} else {
-				uint16 condvalue = GetTraceRestrictValue(item);
+				FALLTHROUGH;
+
+			case TRCOP_COND: {
+				const TraceRestrictCondOp condop = inst.condop;
+				const uint16 condvalue = inst.value;
 				bool result = false;
-				switch(type) {
+				switch (inst.type) {
 					case TRIT_COND_UNDEFINED:
 						result = false;
 						break;
@@ -341,8 +336,7 @@ void TraceRestrictProgram::Execute(const Train* v, const TraceRestrictProgramInp
 
 					case TRIT_COND_PBS_ENTRY_SIGNAL: {
 						// TRVT_TILE_INDEX value type uses the next slot
-						i++;
-						uint32_t signal_tile = this->items[i];
+						uint32_t signal_tile = inst.extra;
 						if (!have_previous_signal) {
 							if (input.previous_signal_callback) {
 								previous_signal_tile = input.previous_signal_callback(v, input.previous_signal_ptr);
@@ -368,8 +362,7 @@ void TraceRestrictProgram::Execute(const Train* v, const TraceRestrictProgramInp
 
 					case TRIT_COND_SLOT_OCCUPANCY: {
 						// TRIT_COND_SLOT_OCCUPANCY value type uses the next slot
-						i++;
-						uint32_t value = this->items[i];
+						uint32_t value = inst.extra;
 						const TraceRestrictSlot *slot = TraceRestrictSlot::GetIfValid(GetTraceRestrictValue(item));
 						switch (static_cast<TraceRestrictSlotOccupancyCondAuxField>(GetTraceRestrictAuxField(item))) {
 							case TRSOCAF_OCCUPANTS:
@@ -502,11 +495,16 @@ void TraceRestrictProgram::Execute(const Train* v, const TraceRestrictProgramInp
 					default:
 						NOT_REACHED();
 				}
-				HandleCondition(condstack, condflags, result);
+				pc = result ? pc + 1 : inst.target;
+				break;
 			}
-		} else {
-			if (condstack.empty() || condstack.back() & TRCSF_ACTIVE) {
-				switch(type) {
+
+			case TRCOP_JUMP:
+				pc = inst.target;
+				break;
+
+			case TRCOP_ACTION:
+				switch (inst.type) {
 					case TRIT_PF_DENY:
 						if (GetTraceRestrictValue(item)) {
 							out.flags &= ~TRPRF_DENY;
@@ -644,10 +642,13 @@ void TraceRestrictProgram::Execute(const Train* v, const TraceRestrictProgramInp
 					default:
 						NOT_REACHED();
 				}
-			}
+				pc++;
+				break;
+
+			default:
+				NOT_REACHED();
 		}
 	}
-	assert(condstack.empty());
 }
 
 /**
@@ -661,6 +662,91 @@ void TraceRestrictProgram::DecrementRefCount() {
 	}
 }
 
+/**
+ * Add the actions used flags of an action item to actions_used_flags
+ * @return false if the item is not a known action
+ */
+static bool UpdateTraceRestrictActionsUsedFlags(TraceRestrictItem item, TraceRestrictProgramActionsUsedFlags &actions_used_flags)
+{
+	switch (GetTraceRestrictType(item)) {
+		case TRIT_PF_DENY:
+		case TRIT_PF_PENALTY:
+			actions_used_flags |= TRPAUF_PF;
+			break;
+
+		case TRIT_RESERVE_THROUGH:
+			actions_used_flags |= TRPAUF_RESERVE_THROUGH;
+			break;
+
+		case TRIT_LONG_RESERVE:
+			actions_used_flags |= TRPAUF_LONG_RESERVE;
+			break;
+
+		case TRIT_WAIT_AT_PBS:
+			switch (static_cast<TraceRestrictWaitAtPbsValueField>(GetTraceRestrictValue(item))) {
+				case TRWAPVF_WAIT_AT_PBS:
+				case TRWAPVF_CANCEL_WAIT_AT_PBS:
+					actions_used_flags |= TRPAUF_WAIT_AT_PBS;
+					break;
+
+				case TRWAPVF_PBS_RES_END_WAIT:
+				case TRWAPVF_CANCEL_PBS_RES_END_WAIT:
+					actions_used_flags |= TRPAUF_PBS_RES_END_WAIT;
+					break;
+
+				default:
+					NOT_REACHED();
+					break;
+			}
+			break;
+
+		case TRIT_SLOT:
+			switch (static_cast<TraceRestrictSlotCondOpField>(GetTraceRestrictCondOp(item))) {
+				case TRSCOF_ACQUIRE_WAIT:
+					actions_used_flags |= TRPAUF_SLOT_ACQUIRE | TRPAUF_WAIT_AT_PBS;
+					break;
+
+				case TRSCOF_ACQUIRE_TRY:
+					actions_used_flags |= TRPAUF_SLOT_ACQUIRE;
+					break;
+
+				case TRSCOF_RELEASE_BACK:
+					actions_used_flags |= TRPAUF_SLOT_RELEASE_BACK;
+					break;
+
+				case TRSCOF_RELEASE_FRONT:
+					actions_used_flags |= TRPAUF_SLOT_RELEASE_FRONT;
+					break;
+
+				case TRSCOF_PBS_RES_END_ACQ_WAIT:
+					actions_used_flags |= TRPAUF_PBS_RES_END_SLOT | TRPAUF_PBS_RES_END_WAIT;
+					break;
+
+				case TRSCOF_PBS_RES_END_ACQ_TRY:
+				case TRSCOF_PBS_RES_END_RELEASE:
+					actions_used_flags |= TRPAUF_PBS_RES_END_SLOT;
+					break;
+
+				default:
+					NOT_REACHED();
+					break;
+			}
+			break;
+
+		case TRIT_REVERSE:
+			actions_used_flags |= TRPAUF_REVERSE;
+			break;
+
+		case TRIT_SPEED_RESTRICTION:
+			actions_used_flags |= TRPAUF_SPEED_RESTRICTION;
+			break;
+
+		default:
+			return false;
+	}
+	return true;
+}
+
 /**
  * Validate a instruction list
  * Returns successful result if program seems OK
@@ -741,81 +827,8 @@ CommandCost TraceRestrictProgram::Validate(const std::vector<TraceRestrictItem>
 					return_cmd_error(STR_TRACE_RESTRICT_ERROR_VALIDATE_UNKNOWN_INSTRUCTION);
 			}
 		} else {
-			switch (GetTraceRestrictType(item)) {
-				case TRIT_PF_DENY:
-				case TRIT_PF_PENALTY:
-					actions_used_flags |= TRPAUF_PF;
-					break;
-
-				case TRIT_RESERVE_THROUGH:
-					actions_used_flags |= TRPAUF_RESERVE_THROUGH;
-					break;
-
-				case TRIT_LONG_RESERVE:
-					actions_used_flags |= TRPAUF_LONG_RESERVE;
-					break;
-
-				case TRIT_WAIT_AT_PBS:
-					switch (static_cast<TraceRestrictWaitAtPbsValueField>(GetTraceRestrictValue(item))) {
-						case TRWAPVF_WAIT_AT_PBS:
-						case TRWAPVF_CANCEL_WAIT_AT_PBS:
-							actions_used_flags |= TRPAUF_WAIT_AT_PBS;
-							break;
-
-						case TRWAPVF_PBS_RES_END_WAIT:
-						case TRWAPVF_CANCEL_PBS_RES_END_WAIT:
-							actions_used_flags |= TRPAUF_PBS_RES_END_WAIT;
-							break;
-
-						default:
-							NOT_REACHED();
-							break;
-					}
-					break;
-
-				case TRIT_SLOT:
-					switch (static_cast<TraceRestrictSlotCondOpField>(GetTraceRestrictCondOp(item))) {
-						case TRSCOF_ACQUIRE_WAIT:
-							actions_used_flags |= TRPAUF_SLOT_ACQUIRE | TRPAUF_WAIT_AT_PBS;
-							break;
-
-						case TRSCOF_ACQUIRE_TRY:
-							actions_used_flags |= TRPAUF_SLOT_ACQUIRE;
-							break;
-
-						case TRSCOF_RELEASE_BACK:
-							actions_used_flags |= TRPAUF_SLOT_RELEASE_BACK;
-							break;
-
-						case TRSCOF_RELEASE_FRONT:
-							actions_used_flags |= TRPAUF_SLOT_RELEASE_FRONT;
-							break;
-
-						case TRSCOF_PBS_RES_END_ACQ_WAIT:
-							actions_used_flags |= TRPAUF_PBS_RES_END_SLOT | TRPAUF_PBS_RES_END_WAIT;
-							break;
-
-						case TRSCOF_PBS_RES_END_ACQ_TRY:
-						case TRSCOF_PBS_RES_END_RELEASE:
-							actions_used_flags |= TRPAUF_PBS_RES_END_SLOT;
-							break;
-
-						default:
-							NOT_REACHED();
-							break;
-					}
-					break;
-
-				case TRIT_REVERSE:
-					actions_used_flags |= TRPAUF_REVERSE;
-					break;
-
-				case TRIT_SPEED_RESTRICTION:
-					actions_used_flags |= TRPAUF_SPEED_RESTRICTION;
-					break;
-
-				default:
-					return_cmd_error(STR_TRACE_RESTRICT_ERROR_VALIDATE_UNKNOWN_INSTRUCTION);
+			if (!UpdateTraceRestrictActionsUsedFlags(item, actions_used_flags)) {
+				return_cmd_error(STR_TRACE_RESTRICT_ERROR_VALIDATE_UNKNOWN_INSTRUCTION);
 			}
 		}
 	}
@@ -825,6 +838,115 @@ CommandCost TraceRestrictProgram::Validate(const std::vector<TraceRestrictItem>
 	return CommandCost();
 }
 
+/**
+ * Compile the instruction list into the form executed by Execute()
+ * The condition stack is resolved at this point: each condition jumps to the next elif/orif/else/endif when false,
+ * and the end of each branch jumps past the endif.
+ * Each if also records the end of its block and the actions used within it, so that blocks which
+ * cannot affect the result of a query can be skipped.
+ * The instruction list must have been successfully validated.
+ */
+void TraceRestrictProgram::Compile()
+{
+	struct CompileBlock {
+		size_t if_pc;                                       ///< Index of the if instruction
+		size_t pending_false;                               ///< Index of the condition whose false target is not yet known, or SIZE_MAX
+		std::vector<size_t> end_jumps;                      ///< Indices of jumps to the end of the block
+		TraceRestrictProgramActionsUsedFlags actions;       ///< Actions used within the block
+	};
+	std::vector<CompileBlock> blocks;
+
+	this->compiled.clear();
+	this->compiled.reserve(this->items.size());
+
+	auto emit = [&](TraceRestrictCompiledOp op, TraceRestrictItem item) -> TraceRestrictCompiledInstruction & {
+		TraceRestrictCompiledInstruction inst;
+		inst.item = item;
+		inst.extra = 0;
+		inst.target = 0;
+		inst.end = 0;
+		inst.block_actions = static_cast<TraceRestrictProgramActionsUsedFlags>(0);
+		inst.value = GetTraceRestrictValue(item);
+		inst.op = op;
+		inst.type = GetTraceRestrictType(item);
+		inst.condop = GetTraceRestrictCondOp(item);
+		inst.aux = GetTraceRestrictAuxField(item);
+		this->compiled.push_back(inst);
+		return this->compiled.back();
+	};
+	auto jump = [&]() -> size_t {
+		emit(TRCOP_JUMP, 0);
+		return this->compiled.size() - 1;
+	};
+
+	const size_t size = this->items.size();
+	for (size_t i = 0; i < size; i++) {
+		const TraceRestrictItem item = this->items[i];
+		const TraceRestrictItemType type = GetTraceRestrictType(item);
+
+		if (IsTraceRestrictConditional(item)) {
+			const TraceRestrictCondFlags condflags = GetTraceRestrictCondFlags(item);
+
+			if (type == TRIT_COND_ENDIF) {
+				assert(!blocks.empty());
+				CompileBlock &block = blocks.back();
+				if (condflags & TRCF_ELSE) {
+					// else: end the previous branch, the false target of the previous condition is here
+					block.end_jumps.push_back(jump());
+					if (block.pending_false != SIZE_MAX) this->compiled[block.pending_false].target = (uint32)this->compiled.size();
+					block.pending_false = SIZE_MAX;
+				} else {
+					// end if: resolve all pending jumps to here
+					const uint32 end = (uint32)this->compiled.size();
+					if (block.pending_false != SIZE_MAX) this->compiled[block.pending_false].target = end;
+					for (size_t jump_pc : block.end_jumps) {
+						this->compiled[jump_pc].target = end;
+					}
+					this->compiled[block.if_pc].end = end;
+					this->compiled[block.if_pc].block_actions = block.actions;
+					const TraceRestrictProgramActionsUsedFlags actions = block.actions;
+					blocks.pop_back(); // invalidates block
+					if (!blocks.empty()) blocks.back().actions |= actions;
+				}
+			} else if (condflags & TRCF_OR) {
+				// orif: when the previous branch is active, skip over this condition
+				CompileBlock &block = blocks.back();
+				const size_t jump_pc = jump();
+				this->compiled[jump_pc].target = (uint32)this->compiled.size() + 1;
+				if (block.pending_false != SIZE_MAX) this->compiled[block.pending_false].target = (uint32)this->compiled.size();
+				block.pending_false = this->compiled.size();
+				emit(TRCOP_COND, item);
+			} else if (condflags & TRCF_ELSE) {
+				// elif: end the previous branch, the false target of the previous condition is this condition
+				CompileBlock &block = blocks.back();
+				block.end_jumps.push_back(jump());
+				if (block.pending_false != SIZE_MAX) this->compiled[block.pending_false].target = (uint32)this->compiled.size();
+				block.pending_false = this->compiled.size();
+				emit(TRCOP_COND, item);
+			} else {
+				// if
+				CompileBlock block;
+				block.if_pc = this->compiled.size();
+				block.pending_false = block.if_pc;
+				block.actions = static_cast<TraceRestrictProgramActionsUsedFlags>(0);
+				blocks.push_back(std::move(block));
+				emit(TRCOP_IF, item);
+			}
+			if (IsTraceRestrictDoubleItem(item)) {
+				i++;
+				this->compiled.back().extra = this->items[i];
+			}
+		} else {
+			TraceRestrictProgramActionsUsedFlags actions = static_cast<TraceRestrictProgramActionsUsedFlags>(0);
+			UpdateTraceRestrictActionsUsedFlags(item, actions);
+			if (!blocks.empty()) blocks.back().actions |= actions;
+			emit(TRCOP_ACTION, item);
+			if (IsTraceRestrictDoubleItem(item)) i++;
+		}
+	}
+	assert(blocks.empty());
+}
+
 /**
  * Convert an instruction index into an item array index
  */
@@ -1386,6 +1508,7 @@ CommandCost CmdProgramSignalTraceRestrict(TileIndex tile, DoCommandFlag flags, u
 		// move in modified program
 		prog->items.swap(items);
 		prog->actions_used_flags = actions_used_flags;
+		prog->Compile();
 
 		if (prog->items.size() == 0 && prog->refcount == 1) {
 			// program is empty, and this tile is the only reference to it
@@ -1549,6 +1672,7 @@ CommandCost CmdProgramSignalTraceRestrictProgMgmt(TileIndex tile, DoCommandFlag
 void TraceRestrictRemoveDestinationID(TraceRestrictOrderCondAuxField type, uint16 index)
 {
 	for (TraceRestrictProgram *prog : TraceRestrictProgram::Iterate()) {
+		bool changed = false;
 		for (size_t i = 0; i < prog->items.size(); i++) {
 			TraceRestrictItem &item = prog->items[i]; // note this is a reference,
 			if (GetTraceRestrictType(item) == TRIT_COND_CURRENT_ORDER ||
@@ -1556,10 +1680,12 @@ void TraceRestrictRemoveDestinationID(TraceRestrictOrderCondAuxField type, uint1
 					GetTraceRestrictType(item) == TRIT_COND_LAST_STATION) {
 				if (GetTraceRestrictAuxField(item) == type && GetTraceRestrictValue(item) == index) {
 					SetTraceRestrictValueDefault(item, TRVT_ORDER); // this updates the instruction in-place
+					changed = true;
 				}
 			}
 			if (IsTraceRestrictDoubleItem(item)) i++;
 		}
+		if (changed) prog->Compile();
 	}
 
 	// update windows
@@ -1573,13 +1699,16 @@ void TraceRestrictRemoveDestinationID(TraceRestrictOrderCondAuxField type, uint1
 void TraceRestrictRemoveGroupID(GroupID index)
 {
 	for (TraceRestrictProgram *prog : TraceRestrictProgram::Iterate()) {
+		bool changed = false;
 		for (size_t i = 0; i < prog->items.size(); i++) {
 			TraceRestrictItem &item = prog->items[i]; // note this is a reference,
 			if (GetTraceRestrictType(item) == TRIT_COND_TRAIN_GROUP && GetTraceRestrictValue(item) == index) {
 				SetTraceRestrictValueDefault(item, TRVT_GROUP_INDEX); // this updates the instruction in-place
+				changed = true;
 			}
 			if (IsTraceRestrictDoubleItem(item)) i++;
 		}
+		if (changed) prog->Compile();
 	}
 
 	// update windows
@@ -1594,15 +1723,18 @@ void TraceRestrictRemoveGroupID(GroupID index)
 void TraceRestrictUpdateCompanyID(CompanyID old_company, CompanyID new_company)
 {
 	for (TraceRestrictProgram *prog : TraceRestrictProgram::Iterate()) {
+		bool changed = false;
 		for (size_t i = 0; i < prog->items.size(); i++) {
 			TraceRestrictItem &item = prog->items[i]; // note this is a reference,
 			if (GetTraceRestrictType(item) == TRIT_COND_TRAIN_OWNER) {
 				if (GetTraceRestrictValue(item) == old_company) {
 					SetTraceRestrictValue(item, new_company); // this updates the instruction in-place
+					changed = true;
 				}
 			}
 			if (IsTraceRestrictDoubleItem(item)) i++;
 		}
+		if (changed) prog->Compile();
 	}
 
 	for (TraceRestrictSlot *slot : TraceRestrictSlot::Iterate()) {
@@ -1796,16 +1928,20 @@ void TraceRestrictGetVehicleSlots(VehicleID id, std::vector<TraceRestrictSlotID>
 void TraceRestrictRemoveSlotID(TraceRestrictSlotID index)
 {
 	for (TraceRestrictProgram *prog : TraceRestrictProgram::Iterate()) {
+		bool changed = false;
 		for (size_t i = 0; i < prog->items.size(); i++) {
 			TraceRestrictItem &item = prog->items[i]; // note this is a reference,
 			if ((GetTraceRestrictType(item) == TRIT_SLOT || GetTraceRestrictType(item) == TRIT_COND_TRAIN_IN_SLOT) && GetTraceRestrictValue(item) == index) {
 				SetTraceRestrictValueDefault(item, TRVT_SLOT_INDEX); // this updates the instruction in-place
+				changed = true;
 			}
 			if ((GetTraceRestrictType(item) == TRIT_COND_SLOT_OCCUPANCY) && GetTraceRestrictValue(item) == index) {
 				SetTraceRestrictValueDefault(item, TRVT_SLOT_INDEX_INT); // this updates the instruction in-place
+				changed = true;
 			}
 			if (IsTraceRestrictDoubleItem(item)) i++;
 		}
+		if (changed) prog->Compile();
 	}
 
 	bool changed_order = false;
@@ -352,10 +352,11 @@ struct TraceRestrictProgramInput {
 	PreviousSignalProc *previous_signal_callback; ///< Callback to retrieve tile and direction of previous signal, may be nullptr
 	const void *previous_signal_ptr;              ///< Opaque pointer suitable to be passed to previous_signal_callback
 	TraceRestrictProgramInputSlotPermissions permitted_slot_operations; ///< Permitted slot operations
+	TraceRestrictProgramActionsUsedFlags query_actions; ///< Actions whose results are used, conditional blocks without any of these are skipped, 0 means all actions
 
 	TraceRestrictProgramInput(TileIndex tile_, Trackdir trackdir_, PreviousSignalProc *previous_signal_callback_, const void *previous_signal_ptr_)
 			: tile(tile_), trackdir(trackdir_), previous_signal_callback(previous_signal_callback_), previous_signal_ptr(previous_signal_ptr_),
-			permitted_slot_operations(static_cast<TraceRestrictProgramInputSlotPermissions>(0)) { }
+			permitted_slot_operations(static_cast<TraceRestrictProgramInputSlotPermissions>(0)), query_actions(static_cast<TraceRestrictProgramActionsUsedFlags>(0)) { }
 };
 
 /**
@@ -370,12 +371,40 @@ struct TraceRestrictProgramResult {
 			: penalty(0), flags(static_cast<TraceRestrictProgramResultFlags>(0)) { }
 };
 
+/**
+ * Operation of a compiled TraceRestrictProgram instruction
+ */
+enum TraceRestrictCompiledOp : uint8 {
+	TRCOP_IF,                                ///< Start of a conditional block: skip to end if it has no queried actions, otherwise test the condition and jump to target if false
+	TRCOP_COND,                              ///< elif/orif: test the condition and jump to target if false
+	TRCOP_JUMP,                              ///< Jump to target
+	TRCOP_ACTION,                            ///< Execute the action
+};
+
+/**
+ * Instruction of a compiled TraceRestrictProgram, with the fields of the item decoded,
+ * and the conditional structure resolved into jumps
+ */
+struct TraceRestrictCompiledInstruction {
+	TraceRestrictItem item;                  ///< Original item
+	uint32 extra;                            ///< Second item of double-item instructions
+	uint32 target;                           ///< Jump target for TRCOP_IF, TRCOP_COND and TRCOP_JUMP
+	uint32 end;                              ///< End of the block for TRCOP_IF
+	TraceRestrictProgramActionsUsedFlags block_actions; ///< Actions used within the block for TRCOP_IF
+	uint16 value;                            ///< Value field of item
+	TraceRestrictCompiledOp op;              ///< Operation
+	TraceRestrictItemType type;              ///< Type field of item
+	TraceRestrictCondOp condop;              ///< Condition op field of item
+	uint8 aux;                               ///< Aux field of item
+};
+
 /**
  * Program type, this stores the instruction list
  * This is refcounted, see info at top of tracerestrict.cpp
  */
 struct TraceRestrictProgram : TraceRestrictProgramPool::PoolItem<&_tracerestrictprogram_pool> {
 	std::vector<TraceRestrictItem> items;
+	std::vector<TraceRestrictCompiledInstruction> compiled; ///< Compiled form of items, see Compile()
 	uint32 refcount;
 	TraceRestrictProgramActionsUsedFlags actions_used_flags;
 
@@ -393,6 +422,8 @@ struct TraceRestrictProgram : TraceRestrictProgramPool::PoolItem<&_tracerestrict
 
 	static CommandCost Validate(const std::vector<TraceRestrictItem> &items, TraceRestrictProgramActionsUsedFlags &actions_used_flags);
 
+	void Compile();
+
 	static size_t InstructionOffsetToArrayOffset(const std::vector<TraceRestrictItem> &items, size_t offset);
 
 	static size_t ArrayOffsetToInstructionOffset(const std::vector<TraceRestrictItem> &items, size_t offset);
@@ -433,10 +464,12 @@ struct TraceRestrictProgram : TraceRestrictProgramPool::PoolItem<&_tracerestrict
 		return items.begin() + TraceRestrictProgram::InstructionOffsetToArrayOffset(items, instruction_offset);
 	}
 
-	/** Call validation function on current program instruction list and set actions_used_flags */
+	/** Call validation function on current program instruction list and set actions_used_flags, then compile it if it is valid */
 	CommandCost Validate()
 	{
-		return TraceRestrictProgram::Validate(items, actions_used_flags);
+		CommandCost result = TraceRestrictProgram::Validate(items, actions_used_flags);
+		if (result.Succeeded()) this->Compile();
+		return result;
 	}
 };
 
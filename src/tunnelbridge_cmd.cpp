@@ -72,6 +72,24 @@ extern CommandCost IsRoadStopBridgeAboveOK(TileIndex tile, bool drive_through, D
 		TileIndex northern_bridge_end, TileIndex southern_bridge_end, int bridge_height,
 		BridgeType bridge_type, TransportType bridge_transport_type);
 
+/**
+ * Notify YAPF of a track layout change at both ends of a rail tunnel or bridge.
+ * When \a tile is not the end of a rail tunnel or bridge, the ends are not known
+ * and all cached segments are flushed instead.
+ * @param tile One end of the tunnel or bridge.
+ */
+static void YapfNotifyTunnelBridgeTrackLayoutChange(TileIndex tile)
+{
+	if (!IsTileType(tile, MP_TUNNELBRIDGE) || GetTunnelBridgeTransportType(tile) != TRANSPORT_RAIL) {
+		YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+		return;
+	}
+
+	const Track track = DiagDirToDiagTrack(GetTunnelBridgeDirection(tile));
+	YapfNotifyTrackLayoutChange(tile, track);
+	YapfNotifyTrackLayoutChange(GetOtherTunnelBridgeEnd(tile), track);
+}
+
 /**
  * Mark bridge tiles dirty.
  * Note: The bridge does not need to exist, everything is passed via parameters.
@@ -674,9 +692,8 @@ CommandCost CmdBuildBridge(TileIndex end_tile, DoCommandFlag flags, uint32 p1, u
 	}
 
 	if ((flags & DC_EXEC) && transport_type == TRANSPORT_RAIL) {
-		Track track = AxisToTrack(direction);
 		AddSideToSignalBuffer(tile_start, INVALID_DIAGDIR, company);
-		YapfNotifyTrackLayoutChange(tile_start, track);
+		YapfNotifyTunnelBridgeTrackLayoutChange(tile_start);
 	}
 
 	/* Human players that build bridges get a selection to choose from (DC_QUERY_COST)
@@ -1006,7 +1023,7 @@ CommandCost CmdBuildTunnel(TileIndex start_tile, DoCommandFlag flags, uint32 p1,
 			MakeRailTunnel(start_tile, company, t->index, direction,                 railtype);
 			MakeRailTunnel(end_tile,   company, t->index, ReverseDiagDir(direction), railtype);
 			AddSideToSignalBuffer(start_tile, INVALID_DIAGDIR, company);
-			YapfNotifyTrackLayoutChange(start_tile, DiagDirToDiagTrack(direction));
+			YapfNotifyTunnelBridgeTrackLayoutChange(start_tile);
 		} else {
 			if (c != nullptr) c->infrastructure.road[roadtype] += num_pieces * 2; // A full diagonal road has two road bits.
 			NotifyRoadLayoutChangedIfSimpleTunnelBridgeNonLeaf(start_tile, end_tile, direction, GetRoadTramType(roadtype));
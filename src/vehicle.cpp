@@ -59,10 +59,14 @@
 #include "scope_info.h"
 #include "debug_settings.h"
 #include "3rdparty/cpp-btree/btree_set.h"
+#include "pathfinder/yapf/yapf.h"
+#include "signal_func.h"
 
 #include "table/strings.h"
 
 #include <algorithm>
+#include <array>
+#include <chrono>
 
 #include "safeguards.h"
 
@@ -100,6 +104,9 @@ uint16 _returned_mail_refit_capacity; ///< Stores the mail capacity after a refi
 VehiclePool _vehicle_pool("Vehicle");
 INSTANTIATE_POOL_METHODS(Vehicle)
 
+/** Index of the company owned vehicles, see #GetCompanyVehiclesOfType. */
+VehicleOwnerTypeIndex _vehicle_owner_type_index;
+
 static btree::btree_set<VehicleID> _vehicles_to_pay_repair;
 static btree::btree_set<VehicleID> _vehicles_to_sell;
 
@@ -415,6 +422,8 @@ Vehicle::Vehicle(VehicleType type)
 	this->last_loading_station = INVALID_STATION;
 	this->cur_image_valid_dir  = INVALID_DIR;
 	this->vcache.cached_veh_flags = 0;
+
+	_vehicle_owner_type_index.Add(this);
 }
 
 /**
@@ -426,40 +435,75 @@ byte VehicleRandomBits()
 	return GB(Random(), 0, 8);
 }
 
-/* Size of the hash, 6 = 64 x 64, 7 = 128 x 128. Larger sizes will (in theory) reduce hash
- * lookup times at the expense of memory usage. */
-const int HASH_BITS = 7;
-const int HASH_SIZE = 1 << HASH_BITS;
-const int HASH_MASK = HASH_SIZE - 1;
-const int TOTAL_HASH_SIZE = 1 << (HASH_BITS * 2);
-const int TOTAL_HASH_MASK = TOTAL_HASH_SIZE - 1;
+/** Entry of a vehicle in a cell of the vehicle tile index. */
+struct VehicleTileIndexEntry {
+	TileIndex tile; ///< Tile the vehicle was indexed at.
+	VehicleID id;   ///< The vehicle.
+};
 
-/* Resolution of the hash, 0 = 1*1 tile, 1 = 2*2 tiles, 2 = 4*4 tiles, etc.
- * Profiling results show that 0 is fastest. */
-const int HASH_RES = 0;
+/**
+ * Spatial index of the vehicles by their tile, used by the FindVehicleOnPos family of functions.
+ * The map is divided into square cells of a few tiles, each with a contiguous list of the vehicles on it,
+ * so a lookup only visits vehicles close to the requested tile. The cells grow with the map size,
+ * which keeps the memory used by the index bounded on huge maps.
+ */
+struct VehicleTileIndex {
+	static const uint MIN_CELL_BITS = 2;   ///< Cells have an edge length of at least 4 tiles.
+	static const uint MAX_CELLS_LOG = 18;  ///< The cells are made larger when there would be more than this many of them, log2.
+
+	std::vector<std::vector<VehicleTileIndexEntry>> cells; ///< The vehicles of each cell.
+	std::vector<TileIndex> vehicle_tiles;  ///< Tile each vehicle is indexed at, or INVALID_TILE, indexed by vehicle ID.
+	uint cell_bits = 0;                    ///< Edge length of the cells in tiles, log2.
+	uint cells_x_log = 0;                  ///< Number of cells along the x axis, log2.
+	uint map_size_x = 0;                   ///< Map size the cells were made for.
+	uint map_size_y = 0;                   ///< Map size the cells were made for.
+
+	/* Statistics, see DumpVehicleStats. */
+	uint64 lookups = 0;                    ///< Number of lookups.
+	uint64 visited = 0;                    ///< Number of entries visited by lookups.
+
+	/** Make empty cells for the current map size. */
+	void Reset()
+	{
+		this->cell_bits = max<uint>(MIN_CELL_BITS, CeilDiv(max<int>(0, (int)(MapLogX() + MapLogY()) - (int)MAX_CELLS_LOG), 2));
+		this->cells_x_log = MapLogX() - this->cell_bits;
+		this->map_size_x = MapSizeX();
+		this->map_size_y = MapSizeY();
+		this->cells.clear();
+		this->cells.resize((size_t)1 << (MapLogX() + MapLogY() - 2 * this->cell_bits));
+		this->vehicle_tiles.clear();
 
-static Vehicle *_vehicle_tile_hash[TOTAL_HASH_SIZE];
+		/* The signal segment cache counts the trains in the index. */
+		ClearSignalSegmentCache();
+	}
 
-static Vehicle *VehicleFromTileHash(int xl, int yl, int xu, int yu, void *data, VehicleFromPosProc *proc, bool find_first)
-{
-	for (int y = yl; ; y = (y + (1 << HASH_BITS)) & (HASH_MASK << HASH_BITS)) {
-		for (int x = xl; ; x = (x + 1) & HASH_MASK) {
-			Vehicle *v = _vehicle_tile_hash[(x + y) & TOTAL_HASH_MASK];
-			for (; v != nullptr; v = v->hash_tile_next) {
-				Vehicle *a = proc(v, data);
-				if (find_first && a != nullptr) return a;
-			}
-			if (x == xu) break;
-		}
-		if (y == yu) break;
+	/** Make sure the cells fit the current map, they are reset when the map size changed. */
+	inline void CheckMapSize()
+	{
+		if (this->map_size_x != MapSizeX() || this->map_size_y != MapSizeY()) this->Reset();
 	}
 
-	return nullptr;
-}
+	inline std::vector<VehicleTileIndexEntry> &GetCell(uint x, uint y)
+	{
+		return this->cells[((y >> this->cell_bits) << this->cells_x_log) + (x >> this->cell_bits)];
+	}
+
+	inline std::vector<VehicleTileIndexEntry> &GetCell(TileIndex tile)
+	{
+		return this->GetCell(TileX(tile), TileY(tile));
+	}
+
+	inline TileIndex &GetVehicleTile(VehicleID id)
+	{
+		if (id >= this->vehicle_tiles.size()) this->vehicle_tiles.resize(max<size_t>(id + 1, Vehicle::GetPoolSize()), INVALID_TILE);
+		return this->vehicle_tiles[id];
+	}
+};
 
+static VehicleTileIndex _vehicle_tile_index;
 
 /**
- * Helper function for FindVehicleOnPos/HasVehicleOnPos.
+ * Helper function for FindVehicleOnPosXY/HasVehicleOnPosXY.
  * @note Do not call this function directly!
  * @param x    The X location on the map
  * @param y    The Y location on the map
@@ -473,13 +517,30 @@ static Vehicle *VehicleFromPosXY(int x, int y, void *data, VehicleFromPosProc *p
 {
 	const int COLL_DIST = 6;
 
-	/* Hash area to scan is from xl,yl to xu,yu */
-	int xl = GB((x - COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS);
-	int xu = GB((x + COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS);
-	int yl = GB((y - COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS) << HASH_BITS;
-	int yu = GB((y + COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS) << HASH_BITS;
+	_vehicle_tile_index.CheckMapSize();
 
-	return VehicleFromTileHash(xl, yl, xu, yu, data, proc, find_first);
+	/* Tile area to scan is from xl,yl to xu,yu */
+	const uint xl = Clamp((x - COLL_DIST) / (int)TILE_SIZE, 0, (int)MapMaxX());
+	const uint xu = Clamp((x + COLL_DIST) / (int)TILE_SIZE, 0, (int)MapMaxX());
+	const uint yl = Clamp((y - COLL_DIST) / (int)TILE_SIZE, 0, (int)MapMaxY());
+	const uint yu = Clamp((y + COLL_DIST) / (int)TILE_SIZE, 0, (int)MapMaxY());
+	const uint bits = _vehicle_tile_index.cell_bits;
+
+	_vehicle_tile_index.lookups++;
+	for (uint cy = yl >> bits; cy <= yu >> bits; cy++) {
+		for (uint cx = xl >> bits; cx <= xu >> bits; cx++) {
+			const std::vector<VehicleTileIndexEntry> &cell = _vehicle_tile_index.GetCell(cx << bits, cy << bits);
+			_vehicle_tile_index.visited += cell.size();
+			for (const VehicleTileIndexEntry &entry : cell) {
+				if (!IsInsideMM(TileX(entry.tile), xl, xu + 1) || !IsInsideMM(TileY(entry.tile), yl, yu + 1)) continue;
+
+				Vehicle *a = proc(Vehicle::Get(entry.id), data);
+				if (find_first && a != nullptr) return a;
+			}
+		}
+	}
+
+	return nullptr;
 }
 
 /**
@@ -529,11 +590,16 @@ bool HasVehicleOnPosXY(int x, int y, void *data, VehicleFromPosProc *proc)
  */
 static Vehicle *VehicleFromPos(TileIndex tile, void *data, VehicleFromPosProc *proc, bool find_first)
 {
-	int x = GB(TileX(tile), HASH_RES, HASH_BITS);
-	int y = GB(TileY(tile), HASH_RES, HASH_BITS) << HASH_BITS;
+	_vehicle_tile_index.CheckMapSize();
 
-	Vehicle *v = _vehicle_tile_hash[(x + y) & TOTAL_HASH_MASK];
-	for (; v != nullptr; v = v->hash_tile_next) {
+	const std::vector<VehicleTileIndexEntry> &cell = _vehicle_tile_index.GetCell(tile);
+	_vehicle_tile_index.lookups++;
+	_vehicle_tile_index.visited += cell.size();
+	for (const VehicleTileIndexEntry &entry : cell) {
+		if (entry.tile != tile) continue;
+
+		/* The tile of a vehicle may have changed since it was last indexed. */
+		Vehicle *v = Vehicle::Get(entry.id);
 		if (v->tile != tile) continue;
 
 		Vehicle *a = proc(v, data);
@@ -730,46 +796,60 @@ CommandCost EnsureNoTrainOnTrackBits(TileIndex tile, TrackBits track_bits)
 	return CommandCost();
 }
 
+/**
+ * Count the trains indexed on a tile, whether they are actually still on it or not.
+ * When there are none, no FindVehicleOnPos family function finds a train on the tile.
+ * @param tile The tile.
+ * @return The number of trains.
+ */
+uint CountTrainsIndexedOnTile(TileIndex tile)
+{
+	_vehicle_tile_index.CheckMapSize();
+
+	const std::vector<VehicleTileIndexEntry> &cell = _vehicle_tile_index.GetCell(tile);
+	return (uint)std::count_if(cell.begin(), cell.end(), [&](const VehicleTileIndexEntry &entry) {
+		return entry.tile == tile && Vehicle::Get(entry.id)->type == VEH_TRAIN;
+	});
+}
+
 static void UpdateVehicleTileHash(Vehicle *v, bool remove)
 {
-	Vehicle **old_hash = v->hash_tile_current;
-	Vehicle **new_hash;
+	_vehicle_tile_index.CheckMapSize();
 
-	if (remove || HasBit(v->subtype, GVSF_VIRTUAL)) {
-		new_hash = nullptr;
-	} else {
-		int x = GB(TileX(v->tile), HASH_RES, HASH_BITS);
-		int y = GB(TileY(v->tile), HASH_RES, HASH_BITS) << HASH_BITS;
-		new_hash = &_vehicle_tile_hash[(x + y) & TOTAL_HASH_MASK];
-	}
+	TileIndex &old_tile = _vehicle_tile_index.GetVehicleTile(v->index);
+	const TileIndex new_tile = (remove || HasBit(v->subtype, GVSF_VIRTUAL)) ? INVALID_TILE : v->tile;
 
-	if (old_hash == new_hash) return;
+	if (old_tile == new_tile) return;
 
-	/* Remove from the old position in the hash table */
-	if (old_hash != nullptr) {
-		if (v->hash_tile_next != nullptr) v->hash_tile_next->hash_tile_prev = v->hash_tile_prev;
-		*v->hash_tile_prev = v->hash_tile_next;
-	}
+	if (v->type == VEH_TRAIN) NotifySignalSegmentCacheTrainMoved(old_tile, new_tile);
 
-	/* Insert vehicle at beginning of the new position in the hash table */
-	if (new_hash != nullptr) {
-		v->hash_tile_next = *new_hash;
-		if (v->hash_tile_next != nullptr) v->hash_tile_next->hash_tile_prev = &v->hash_tile_next;
-		v->hash_tile_prev = new_hash;
-		*new_hash = v;
+	if (old_tile != INVALID_TILE) {
+		std::vector<VehicleTileIndexEntry> &cell = _vehicle_tile_index.GetCell(old_tile);
+		auto iter = std::find_if(cell.begin(), cell.end(), [&](const VehicleTileIndexEntry &entry) { return entry.id == v->index; });
+		assert(iter != cell.end());
+		if (new_tile != INVALID_TILE && &cell == &_vehicle_tile_index.GetCell(new_tile)) {
+			/* Same cell, only the tile changes. */
+			iter->tile = new_tile;
+			old_tile = new_tile;
+			return;
+		}
+		*iter = cell.back();
+		cell.pop_back();
 	}
 
-	/* Remember current hash position */
-	v->hash_tile_current = new_hash;
+	if (new_tile != INVALID_TILE) _vehicle_tile_index.GetCell(new_tile).push_back({ new_tile, v->index });
+
+	old_tile = new_tile;
 }
 
 bool ValidateVehicleTileHash(const Vehicle *v)
 {
-	if (v->type == VEH_TRAIN && Train::From(v)->IsVirtual()) return v->hash_tile_current == nullptr;
+	const TileIndex tile = v->index < _vehicle_tile_index.vehicle_tiles.size() ? _vehicle_tile_index.vehicle_tiles[v->index] : INVALID_TILE;
+	if (v->type == VEH_TRAIN && Train::From(v)->IsVirtual()) return tile == INVALID_TILE;
+	if (tile != v->tile) return false;
 
-	int x = GB(TileX(v->tile), HASH_RES, HASH_BITS);
-	int y = GB(TileY(v->tile), HASH_RES, HASH_BITS) << HASH_BITS;
-	return v->hash_tile_current == &_vehicle_tile_hash[(x + y) & TOTAL_HASH_MASK];
+	const std::vector<VehicleTileIndexEntry> &cell = _vehicle_tile_index.GetCell(tile);
+	return std::count_if(cell.begin(), cell.end(), [&](const VehicleTileIndexEntry &entry) { return entry.id == v->index && entry.tile == tile; }) == 1;
 }
 
 static Vehicle *_vehicle_viewport_hash[1 << (GEN_HASHX_BITS + GEN_HASHY_BITS)];
@@ -802,9 +882,8 @@ static void UpdateVehicleViewportHash(Vehicle *v, int x, int y)
 
 void ResetVehicleHash()
 {
-	for (Vehicle *v : Vehicle::Iterate()) { v->hash_tile_current = nullptr; }
 	memset(_vehicle_viewport_hash, 0, sizeof(_vehicle_viewport_hash));
-	memset(_vehicle_tile_hash, 0, sizeof(_vehicle_tile_hash));
+	_vehicle_tile_index.Reset();
 }
 
 void ResetVehicleColourMap()
@@ -1036,6 +1115,8 @@ Vehicle::~Vehicle()
 
 	if (this->breakdowns_since_last_service) _vehicles_to_pay_repair.erase(this->index);
 
+	_vehicle_owner_type_index.Remove(this);
+
 	if (this->type >= VEH_COMPANY_END) {
 		/* sometimes, eg. for disaster vehicles, when company bankrupts, when removing crashed/flooded vehicles,
 		 * it may happen that vehicle chain is deleted when visible.
@@ -1060,6 +1141,31 @@ Vehicle::~Vehicle()
 void Vehicle::PreCleanPool()
 {
 	pending_speed_restriction_change_map.clear();
+	_vehicle_owner_type_index.Clear();
+}
+
+/**
+ * Get the bucket of a vehicle in #_vehicle_owner_type_index.
+ * @param v The vehicle.
+ * @return The bucket, or UINT_MAX if the vehicle is not owned by a company.
+ */
+uint GetVehicleOwnerTypeIndexBucket(const Vehicle *v)
+{
+	if (v->type >= VEH_COMPANY_END || v->owner >= MAX_COMPANIES) return UINT_MAX;
+	return v->owner * VEH_COMPANY_END + v->type;
+}
+
+/**
+ * Get all vehicles of a company and vehicle type, including the non-primary parts of vehicles.
+ * @param owner The company.
+ * @param type The vehicle type.
+ * @return The vehicles, in order of their index.
+ */
+const std::vector<Vehicle *> &GetCompanyVehiclesOfType(Owner owner, VehicleType type)
+{
+	static const std::vector<Vehicle *> none;
+	if (owner >= MAX_COMPANIES || type >= VEH_COMPANY_END) return none;
+	return _vehicle_owner_type_index.Get(owner * VEH_COMPANY_END + type);
 }
 
 /**
@@ -1322,6 +1428,7 @@ void CallVehicleTicks()
 			}
 		}
 		_tick_train_too_heavy_cache.clear();
+		YapfPrefetchTrainPaths(_tick_train_front_cache);
 		for (Train *front : _tick_train_front_cache) {
 			v = front;
 			if (!front->Train::Tick()) continue;
@@ -1527,6 +1634,53 @@ void CallVehicleTicks()
 	_vehicles_to_pay_repair.clear();
 }
 
+/**
+ * Benchmark the vehicle tile index lookups and the vehicle ticks, for the benchmark_vehicles console command.
+ * @param b Buffer to write the results to.
+ * @param last Last valid position in the buffer.
+ * @param passes Number of passes over all vehicles, or of ticks to run.
+ * @note This runs the vehicle ticks on the current game, so it advances all vehicles.
+ * @pre The game is paused, so the ticks only run as part of the benchmark.
+ */
+void BenchmarkVehicles(char *b, const char *last, uint passes)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	const size_t vehicles = Vehicle::GetNumItems();
+	auto report = [&](const char *name, Clock::time_point start, const char *unit, size_t count) {
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		b += seprintf(b, last, "%-20s %10.1f ms %10.2f ns/%s\n", name, ms, count == 0 ? 0.0 : ms * 1000000.0 / ((double)count * passes), unit);
+	};
+
+	b += seprintf(b, last, "%u vehicles, %u passes\n", (uint)vehicles, passes);
+
+	auto count_proc = [](Vehicle *v, void *data) -> Vehicle * {
+		(*(uint *)data)++;
+		return nullptr;
+	};
+
+	uint found_tile = 0;
+	Clock::time_point start = Clock::now();
+	for (uint i = 0; i < passes; i++) {
+		for (const Vehicle *v : Vehicle::Iterate()) FindVehicleOnPos(v->tile, &found_tile, count_proc);
+	}
+	report("tile lookup", start, "lookup", vehicles);
+
+	uint found_xy = 0;
+	start = Clock::now();
+	for (uint i = 0; i < passes; i++) {
+		for (const Vehicle *v : Vehicle::Iterate()) FindVehicleOnPosXY(v->x_pos, v->y_pos, &found_xy, count_proc);
+	}
+	report("position lookup", start, "lookup", vehicles);
+
+	assert(_pause_mode != PM_UNPAUSED);
+	start = Clock::now();
+	for (uint i = 0; i < passes; i++) CallVehicleTicks();
+	report("vehicle ticks", start, "vehicle", vehicles);
+
+	/* Use the results, so the lookups are not optimised away. */
+	b += seprintf(b, last, "(%u vehicles per tile lookup, %u per position lookup)\n", vehicles == 0 ? 0 : (uint)(found_tile / passes / vehicles), vehicles == 0 ? 0 : (uint)(found_xy / passes / vehicles));
+}
+
 /**
  * Add vehicle sprite for drawing to the screen.
  * @param v Vehicle to draw.
@@ -2414,10 +2568,9 @@ VehicleEnterTileStatus VehicleEnterTile(Vehicle *v, TileIndex tile, int x, int y
 FreeUnitIDGenerator::FreeUnitIDGenerator(VehicleType type, CompanyID owner) : cache(nullptr), maxid(0), curid(0)
 {
 	/* Find maximum */
-	for (const Vehicle *v : Vehicle::Iterate()) {
-		if (v->type == type && v->owner == owner) {
-			this->maxid = max<UnitID>(this->maxid, v->unitnumber);
-		}
+	const std::vector<Vehicle *> &vehicles = GetCompanyVehiclesOfType(owner, type);
+	for (const Vehicle *v : vehicles) {
+		this->maxid = max<UnitID>(this->maxid, v->unitnumber);
 	}
 
 	if (this->maxid == 0) return;
@@ -2428,10 +2581,8 @@ FreeUnitIDGenerator::FreeUnitIDGenerator(VehicleType type, CompanyID owner) : ca
 	this->cache = CallocT<bool>(this->maxid + 2);
 
 	/* Fill the cache */
-	for (const Vehicle *v : Vehicle::Iterate()) {
-		if (v->type == type && v->owner == owner) {
-			this->cache[v->unitnumber] = true;
-		}
+	for (const Vehicle *v : vehicles) {
+		this->cache[v->unitnumber] = true;
 	}
 }
 
@@ -4045,4 +4196,16 @@ void DumpVehicleStats(char *buffer, const char *last)
 		line(it.second.template_train, "tmpl train");
 		buffer += seprintf(buffer, last, "\n");
 	}
+
+	const VehicleTileIndex &index = _vehicle_tile_index;
+	size_t indexed = 0;
+	size_t longest_cell = 0;
+	for (const std::vector<VehicleTileIndexEntry> &cell : index.cells) {
+		indexed += cell.size();
+		longest_cell = max(longest_cell, cell.size());
+	}
+	buffer += seprintf(buffer, last, "Tile index: %u cells of %u x %u tiles, vehicles: %u, longest cell: %u\n",
+			(uint)index.cells.size(), 1 << index.cell_bits, 1 << index.cell_bits, (uint)indexed, (uint)longest_cell);
+	buffer += seprintf(buffer, last, "Tile index lookups: " OTTD_PRINTF64U ", entries visited: " OTTD_PRINTF64U ", average: %.2f\n",
+			index.lookups, index.visited, index.lookups == 0 ? 0.0 : (double)index.visited / index.lookups);
 }
@@ -276,10 +276,6 @@ public:
 	Vehicle *hash_viewport_next;        ///< NOSAVE: Next vehicle in the visual location hash.
 	Vehicle **hash_viewport_prev;       ///< NOSAVE: Previous vehicle in the visual location hash.
 
-	Vehicle *hash_tile_next;            ///< NOSAVE: Next vehicle in the tile location hash.
-	Vehicle **hash_tile_prev;           ///< NOSAVE: Previous vehicle in the tile location hash.
-	Vehicle **hash_tile_current;        ///< NOSAVE: Cache of the current hash chain.
-
 	byte breakdown_severity;            ///< severity of the breakdown. Note that lower means more severe
 	byte breakdown_type;                ///< Type of breakdown
 	byte breakdown_chance_factor;       ///< Improved breakdowns: current multiplier for breakdown_chance * 128, used for head vehicle only
@@ -303,6 +299,7 @@ public:
 	Direction direction;                ///< facing
 
 	Owner owner;                        ///< Which company owns the vehicle?
+	PoolBucketIndexNode owner_type_index_node; ///< NOSAVE: Position in #_vehicle_owner_type_index.
 	/**
 	 * currently displayed sprite index
 	 * 0xfd == custom sprite, 0xfe == custom second head sprite
@@ -1101,6 +1098,14 @@ public:
 	char *DumpVehicleFlags(char *b, const char *last) const;
 };
 
+uint GetVehicleOwnerTypeIndexBucket(const Vehicle *v);
+
+/** Index of the company owned vehicles by owner and vehicle type. */
+typedef PoolBucketIndex<Vehicle, MAX_COMPANIES * VEH_COMPANY_END, &Vehicle::owner_type_index_node, &GetVehicleOwnerTypeIndexBucket> VehicleOwnerTypeIndex;
+extern VehicleOwnerTypeIndex _vehicle_owner_type_index;
+
+const std::vector<Vehicle *> &GetCompanyVehiclesOfType(Owner owner, VehicleType type);
+
 /**
  * Class defining several overloaded accessors so we don't
  * have to cast vehicle types that often
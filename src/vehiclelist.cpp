@@ -117,8 +117,8 @@ bool GenerateVehicleSortList(VehicleList *list, const VehicleListIdentifier &vli
 	list->clear();
 
 	auto fill_all_vehicles = [&]() {
-		for (const Vehicle *v : Vehicle::Iterate()) {
-			if (!HasBit(v->subtype, GVSF_VIRTUAL) && v->type == vli.vtype && v->owner == vli.company && v->IsPrimaryVehicle()) {
+		for (const Vehicle *v : GetCompanyVehiclesOfType(vli.company, vli.vtype)) {
+			if (!HasBit(v->subtype, GVSF_VIRTUAL) && v->IsPrimaryVehicle()) {
 				list->push_back(v);
 			}
 		}
@@ -154,9 +154,8 @@ bool GenerateVehicleSortList(VehicleList *list, const VehicleListIdentifier &vli
 
 		case VL_GROUP_LIST:
 			if (vli.index != ALL_GROUP) {
-				for (const Vehicle *v : Vehicle::Iterate()) {
-					if (!HasBit(v->subtype, GVSF_VIRTUAL) && v->type == vli.vtype && v->IsPrimaryVehicle() &&
-							v->owner == vli.company && GroupIsInGroup(v->group_id, vli.index)) {
+				for (const Vehicle *v : GetCompanyVehiclesOfType(vli.company, vli.vtype)) {
+					if (!HasBit(v->subtype, GVSF_VIRTUAL) && v->IsPrimaryVehicle() && GroupIsInGroup(v->group_id, vli.index)) {
 						list->push_back(v);
 					}
 				}
@@ -105,6 +105,7 @@
 #include "gui.h"
 #include "core/container_func.hpp"
 #include "tunnelbridge_map.h"
+#include "worker_thread.h"
 
 #include <map>
 #include <vector>
@@ -2644,10 +2645,18 @@ void ViewportMapDraw(const ViewPort * const vp)
 	}
 }
 
-void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom)
+/**
+ * Set up #_vd for drawing an area of a viewport into #_cur_dpi.
+ * @param vp The viewport.
+ * @param left Left edge of the area, in viewport coordinates.
+ * @param top Top edge of the area, in viewport coordinates.
+ * @param right Right edge of the area, in viewport coordinates.
+ * @param bottom Bottom edge of the area, in viewport coordinates.
+ * @return The position of the area relative to #_cur_dpi.
+ */
+static Point ViewportDoDrawSetup(const ViewPort *vp, int left, int top, int right, int bottom)
 {
-	DrawPixelInfo *old_dpi = _cur_dpi;
-	_cur_dpi = &_vd.dpi;
+	const DrawPixelInfo *old_dpi = _cur_dpi;
 
 	_vd.dpi.zoom = vp->zoom;
 	int mask = ScaleByZoom(-1, vp->zoom);
@@ -2673,39 +2682,61 @@ void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom
 	_dpi_for_text.height = UnScaleByZoom(_dpi_for_text.height, _dpi_for_text.zoom);
 	_dpi_for_text.zoom   = ZOOM_LVL_NORMAL;
 
-	if (vp->zoom >= ZOOM_LVL_DRAW_MAP) {
-		/* Here the rendering is like smallmap. */
-		if (BlitterFactory::GetCurrentBlitter()->GetScreenDepth() == 32) {
-			if (_settings_client.gui.show_slopes_on_viewport_map) ViewportMapDraw<true, true>(vp);
-			else ViewportMapDraw<true, false>(vp);
-		} else {
-			_pal2trsp_remap_ptr = IsTransparencySet(TO_TREES) ? GetNonSprite(GB(PALETTE_TO_TRANSPARENT, 0, PALETTE_WIDTH), ST_RECOLOUR) + 1 : nullptr;
-			if (_settings_client.gui.show_slopes_on_viewport_map) ViewportMapDraw<false, true>(vp);
-			else ViewportMapDraw<false, false>(vp);
-		}
-		ViewportMapDrawVehicles(&_vd.dpi);
-		if (_scrolling_viewport && _settings_client.gui.show_scrolling_viewport_on_map) ViewportMapDrawScrollingViewportBox(vp);
-		if (vp->zoom < ZOOM_LVL_OUT_256X) ViewportAddKdtreeSigns(&_vd.dpi, true);
-	} else {
-		/* Classic rendering. */
-		ViewportAddLandscape();
-		ViewportAddVehicles(&_vd.dpi);
+	return { x, y };
+}
 
-		ViewportAddKdtreeSigns(&_vd.dpi, false);
+/** Collect the sprites of the area set up in #_vd, when not drawing in map mode. */
+static void ViewportCollectSprites()
+{
+	ViewportAddLandscape();
+	ViewportAddVehicles(&_vd.dpi);
 
-		DrawTextEffects(&_vd.dpi);
+	ViewportAddKdtreeSigns(&_vd.dpi, false);
 
-		if (_vd.tile_sprites_to_draw.size() != 0) ViewportDrawTileSprites(&_vd.tile_sprites_to_draw);
+	DrawTextEffects(&_vd.dpi);
 
-		for (auto &psd : _vd.parent_sprites_to_draw) {
-			_vd.parent_sprites_to_sort.push_back(&psd);
-		}
+	for (auto &psd : _vd.parent_sprites_to_draw) {
+		_vd.parent_sprites_to_sort.push_back(&psd);
+	}
+}
 
-		_vp_sprite_sorter(&_vd.parent_sprites_to_sort);
-		ViewportDrawParentSprites(&_vd.parent_sprites_to_sort, &_vd.child_screen_sprites_to_draw);
+/**
+ * Add the sprites collected in #_vd, which are not loaded yet by collecting them, to a list for #PrefetchSprites.
+ * @param sprites The list to add to.
+ */
+static void ViewportGetSpritesToPrefetch(std::vector<SpriteID> &sprites)
+{
+	for (const TileSpriteToDraw &ts : _vd.tile_sprites_to_draw) sprites.push_back(ts.image & SPRITE_MASK);
+	for (const ChildScreenSpriteToDraw &cs : _vd.child_screen_sprites_to_draw) sprites.push_back(cs.image & SPRITE_MASK);
+}
 
-		if (_draw_bounding_boxes) ViewportDrawBoundingBoxes(&_vd.parent_sprites_to_sort);
-	}
+/**
+ * Whether to decode the sprites of a viewport redraw on the worker threads before drawing them.
+ * @return True if the sprites should be prefetched.
+ */
+static inline bool ViewportShouldPrefetchSprites()
+{
+	return _settings_client.gui.parallel_sprite_prefetch && _worker_pool.GetMaxWorkers() > 0;
+}
+
+/** Draw the collected and sorted sprites of #_vd, when not drawing in map mode. */
+static void ViewportDrawSortedSprites()
+{
+	if (_vd.tile_sprites_to_draw.size() != 0) ViewportDrawTileSprites(&_vd.tile_sprites_to_draw);
+
+	ViewportDrawParentSprites(&_vd.parent_sprites_to_sort, &_vd.child_screen_sprites_to_draw);
+
+	if (_draw_bounding_boxes) ViewportDrawBoundingBoxes(&_vd.parent_sprites_to_sort);
+}
+
+/**
+ * Draw the overlays of the area set up in #_vd, and clear #_vd for the next area.
+ * @param vp The viewport.
+ * @param x The position of the area relative to the original #_cur_dpi.
+ * @param y The position of the area relative to the original #_cur_dpi.
+ */
+static void ViewportDoDrawFinish(const ViewPort *vp, int x, int y)
+{
 	if (_draw_dirty_blocks) ViewportDrawDirtyBlocks();
 
 	DrawPixelInfo dp = _vd.dpi;
@@ -2732,8 +2763,6 @@ void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom
 	if (_settings_client.gui.show_vehicle_route_steps) ViewportDrawVehicleRouteSteps(vp);
 	ViewportDrawPlans(vp);
 
-	_cur_dpi = old_dpi;
-
 	_vd.bridge_to_map.clear();
 	_vd.string_sprites_to_draw.clear();
 	_vd.tile_sprites_to_draw.clear();
@@ -2742,29 +2771,135 @@ void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom
 	_vd.child_screen_sprites_to_draw.clear();
 }
 
+void ViewportDoDraw(const ViewPort *vp, int left, int top, int right, int bottom)
+{
+	DrawPixelInfo *old_dpi = _cur_dpi;
+	Point pt = ViewportDoDrawSetup(vp, left, top, right, bottom);
+	_cur_dpi = &_vd.dpi;
+
+	if (vp->zoom >= ZOOM_LVL_DRAW_MAP) {
+		/* Here the rendering is like smallmap. */
+		if (BlitterFactory::GetCurrentBlitter()->GetScreenDepth() == 32) {
+			if (_settings_client.gui.show_slopes_on_viewport_map) ViewportMapDraw<true, true>(vp);
+			else ViewportMapDraw<true, false>(vp);
+		} else {
+			_pal2trsp_remap_ptr = IsTransparencySet(TO_TREES) ? GetNonSprite(GB(PALETTE_TO_TRANSPARENT, 0, PALETTE_WIDTH), ST_RECOLOUR) + 1 : nullptr;
+			if (_settings_client.gui.show_slopes_on_viewport_map) ViewportMapDraw<false, true>(vp);
+			else ViewportMapDraw<false, false>(vp);
+		}
+		ViewportMapDrawVehicles(&_vd.dpi);
+		if (_scrolling_viewport && _settings_client.gui.show_scrolling_viewport_on_map) ViewportMapDrawScrollingViewportBox(vp);
+		if (vp->zoom < ZOOM_LVL_OUT_256X) ViewportAddKdtreeSigns(&_vd.dpi, true);
+	} else {
+		/* Classic rendering. */
+		ViewportCollectSprites();
+		if (ViewportShouldPrefetchSprites()) {
+			std::vector<SpriteID> sprites;
+			ViewportGetSpritesToPrefetch(sprites);
+			PrefetchSprites(sprites);
+		}
+		_vp_sprite_sorter(&_vd.parent_sprites_to_sort);
+		ViewportDrawSortedSprites();
+	}
+
+	ViewportDoDrawFinish(vp, pt.x, pt.y);
+
+	_cur_dpi = old_dpi;
+}
+
+/** The sprites of one area of a viewport redraw, while the areas are sorted on the worker threads. */
+struct ViewportDrawArea {
+	DrawPixelInfo dpi;                                          ///< See ViewportDrawer::dpi.
+	DrawPixelInfo dpi_for_text;                                 ///< See #_dpi_for_text.
+	Point pt;                                                   ///< Position of the area relative to #_cur_dpi.
+	StringSpriteToDrawVector string_sprites_to_draw;            ///< See ViewportDrawer.
+	TileSpriteToDrawVector tile_sprites_to_draw;                ///< See ViewportDrawer.
+	ParentSpriteToDrawVector parent_sprites_to_draw;            ///< See ViewportDrawer.
+	ParentSpriteToSortVector parent_sprites_to_sort;            ///< See ViewportDrawer.
+	ChildScreenSpriteToDrawVector child_screen_sprites_to_draw; ///< See ViewportDrawer.
+
+	/** Exchange the sprites of this area with those in #_vd. */
+	void Swap()
+	{
+		std::swap(this->dpi, _vd.dpi);
+		std::swap(this->dpi_for_text, _dpi_for_text);
+		this->string_sprites_to_draw.swap(_vd.string_sprites_to_draw);
+		this->tile_sprites_to_draw.swap(_vd.tile_sprites_to_draw);
+		this->parent_sprites_to_draw.swap(_vd.parent_sprites_to_draw);
+		this->parent_sprites_to_sort.swap(_vd.parent_sprites_to_sort);
+		this->child_screen_sprites_to_draw.swap(_vd.child_screen_sprites_to_draw);
+	}
+};
+
+/**
+ * Draw several areas of a viewport, like #ViewportDoDraw, but sort the sprites of the areas on the worker threads.
+ * The sprites are collected and drawn on the main thread, as the tile and sprite code is not thread safe.
+ * The areas do not overlap, so the result is the same as drawing them one after another.
+ * @param vp The viewport, which is not in map mode.
+ * @param areas The areas, in viewport coordinates.
+ */
+static void ViewportDoDrawParallel(const ViewPort *vp, const std::vector<Rect> &areas)
+{
+	DrawPixelInfo *old_dpi = _cur_dpi;
+	std::vector<ViewportDrawArea> draw_areas(areas.size());
+	const bool prefetch = ViewportShouldPrefetchSprites();
+	std::vector<SpriteID> sprites;
+
+	for (size_t i = 0; i < areas.size(); i++) {
+		ViewportDrawArea &area = draw_areas[i];
+		area.pt = ViewportDoDrawSetup(vp, areas[i].left, areas[i].top, areas[i].right, areas[i].bottom);
+		_cur_dpi = &_vd.dpi;
+		ViewportCollectSprites();
+		if (prefetch) ViewportGetSpritesToPrefetch(sprites);
+		_cur_dpi = old_dpi;
+		area.Swap();
+	}
+
+	if (prefetch) PrefetchSprites(sprites);
+
+	WorkerParallelFor("ottd:vp-sort", draw_areas.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			_vp_sprite_sorter(&draw_areas[i].parent_sprites_to_sort);
+		}
+	});
+
+	for (ViewportDrawArea &area : draw_areas) {
+		area.Swap();
+		_cur_dpi = &_vd.dpi;
+		ViewportDrawSortedSprites();
+		ViewportDoDrawFinish(vp, area.pt.x, area.pt.y);
+		_cur_dpi = old_dpi;
+	}
+}
+
 /**
  * Make sure we don't draw a too big area at a time.
  * If we do, the sprite sorter will run into major performance problems and the sprite memory may overflow.
+ * @param areas If not nullptr, the areas to draw are added to this instead of being drawn.
  */
-static void ViewportDrawChk(const ViewPort *vp, int left, int top, int right, int bottom)
+static void ViewportDrawChk(const ViewPort *vp, int left, int top, int right, int bottom, std::vector<Rect> *areas)
 {
 	if ((vp->zoom < ZOOM_LVL_DRAW_MAP) && (ScaleByZoom(bottom - top, vp->zoom) * ScaleByZoom(right - left, vp->zoom) > (int)(180000 * ZOOM_LVL_BASE * ZOOM_LVL_BASE))) {
 		if ((bottom - top) > (right - left)) {
 			int t = (top + bottom) >> 1;
-			ViewportDrawChk(vp, left, top, right, t);
-			ViewportDrawChk(vp, left, t, right, bottom);
+			ViewportDrawChk(vp, left, top, right, t, areas);
+			ViewportDrawChk(vp, left, t, right, bottom, areas);
 		} else {
 			int t = (left + right) >> 1;
-			ViewportDrawChk(vp, left, top, t, bottom);
-			ViewportDrawChk(vp, t, top, right, bottom);
+			ViewportDrawChk(vp, left, top, t, bottom, areas);
+			ViewportDrawChk(vp, t, top, right, bottom, areas);
 		}
 	} else {
-		ViewportDoDraw(vp,
-			ScaleByZoom(left - vp->left, vp->zoom) + vp->virtual_left,
-			ScaleByZoom(top - vp->top, vp->zoom) + vp->virtual_top,
-			ScaleByZoom(right - vp->left, vp->zoom) + vp->virtual_left,
-			ScaleByZoom(bottom - vp->top, vp->zoom) + vp->virtual_top
-		);
+		Rect area;
+		area.left = ScaleByZoom(left - vp->left, vp->zoom) + vp->virtual_left;
+		area.top = ScaleByZoom(top - vp->top, vp->zoom) + vp->virtual_top;
+		area.right = ScaleByZoom(right - vp->left, vp->zoom) + vp->virtual_left;
+		area.bottom = ScaleByZoom(bottom - vp->top, vp->zoom) + vp->virtual_top;
+		if (areas != nullptr) {
+			areas->push_back(area);
+		} else {
+			ViewportDoDraw(vp, area.left, area.top, area.right, area.bottom);
+		}
 	}
 }
 
@@ -2782,7 +2917,18 @@ static inline void ViewportDraw(const ViewPort *vp, int left, int top, int right
 	if (top < vp->top) top = vp->top;
 	if (bottom > vp->top + vp->height) bottom = vp->top + vp->height;
 
-	ViewportDrawChk(vp, left, top, right, bottom);
+	if (vp->zoom < ZOOM_LVL_DRAW_MAP && _settings_client.gui.parallel_viewport_sort && _worker_pool.GetMaxWorkers() > 0) {
+		std::vector<Rect> areas;
+		ViewportDrawChk(vp, left, top, right, bottom, &areas);
+		if (areas.size() > 1) {
+			ViewportDoDrawParallel(vp, areas);
+		} else {
+			for (const Rect &area : areas) ViewportDoDraw(vp, area.left, area.top, area.right, area.bottom);
+		}
+		return;
+	}
+
+	ViewportDrawChk(vp, left, top, right, bottom, nullptr);
 }
 
 /**
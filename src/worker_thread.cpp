@@ -0,0 +1,287 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file worker_thread.cpp Persistent pool of worker threads for background tasks. */
+
+#include "stdafx.h"
+#include "worker_thread.h"
+#include "settings_type.h"
+
+#include "safeguards.h"
+
+WorkerThreadPool _worker_pool; ///< The worker thread pool.
+
+thread_local WorkerThreadPool::Worker *WorkerThreadPool::current_worker = nullptr;
+
+/**
+ * Claim a queued task for running.
+ * @return True if the task was still queued and is now claimed by the caller.
+ */
+bool WorkerTask::Claim()
+{
+	State expected = WTS_QUEUED;
+	if (!this->state.compare_exchange_strong(expected, WTS_RUNNING)) return false;
+	_worker_pool.queued--;
+	return true;
+}
+
+/**
+ * Run a claimed task and mark it as done. The pool lock must not be held.
+ */
+void WorkerTask::Run()
+{
+	this->proc();
+	this->proc = nullptr;
+
+	std::lock_guard<std::mutex> lk(_worker_pool.lock);
+	this->state = WTS_DONE;
+	this->done_cv.notify_all();
+}
+
+/**
+ * Wait for the task to complete.
+ * If no worker has started the task yet it is run right away by the calling thread instead.
+ */
+void WorkerTask::Wait()
+{
+	if (this->Claim()) {
+		this->Run();
+		return;
+	}
+	std::unique_lock<std::mutex> lk(_worker_pool.lock);
+	this->done_cv.wait(lk, [this]() { return this->state == WTS_DONE; });
+}
+
+/**
+ * Check whether the task has completed.
+ * @return True if the task is done.
+ */
+bool WorkerTask::IsDone() const
+{
+	return this->state == WTS_DONE;
+}
+
+/**
+ * Take the newest task from a worker's own deque. Tasks which were already claimed are dropped.
+ * The pool lock must not be held.
+ * @param worker Worker to take the task from.
+ * @return The claimed task or nullptr if there is none.
+ */
+WorkerTaskPtr WorkerThreadPool::PopLocalTask(Worker *worker)
+{
+	std::lock_guard<std::mutex> lk(worker->lock);
+	while (!worker->tasks.empty()) {
+		WorkerTaskPtr task = std::move(worker->tasks.back());
+		worker->tasks.pop_back();
+		if (task->Claim()) return task;
+	}
+	return nullptr;
+}
+
+/**
+ * Take the highest priority task from the shared queues, or steal the oldest
+ * task of another worker. Tasks which were already claimed by a waiting thread
+ * are dropped. The pool lock must be held.
+ * @param worker Worker looking for a task.
+ * @return The claimed task or nullptr if there is none.
+ */
+WorkerTaskPtr WorkerThreadPool::PopTask(Worker *worker)
+{
+	for (uint priority = 0; priority < WTP_END; priority++) {
+		if (priority == WTP_BACKGROUND) {
+			for (Worker *victim : this->worker_list) {
+				if (victim == worker) continue;
+				std::lock_guard<std::mutex> lk(victim->lock);
+				while (!victim->tasks.empty()) {
+					WorkerTaskPtr task = std::move(victim->tasks.front());
+					victim->tasks.pop_front();
+					if (task->Claim()) return task;
+				}
+			}
+		}
+
+		std::deque<WorkerTaskPtr> &queue = this->queues[priority];
+		while (!queue.empty()) {
+			WorkerTaskPtr task = std::move(queue.front());
+			queue.pop_front();
+			if (task->Claim()) return task;
+		}
+	}
+	return nullptr;
+}
+
+/**
+ * Start another worker thread. The pool lock must be held.
+ * @return True if the thread was started.
+ */
+bool WorkerThreadPool::SpawnWorker()
+{
+	this->workers++;
+	if (!StartNewThread(nullptr, "ottd:worker", [this]() { this->WorkerMain(); })) {
+		this->workers--;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Run a claimed task on a worker thread.
+ * @param task Task to run.
+ * @param lk Lock of the pool, locked on entry and on return.
+ */
+void WorkerThreadPool::RunTask(WorkerTaskPtr &task, std::unique_lock<std::mutex> &lk)
+{
+	bool background = task->priority == WTP_BACKGROUND;
+	if (background) this->background_workers++;
+	lk.unlock();
+
+	SetCurrentThreadName(task->name);
+	try {
+		task->Run();
+	} catch (OTTDThreadExitSignal&) {
+		lk.lock();
+		task->state = WorkerTask::WTS_DONE;
+		task->done_cv.notify_all();
+		lk.unlock();
+	}
+	SetCurrentThreadName("ottd:worker");
+
+	lk.lock();
+	if (background) this->background_workers--;
+}
+
+/**
+ * Main loop of a worker thread. Keeps running tasks until the pool is stopped,
+ * or it is surplus to the current limit and there is nothing left to do.
+ */
+void WorkerThreadPool::WorkerMain()
+{
+	Worker worker;
+	current_worker = &worker;
+
+	std::unique_lock<std::mutex> lk(this->lock);
+	this->worker_list.push_back(&worker);
+	for (;;) {
+		lk.unlock();
+		WorkerTaskPtr task = this->PopLocalTask(&worker);
+		lk.lock();
+		if (task == nullptr) task = this->PopTask(&worker);
+		if (task != nullptr) {
+			this->RunTask(task, lk);
+			continue;
+		}
+
+		if (this->stopped || this->workers > this->max_workers) break;
+
+		this->idle_workers++;
+		this->work_cv.wait(lk);
+		this->idle_workers--;
+	}
+
+	/* Only this worker adds to its own deque, so it is empty now. */
+	this->worker_list.erase(std::find(this->worker_list.begin(), this->worker_list.end(), &worker));
+	current_worker = nullptr;
+	this->workers--;
+	this->exit_cv.notify_all();
+}
+
+/**
+ * Change the maximum number of workers for non-urgent tasks.
+ * Surplus workers exit once they have finished their current task.
+ * @param count New maximum number of workers.
+ */
+void WorkerThreadPool::SetMaxWorkers(uint count)
+{
+	std::lock_guard<std::mutex> lk(this->lock);
+	this->max_workers = count;
+	this->work_cv.notify_all();
+}
+
+/**
+ * Shut down the pool. Already queued tasks are still completed, then all workers are waited for.
+ * Tasks enqueued afterwards are refused.
+ */
+void WorkerThreadPool::Stop()
+{
+	std::unique_lock<std::mutex> lk(this->lock);
+	this->stopped = true;
+	this->work_cv.notify_all();
+	this->exit_cv.wait(lk, [this]() { return this->workers == 0; });
+}
+
+/**
+ * Queue a task to be run by a worker thread.
+ * @param priority Priority of the task.
+ * @param name Thread name to use while running the task.
+ * @param proc Function to run.
+ * @return Handle of the queued task, or nullptr if no worker is available to run it.
+ *         In that case the caller should run the function itself.
+ */
+WorkerTaskPtr WorkerThreadPool::Enqueue(WorkerTaskPriority priority, const char *name, std::function<void()> proc)
+{
+	WorkerTaskPtr task = std::make_shared<WorkerTask>(name, priority, std::move(proc));
+
+	Worker *worker = current_worker;
+	if (worker != nullptr && priority == WTP_NORMAL) {
+		/* The submitting worker runs the task itself when waiting for it, unless another worker steals it first. */
+		{
+			std::lock_guard<std::mutex> lk(worker->lock);
+			worker->tasks.push_back(task);
+		}
+		this->queued++;
+
+		std::lock_guard<std::mutex> lk(this->lock);
+		if (this->idle_workers > 0) {
+			this->work_cv.notify_one();
+		} else if (!this->stopped && this->MaySpawnNormalWorker()) {
+			this->SpawnWorker();
+		}
+		return task;
+	}
+
+	std::lock_guard<std::mutex> lk(this->lock);
+	if (this->stopped) return nullptr;
+
+	this->queues[priority].push_back(task);
+	this->queued++;
+
+	bool have_worker = this->idle_workers >= this->queued;
+	if (!have_worker) {
+		bool may_spawn;
+		switch (priority) {
+			case WTP_NORMAL:
+				may_spawn = this->MaySpawnNormalWorker();
+				break;
+
+			default:
+				may_spawn = true;
+				break;
+		}
+		if (may_spawn) have_worker = this->SpawnWorker();
+	}
+	if (!have_worker && this->workers == 0) {
+		/* Nothing can ever run the task, leave it to the caller. */
+		this->queues[priority].pop_back();
+		this->queued--;
+		return nullptr;
+	}
+	this->work_cv.notify_one();
+	return task;
+}
+
+/**
+ * Get the number of worker threads to use according to the settings.
+ * @return Number of worker threads.
+ */
+uint GetConfiguredWorkerThreadCount()
+{
+	if (_settings_client.gui.worker_threads != 0) return _settings_client.gui.worker_threads;
+
+	/* Leave one core for the main thread. */
+	uint cores = std::thread::hardware_concurrency();
+	return cores > 1 ? cores - 1 : 1;
+}
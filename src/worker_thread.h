@@ -0,0 +1,168 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file worker_thread.h Persistent pool of worker threads for background tasks. */
+
+#ifndef WORKER_THREAD_H
+#define WORKER_THREAD_H
+
+#include "thread.h"
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#if defined(__MINGW32__)
+#include "3rdparty/mingw-std-threads/mingw.mutex.h"
+#include "3rdparty/mingw-std-threads/mingw.condition_variable.h"
+#endif
+
+/** Priority of a task submitted to the worker thread pool. */
+enum WorkerTaskPriority {
+	WTP_URGENT,     ///< Must start promptly, e.g. because another thread is blocked on its progress. May exceed the worker limit.
+	WTP_NORMAL,     ///< Short tasks whose results are waited for soon.
+	WTP_BACKGROUND, ///< Long running tasks whose results are needed by a fixed time, e.g. link graph jobs. Always get a worker, which may exceed the worker limit.
+	WTP_END,
+};
+
+/**
+ * A task queued in the worker thread pool.
+ * Tasks which have not yet been started when they are waited for are run by the waiting thread.
+ */
+class WorkerTask {
+	friend class WorkerThreadPool;
+
+	enum State {
+		WTS_QUEUED,
+		WTS_RUNNING,
+		WTS_DONE,
+	};
+
+	std::function<void()> proc;    ///< Function to run.
+	const char *name;              ///< Thread name to use while running the task.
+	WorkerTaskPriority priority;   ///< Priority of the task.
+	std::atomic<State> state;      ///< Current state. Changes to WTS_DONE are made with the pool lock held.
+	std::condition_variable done_cv;
+
+	bool Claim();
+	void Run();
+
+public:
+	WorkerTask(const char *name, WorkerTaskPriority priority, std::function<void()> proc) :
+			proc(std::move(proc)), name(name), priority(priority), state(WTS_QUEUED) {}
+
+	void Wait();
+	bool IsDone() const;
+};
+
+typedef std::shared_ptr<WorkerTask> WorkerTaskPtr;
+
+/**
+ * Pool of persistent worker threads, shared by all subsystems which run work in the background.
+ * Threads are created on demand up to the configured limit and are then kept around for later tasks.
+ *
+ * Normal priority tasks submitted by a worker, such as the chunks of a parallel loop inside a
+ * background job, go to that worker's own deque. The worker takes them back newest first, idle
+ * workers steal them oldest first. All other tasks go to the shared queues.
+ * Background tasks always get a worker of their own, so they never run late on the thread which waits
+ * for them. Those workers don't count towards the limit of normal tasks, which cannot queue behind them.
+ */
+class WorkerThreadPool {
+	friend class WorkerTask;
+
+	/** Per worker state. */
+	struct Worker {
+		std::mutex lock;                 ///< Protects tasks.
+		std::deque<WorkerTaskPtr> tasks; ///< Normal priority tasks submitted by this worker.
+	};
+
+	std::mutex lock;                   ///< Protects everything except the workers' own deques.
+	std::condition_variable work_cv;   ///< Signalled when work is queued or workers should exit.
+	std::condition_variable exit_cv;   ///< Signalled when a worker exits.
+	std::deque<WorkerTaskPtr> queues[WTP_END]; ///< Tasks submitted from outside the pool, or not of normal priority.
+	std::vector<Worker *> worker_list; ///< Live workers, to steal tasks from.
+	uint max_workers = 0;              ///< Maximum number of workers for non-urgent tasks.
+	uint workers = 0;                  ///< Number of live worker threads.
+	uint idle_workers = 0;             ///< Number of workers waiting for work.
+	uint background_workers = 0;       ///< Number of workers running a background task.
+	std::atomic<uint> queued;          ///< Number of queued, unclaimed tasks.
+	bool stopped = false;              ///< Whether the pool has been shut down.
+
+	static thread_local Worker *current_worker; ///< Worker state of the current thread, if it is a worker.
+
+	/**
+	 * Check whether another worker may be started for a normal priority task.
+	 * Workers busy with background tasks don't count towards the limit.
+	 * The pool lock must be held.
+	 * @return True if another worker may be started.
+	 */
+	bool MaySpawnNormalWorker() const
+	{
+		return this->workers - this->background_workers < this->max_workers;
+	}
+
+	WorkerTaskPtr PopLocalTask(Worker *worker);
+	WorkerTaskPtr PopTask(Worker *worker);
+	bool SpawnWorker();
+	void RunTask(WorkerTaskPtr &task, std::unique_lock<std::mutex> &lk);
+	void WorkerMain();
+
+public:
+	WorkerThreadPool() : queued(0) {}
+
+	void SetMaxWorkers(uint count);
+	void Stop();
+	WorkerTaskPtr Enqueue(WorkerTaskPriority priority, const char *name, std::function<void()> proc);
+
+	/**
+	 * Get the maximum number of workers for non-urgent tasks.
+	 * @return Maximum number of workers.
+	 */
+	uint GetMaxWorkers() const { return this->max_workers; }
+};
+
+extern WorkerThreadPool _worker_pool;
+
+uint GetConfiguredWorkerThreadCount();
+
+/**
+ * Run a function over a range of indices, split into chunks which are run by the worker thread pool.
+ * The calling thread runs the first chunk itself and then helps with any chunks not yet started.
+ * @param name Thread name to use while running a chunk.
+ * @param count Number of indices.
+ * @param min_chunk Minimum number of indices per chunk.
+ * @param proc Function called with the begin and end index of each chunk.
+ */
+template <typename F>
+void WorkerParallelFor(const char *name, size_t count, size_t min_chunk, F proc)
+{
+	size_t chunks = std::min<size_t>(_worker_pool.GetMaxWorkers() + 1, count / std::max<size_t>(min_chunk, 1));
+	if (chunks <= 1) {
+		if (count > 0) proc(0, count);
+		return;
+	}
+
+	size_t chunk_size = (count + chunks - 1) / chunks;
+	std::vector<WorkerTaskPtr> tasks;
+	tasks.reserve(chunks - 1);
+	for (size_t begin = chunk_size; begin < count; begin += chunk_size) {
+		size_t end = std::min(begin + chunk_size, count);
+		WorkerTaskPtr task = _worker_pool.Enqueue(WTP_NORMAL, name, [&proc, begin, end]() { proc(begin, end); });
+		if (task == nullptr) {
+			proc(begin, end);
+		} else {
+			tasks.push_back(std::move(task));
+		}
+	}
+	proc(0, chunk_size);
+	for (WorkerTaskPtr &task : tasks) task->Wait();
+}
+
+#endif /* WORKER_THREAD_H */